@@ -0,0 +1,10 @@
+#include <iostream>
+
+void BenchmarkRandomMatrixScaling(std::size_t rows, std::size_t cols, int repetitions);
+void BenchmarkPrecision(std::size_t numPaths, std::size_t numDays, int repetitions);
+
+int main() 
+{
+    BenchmarkRandomMatrixScaling(252, 100'000, 5);
+    BenchmarkPrecision(100'000, 252, 3);
+}
@@ -0,0 +1,43 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+
+#include "../include/MonteCarloEngine.hpp"
+
+namespace
+{
+    template <typename Real>
+    double TimeSimulation(std::size_t numPaths, std::size_t numDays, int repetitions)
+    {
+        BasicMonteCarloEngine<Real> engine(7);
+
+        // warm-up so the pool is running before timing starts
+        engine.GenerateReturnsForSingleAsset(0.08, 0.2, numPaths / 10, numDays);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for(int rep = 0; rep < repetitions; ++rep)
+        {
+            BasicReturns<Real> returns = engine.GenerateReturnsForSingleAsset(0.08, 0.2, numPaths, numDays);
+            BasicReturns<Real> prices = engine.BuildPricePaths(returns, 100.0);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        return std::chrono::duration<double>(end - start).count() / repetitions;
+    }
+}
+
+// Generation plus price-path construction in double and in float storage.
+void BenchmarkPrecision(std::size_t numPaths, std::size_t numDays, int repetitions)
+{
+    const double secondsD = TimeSimulation<double>(numPaths, numDays, repetitions);
+    const double secondsF = TimeSimulation<float>(numPaths, numDays, repetitions);
+    const double cells = static_cast<double>(numPaths * numDays);
+
+    std::cout << "\nSimulation precision (" << numPaths << " paths x " << numDays << " days):" << '\n';
+    std::cout << "  Precision    Mcells/s    Buffer (MB)" << '\n';
+    std::cout << "  double     " << std::setw(10) << std::fixed << std::setprecision(1) << cells / secondsD / 1e6
+              << "  " << std::setw(12) << cells * sizeof(double) / 1e6 << '\n';
+    std::cout << "  float      " << std::setw(10) << cells / secondsF / 1e6
+              << "  " << std::setw(12) << cells * sizeof(float) / 1e6 << '\n';
+    std::cout << "  float speed-up: " << std::setprecision(2) << secondsD / secondsF << "x" << '\n';
+}
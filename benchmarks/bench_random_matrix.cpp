@@ -0,0 +1,56 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "../include/RandomGenerator.hpp"
+#include "../include/ThreadPool.hpp"
+
+// Fills the same matrix with 1, 2, 4, ... threads and reports throughput and speed-up over one thread.
+void BenchmarkRandomMatrixScaling(std::size_t rows, std::size_t cols, int repetitions)
+{
+    const std::size_t maxThreads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+
+    std::vector<std::size_t> threadCounts;
+    for(std::size_t n = 1; n < maxThreads; n *= 2)
+    {
+        threadCounts.push_back(n);
+    }
+    threadCounts.push_back(maxThreads);
+
+    std::cout << "\nRandom matrix fill (" << rows << " x " << cols << ", " << repetitions << " repetitions):" << '\n';
+    std::cout << "  Threads    Mnormals/s    Speed-up" << '\n';
+
+    Eigen::MatrixXd matrix(rows, cols);
+    GenNormalPCG rng = GenNormalPCG::FromSeed(42);
+
+    double baseline = 0.0;
+    for(std::size_t numThreads : threadCounts)
+    {
+        ThreadPool::Configure({ numThreads, true, {} });
+
+        // warm-up touches the pages and wakes the workers
+        rng.FillRandomMatrix(matrix);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for(int rep = 0; rep < repetitions; ++rep)
+        {
+            rng.FillRandomMatrix(matrix);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        const double seconds = std::chrono::duration<double>(end - start).count();
+        const double throughput = static_cast<double>(rows * cols) * repetitions / seconds / 1e6;
+        if(numThreads == 1)
+        {
+            baseline = throughput;
+        }
+
+        std::cout << "  " << std::setw(7) << numThreads
+                  << "  " << std::setw(12) << std::fixed << std::setprecision(1) << throughput
+                  << "  " << std::setw(10) << std::setprecision(2) << throughput / baseline << "x" << '\n';
+    }
+
+    ThreadPool::Configure({});
+}
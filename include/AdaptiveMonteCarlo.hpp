@@ -0,0 +1,101 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "MonteCarloEngine.hpp"
+
+/*
+Runs a simulation in batches until the target statistics are known well enough, instead of a fixed
+path count. Standard errors come from the spread of the per-batch statistics (batch means), which
+also covers quantiles, where no simple closed-form error exists.
+
+With a time budget the run is an anytime query: a small pilot batch measures the throughput, later
+batches are sized to finish before the deadline, and the result is the best estimate (with its
+intervals) at the point the budget ran out. A progress callback sees the same estimate after every
+batch, so a UI can refine its display while the run continues.
+*/
+namespace AdaptiveMonteCarlo
+{
+    enum class StopReason
+    {
+        Converged,
+        TimeBudget,
+        MaxPaths,
+        // only seen by progress callbacks, the run is still going
+        Running
+    };
+
+    struct Config
+    {
+        std::size_t m_numDays = 252;
+        double m_confidence = 0.95;
+        // extra quantiles of the terminal return to track (for fan charts, tail checks, ...)
+        std::vector<double> m_quantiles = { 0.01, 0.05, 0.5, 0.95, 0.99 };
+
+        // a statistic has converged once its CI half-width is below max(absolute, relative * |value|)
+        double m_absoluteTolerance = 0.001;
+        double m_relativeTolerance = 0.01;
+        double m_ciLevel = 0.95;
+
+        std::size_t m_batchSize = 25'000;
+        std::size_t m_minBatches = 8;
+        // with a time budget: the size of the pilot batch, and the smallest batch still worth starting
+        std::size_t m_minBatchSize = 1'000;
+        // CVaR is only trusted once this many paths have landed beyond the VaR
+        std::size_t m_minTailSamples = 2'000;
+        std::size_t m_maxPaths = 10'000'000;
+        // zero means no time limit; otherwise batches are planned to end within it
+        std::chrono::milliseconds m_timeBudget{0};
+    };
+
+    struct Estimate
+    {
+        double m_value;
+        double m_standardError;
+        double m_lower;
+        double m_upper;
+    };
+
+    // all statistics refer to the terminal simple return, VaR and CVaR are reported as positive losses
+    struct Result
+    {
+        Estimate m_mean;
+        Estimate m_VaR;
+        Estimate m_CVaR;
+        std::vector<double> m_quantileLevels;
+        std::vector<Estimate> m_quantiles;
+
+        std::size_t m_numPaths;
+        std::size_t m_numBatches;
+        StopReason m_stopReason;
+        double m_elapsedMs;
+    };
+
+    // simulates numPaths fresh paths and returns their terminal log-returns
+    using BatchSimulator = std::function<std::vector<double>(std::size_t numPaths)>;
+
+    // receives the pooled estimate after every batch; each call pools the whole sample so far
+    using ProgressCallback = std::function<void(const Result&)>;
+
+    Result Run(const BatchSimulator& simulateBatch, const Config& config, const ProgressCallback& onProgress = {});
+
+    template <typename Real>
+    Result RunMultiAsset(
+        const BasicMonteCarloEngine<Real>& engine,
+        const Eigen::MatrixXd& choleskyMatrix,
+        const std::vector<std::pair<double, double>>& assetStatistics,
+        const std::vector<double>& weights,
+        bool ignoreDrift,
+        const Config& config,
+        const SimulationOptions& options = {},
+        const ProgressCallback& onProgress = {})
+    {
+        return Run([&](std::size_t numPaths) {
+            const BasicReturns<Real> returns = engine.GenerateReturnsForMultiAsset(choleskyMatrix, assetStatistics, weights, ignoreDrift, numPaths, config.m_numDays, options);
+            return engine.ComputeTerminalLogReturns(returns);
+        }, config, onProgress);
+    }
+}
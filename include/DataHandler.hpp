@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <string>
 #include <map>
 #include <fstream>
@@ -7,6 +8,7 @@
 #include <vector>
 #include <iostream>
 #include <filesystem>
+#include <cmath>
 
 #include "Globals.hpp"
 #include "MonteCarloEngine.hpp"
@@ -167,6 +169,69 @@ static void WritePathsToCSV(const Returns& returns, const std::string& filename)
     std::cout << "CSV file written: " << filename << '\n';
 }
 
+// fan-chart bands as prices, one row per day with a column per level, and the sampled paths in the WritePathsToCSV layout
+static void WriteFanChartToCSV(const FanChart& chart, double initialPrice, const std::string& bandsFilename, const std::string& samplesFilename)
+{
+    const std::size_t numLevels = chart.m_levels.size();
+    if (numLevels > 0)
+    {
+        std::ofstream file(bandsFilename);
+        if (!file.is_open())
+        {
+            std::cerr << "Error opening file: " << bandsFilename << '\n';
+            return;
+        }
+
+        file << "Day";
+        for (double level : chart.m_levels)
+        {
+            file << ",Q" << level;
+        }
+        file << '\n';
+
+        for (std::size_t day = 0; day < chart.m_bands.size() / numLevels; ++day)
+        {
+            file << day + 1;
+            for (std::size_t level = 0; level < numLevels; ++level)
+            {
+                file << "," << initialPrice * std::exp(chart.m_bands[day * numLevels + level]);
+            }
+            file << '\n';
+        }
+
+        file.close();
+        std::cout << "Fan chart bands written: " << bandsFilename << '\n';
+    }
+
+    const std::size_t numSamples = chart.m_samplePaths.size();
+    if (numSamples > 0)
+    {
+        std::ofstream file(samplesFilename);
+        if (!file.is_open())
+        {
+            std::cerr << "Error opening file: " << samplesFilename << '\n';
+            return;
+        }
+
+        const std::size_t numDays = chart.m_samples.size() / numSamples;
+        for (std::size_t path = 0; path < numSamples; ++path)
+        {
+            for (std::size_t day = 0; day < numDays; ++day)
+            {
+                file << initialPrice * std::exp(chart.m_samples[path * numDays + day]);
+                if (day < numDays - 1)
+                {
+                    file << ",";
+                }
+            }
+            file << '\n';
+        }
+
+        file.close();
+        std::cout << "Sampled paths written: " << samplesFilename << '\n';
+    }
+}
+
 static StockData ParseStockData(const std::string& ticker)
 {
     StockData data;
@@ -344,6 +409,44 @@ static std::vector<std::vector<double>> GetLogReturnsMat(const std::vector<std::
     return logReturnsMat;
 }
 
+// log-returns between consecutive dates on which every parsed ticker has a price, with the date each row ends on;
+// both come from one parse of the CSVs, so a row's label is the day all of its returns end on
+static std::pair<std::vector<std::vector<double>>, std::vector<std::string>> GetDatedLogReturnsMat(const std::vector<std::string>& tickers)
+{
+    const std::vector<StockData> stocks = DataHandler::ParseStocks(tickers);
+    if(stocks.empty())
+        return {};
+
+    std::vector<std::string> dates;
+    for(const auto& [date, price] : stocks.front().m_prices)
+    {
+        const bool everywhere = std::all_of(std::next(stocks.begin()), stocks.end(), [&date](const StockData& stock) {
+            return stock.m_prices.count(date) > 0;
+        });
+        if(everywhere)
+        {
+            dates.push_back(date);
+        }
+    }
+
+    if(dates.size() < 2)
+        return {};
+
+    std::vector<std::vector<double>> logReturnsMat(dates.size() - 1, std::vector<double>(stocks.size(), 0.0));
+    for(std::size_t row = 0; row + 1 < dates.size(); ++row)
+    {
+        for(std::size_t col = 0; col < stocks.size(); ++col)
+        {
+            const double prevPrice = stocks[col].m_prices.at(dates[row]);
+            const double price = stocks[col].m_prices.at(dates[row + 1]);
+            logReturnsMat[row][col] = (prevPrice <= 0.0 || price <= 0.0) ? std::numeric_limits<double>::quiet_NaN() : std::log(price / prevPrice);
+        }
+    }
+
+    dates.erase(dates.begin());
+    return { std::move(logReturnsMat), std::move(dates) };
+}
+
 static void WriteEfficientFrontierToCSV(const PortfolioOptimisation::EfficientFrontier& frontier, const std::string& filename) 
 {
     fs::path filepath(filename);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Eigen/Dense"
+
+/*
+Linear factor model of annualised asset log-returns:
+
+    r = mu + B f + D e,    f ~ N(0, I_k),  e ~ N(0, I_n),  D diagonal
+
+The covariance B B^T + D^2 is never formed, so a universe of thousands of names costs O(n k) to
+store and simulate instead of the O(n^2) of a dense covariance and its Cholesky factor.
+*/
+struct FactorLoadings
+{
+    // assets x factors
+    Eigen::MatrixXd m_loadings;
+    // per-asset volatility left over after the factors
+    Eigen::VectorXd m_idiosyncraticVols;
+
+    std::size_t GetNumAssets() const
+    {
+        return static_cast<std::size_t>(m_loadings.rows());
+    }
+
+    std::size_t GetNumFactors() const
+    {
+        return static_cast<std::size_t>(m_loadings.cols());
+    }
+
+    // total volatility of every asset, sqrt(|B_i|^2 + d_i^2)
+    Eigen::VectorXd TotalVols() const
+    {
+        return (m_loadings.rowwise().squaredNorm() + m_idiosyncraticVols.cwiseAbs2()).cwiseSqrt();
+    }
+};
+
+namespace FactorModel
+{
+    // statistical model of a days x assets log-returns matrix: the top numFactors principal components of the
+    // sample covariance are the factors and the rest of each asset's variance is idiosyncratic. days with a non-finite
+    // return for any asset are skipped; at least numFactors + 1 complete days must remain
+    FactorLoadings FitStatistical(const std::vector<std::vector<double>>& logReturnsMat, std::size_t numFactors, bool annualise = true);
+
+    // user-supplied loadings (assets x factors, annualised); the idiosyncratic volatility makes up the rest of
+    // each asset's total volatility, and is floored at zero where the loadings already explain more than all of it
+    FactorLoadings FromLoadings(const Eigen::MatrixXd& loadings, const std::vector<double>& assetVols);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/*
+GARCH(1,1) with an optional GJR leverage term, on daily log-returns:
+
+    r_t = mu + e_t,    e_t = sqrt(h_t) * z_t
+    h_t+1 = omega + (alpha + gamma * [e_t < 0]) * e_t^2 + beta * h_t
+
+gamma = 0 is plain GARCH(1,1).
+*/
+struct GarchParams
+{
+    double m_mu = 0.0;
+    double m_omega = 0.0;
+    double m_alpha = 0.0;
+    double m_beta = 0.0;
+    double m_gamma = 0.0;
+
+    // conditional variance and residual of the last observed day, simulations start one step after them
+    double m_lastVariance = 0.0;
+    double m_lastResidual = 0.0;
+
+    // expected decay of a variance shock per step (symmetric shocks hit the leverage term half the time)
+    double Persistence() const
+    {
+        return m_alpha + 0.5 * m_gamma + m_beta;
+    }
+
+    double UnconditionalVariance() const
+    {
+        return m_omega / (1.0 - Persistence());
+    }
+
+    double NextVariance(double variance, double residual) const
+    {
+        const double leverage = (residual < 0.0) ? m_gamma : 0.0;
+        return m_omega + (m_alpha + leverage) * residual * residual + m_beta * variance;
+    }
+};
+
+struct GarchFitOptions
+{
+    std::size_t m_maxIterations = 200;
+    // stop once the gradient of the mean negative log-likelihood falls below this (standardised units)
+    double m_gradientTolerance = 1e-6;
+    // series shorter than this are given a constant-variance fit instead
+    std::size_t m_minObservations = 50;
+};
+
+struct GarchFit
+{
+    GarchParams m_params;
+    double m_logLikelihood = 0.0;
+    std::size_t m_numObservations = 0;
+    std::size_t m_iterations = 0;
+    bool m_converged = false;
+};
+
+namespace GarchModel
+{
+    // Gaussian MLE of a GARCH(1,1); a valid warmStart (e.g. yesterday's fit) is used as the starting point
+    GarchFit Fit(const std::vector<double>& returns, const GarchParams* warmStart = nullptr, const GarchFitOptions& options = {});
+
+    // fits every column of a days x assets log-returns matrix in parallel; warmStarts is empty or one per asset
+    std::vector<GarchFit> FitAssets(const std::vector<std::vector<double>>& logReturnsMat, const std::vector<GarchParams>& warmStarts = {}, const GarchFitOptions& options = {});
+}
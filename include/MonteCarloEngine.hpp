@@ -1,29 +1,342 @@
 #pragma once
 
 #include <vector>
-#include <thread>
+#include <mutex>
+#include <cstdint>
+#include <optional>
+#include <span>
 
 #include "Eigen/Dense"
 
+#include "FactorModel.hpp"
+#include "GarchModel.hpp"
 #include "Portfolio.hpp"
 #include "RandomGenerator.hpp"
+#include "RiskSketches.hpp"
+#include "SimulationBuffer.hpp"
 
-struct Returns
+enum class VarianceReduction
 {
-    std::vector<double> m_returns;
+    None,
+    Antithetic,
+    ControlVariate,
+    TailImportanceSampling
+};
+
+enum class SimulationOutput
+{
+    LogReturns,
+    // prices are built inside the generation pass, so no second full-size buffer is needed
+    PricePaths
+};
+
+enum class ShockDistribution
+{
+    Gaussian,
+    // multi-asset only: assets are joined by a t copula, with one chi-square mixing draw per path-step shared across assets
+    StudentT
+};
+
+struct SimulationOptions
+{
+    VarianceReduction m_varianceReduction = VarianceReduction::None;
+
+    SimulationOutput m_output = SimulationOutput::LogReturns;
+    double m_initialPrice = 100.0;
+
+    // per-step mean shift of the shocks (in standard deviations) used by tail importance sampling.
+    // 0 picks the tilt that centres the terminal return on the VaR quantile at m_tailConfidence
+    double m_tailTilt = 0.0;
+    double m_tailConfidence = 0.95;
+
+    // Merton jumps on top of the Gaussian diffusion: Poisson arrivals at m_jumpIntensity per year with normal
+    // log-jump sizes. the diffusion drift is compensated so the mean log-return stays at the requested drift
+    double m_jumpIntensity = 0.0;
+    double m_jumpMean = 0.0;
+    double m_jumpStdDev = 0.0;
+
+    // path-dependent summaries (drawdown, time under water, barrier first passage) computed while each path is generated
+    bool m_trackPathMetrics = false;
+    // first-passage barrier as a simple return on the starting wealth, e.g. -0.2 for "lost 20% at some point"
+    double m_lossBarrier = -0.2;
+    // false keeps only the path metrics, so path-dependent risk costs the memory of terminal-only risk
+    bool m_storePaths = true;
+
+    // horizons (in days, ascending, at most numDays) whose simple returns are sketched as each path passes them, so a
+    // whole term structure of risk comes from the paths of the longest horizon in memory that does not grow with them
+    std::vector<std::size_t> m_checkpointDays;
+
+    ShockDistribution m_shocks = ShockDistribution::Gaussian;
+    // degrees of freedom for StudentT shocks, one per asset (see ComputeTailDegreesOfFreedom) or a single shared value
+    std::vector<double> m_degreesOfFreedom;
+
+    // levels of the cumulative log-return to read off every day as the paths are generated (fan-chart bands),
+    // e.g. { 0.05, 0.25, 0.5, 0.75, 0.95 }; the paths themselves need not be stored
+    std::vector<double> m_bandQuantiles;
+    // whole paths kept for plotting alongside the bands, a uniform sample of this many
+    std::size_t m_samplePaths = 0;
+};
+
+enum class BootstrapScheme
+{
+    // blocks of geometric length with mean m_blockLength (Politis-Romano), keeps the resampled series stationary
+    Stationary,
+    // blocks of exactly m_blockLength, wrapping around the end of the history
+    Circular
+};
+
+struct BootstrapOptions
+{
+    BootstrapScheme m_scheme = BootstrapScheme::Stationary;
+    double m_blockLength = 20.0;
+};
+
+struct MarketRegime
+{
+    // annual per-asset drifts and the factor of the regime's annualised covariance (PortfolioOptimisation::GetCholeskyMatrix)
+    std::vector<double> m_drifts;
+    Eigen::MatrixXd m_choleskyMatrix;
+};
+
+struct RegimeSwitchingModel
+{
+    std::vector<MarketRegime> m_regimes;
+    // per-step transition probabilities, m_transitionMatrix[from][to]
+    std::vector<std::vector<double>> m_transitionMatrix;
+    // regime of the first simulated day
+    std::size_t m_initialRegime = 0;
+};
+
+// per-path summaries written by the generation loops when SimulationOptions::m_trackPathMetrics is set
+struct PathMetrics
+{
+    double m_lossBarrier = 0.0;
+    std::vector<double> m_terminalLogReturns;
+    // largest peak-to-trough loss of wealth, as a positive fraction
+    std::vector<double> m_maxDrawdowns;
+    // days on which wealth closed below its running peak
+    std::vector<uint32_t> m_daysUnderWater;
+    // first day (0-based) wealth closed at or below the barrier, -1 if it never did
+    std::vector<int32_t> m_firstPassageDays;
+};
+
+// filled during generation from SimulationOptions::m_bandQuantiles and m_samplePaths
+struct FanChart
+{
+    std::vector<double> m_levels;
+    // cumulative log-return at every level for days 1..numDays, day-major: m_bands[day * m_levels.size() + level]
+    std::vector<double> m_bands;
+    // ascending indices of the sampled paths and their cumulative log-returns, path-major
+    std::vector<std::size_t> m_samplePaths;
+    std::vector<double> m_samples;
+};
+
+// distribution of the simple return at each checkpoint horizon, weighted by the likelihood ratio under importance sampling
+struct HorizonSketches
+{
+    std::vector<std::size_t> m_days;
+    std::vector<HistogramSketch> m_sketches;
+};
+
+struct HorizonRisk
+{
+    std::size_t m_days;
+    double m_meanReturn;
+    double m_VaR;
+    double m_CVaR;
+};
+
+struct PortfolioRisk
+{
+    // one entry per checkpoint horizon, or just numDays when no checkpoints are set
+    std::vector<HorizonRisk> m_horizons;
+};
+
+struct PathRiskReport
+{
+    std::size_t m_numPaths;
+    double m_lossBarrier;
+    double m_barrierHitProbability;
+    // mean first-passage day of the paths that hit the barrier
+    double m_meanFirstPassageDay;
+    double m_meanMaxDrawdown;
+    // max drawdown exceeded with probability 1 - confidence
+    double m_maxDrawdownAtConfidence;
+    double m_meanDaysUnderWater;
+};
+
+enum class RebalanceRule
+{
+    // buy and hold: cash flows are the only trades
+    None,
+    // back to target weights every m_rebalanceInterval days
+    Calendar,
+    // back to target weights on any day some asset's weight has drifted more than m_driftThreshold from its target
+    Threshold
+};
+
+struct CashFlow
+{
+    // 0-based day at whose close the flow is applied
+    std::size_t m_day;
+    // positive deposits are invested at the target weights, negative withdrawals are taken pro rata from the holdings
+    double m_amount;
+};
+
+struct WealthPlan
+{
+    std::vector<double> m_targetWeights;
+    double m_initialWealth = 1.0;
+
+    RebalanceRule m_rule = RebalanceRule::Calendar;
+    std::size_t m_rebalanceInterval = 21;
+    double m_driftThreshold = 0.05;
+    // proportional cost on the value traded when rebalancing, e.g. 0.001 for 10bp
+    double m_transactionCost = 0.0;
+
+    std::vector<CashFlow> m_cashFlows;
+    // terminal wealth below this counts as a shortfall; defaults to the initial wealth plus the net cash flows
+    std::optional<double> m_shortfallLevel;
+};
+
+struct WealthReport
+{
+    std::size_t m_numPaths;
+    double m_shortfallLevel;
+    double m_meanTerminalWealth;
+    double m_medianTerminalWealth;
+    // terminal wealth exceeded with probability confidence
+    double m_terminalWealthAtRisk;
+    double m_shortfallProbability;
+    // mean amount by which the paths that fall short miss the level
+    double m_meanShortfall;
+    // paths on which withdrawals exhausted the account at some point
+    double m_depletionProbability;
+    // per path totals of value traded by rebalancing and of the costs paid on it
+    double m_meanTurnover;
+    double m_meanCosts;
+    // terminal wealth of every path, for the full distribution
+    std::vector<double> m_terminalWealth;
+};
+
+// Real is the storage (and shock) precision of the paths; statistics derived from them are accumulated in double
+template <typename Real>
+struct BasicReturns
+{
+    // not value-initialised on resize: the generating worker takes the first touch of every page
+    SimulationVector<Real> m_returns;
     std::size_t m_blockSize;
+
+    // m_returns holds prices starting from m_initialPrice rather than log-returns when this is PricePaths
+    SimulationOutput m_output = SimulationOutput::LogReturns;
+    double m_initialPrice = 1.0;
+
+    // closed-form per-step moments of the log-return the paths were drawn from
+    double m_stepDrift = 0.0;
+    double m_stepStdDev = 0.0;
+
+    VarianceReduction m_varianceReduction = VarianceReduction::None;
+    double m_tailTilt = 0.0;
+    // per-path likelihood ratios, only populated under tail importance sampling
+    std::vector<double> m_weights;
+
+    PathMetrics m_pathMetrics;
+    HorizonSketches m_horizons;
+    FanChart m_fanChart;
+
+    // m_returns is empty when only path metrics or checkpoints were kept
+    std::size_t GetNumPaths() const
+    {
+        if(!m_returns.empty())
+            return m_returns.size() / m_blockSize;
+
+        return m_horizons.m_days.empty() ? m_pathMetrics.m_terminalLogReturns.size() : static_cast<std::size_t>(m_horizons.m_sketches.front().GetCount());
+    }
 };
 
-class MonteCarloEngine 
+using Returns = BasicReturns<double>;
+using ReturnsF = BasicReturns<float>;
+
+struct VarianceReductionReport
+{
+    VarianceReduction m_mode;
+    std::size_t m_numPaths;
+    double m_meanTerminalReturn;
+    double m_standardError;
+    double m_VaR;
+    double m_CVaR;
+    // number of plain Monte Carlo paths that would give the same precision
+    double m_effectiveSampleSize;
+    // plain Monte Carlo estimator variance divided by this estimator's variance
+    double m_varianceRatio;
+};
+
+template <typename Real>
+class BasicMonteCarloEngine
 {
 public:
-    MonteCarloEngine();
-    ~MonteCarloEngine();
-    
+    BasicMonteCarloEngine();
+    // fixes the parent stream, making every simulation from this engine reproducible
+    explicit BasicMonteCarloEngine(uint64_t seed);
+    // substream-th independent slice of seed's stream, so pieces of one run can be generated separately and reproducibly
+    BasicMonteCarloEngine(uint64_t seed, uint64_t substream);
+    // the same substream writing its stored paths into caller-owned storage (e.g. a memory-mapped shard) instead of
+    // BasicReturns::m_returns, which is then left empty; every simulation must fill exactly pathBuffer.size() values
+    BasicMonteCarloEngine(uint64_t seed, uint64_t substream, std::span<Real> pathBuffer);
+    ~BasicMonteCarloEngine();
+
     std::pair<double, double> ComputeAssetStatistics(const std::size_t assetIdx, const std::vector<std::vector<double>>& assetReturns, bool annualise);
     std::vector<std::pair<double, double>> ComputeMultiAssetStatistics(const std::vector<std::vector<double>>& returns, bool annualise);
     std::vector<double> CombineAssetReturns(const Portfolio& portfolio);
-    Returns GenerateReturnsForMultiAsset(const Eigen::MatrixXd& choleskyMatrix, const std::vector<std::pair<double, double>>& assetStatistics, const std::vector<double>& weights, bool ignoreDrift, std::size_t numPaths = 1000000, std::size_t numDays = 252) const;
-    Returns GenerateReturnsForSingleAsset(double drift, double volatility, std::size_t numPaths = 1000000, std::size_t numDays = 252) const;
-    Returns BuildPricePaths(const Returns& returns, double initialPrice);
-};
\ No newline at end of file
+    // method-of-moments Student t degrees of freedom per asset from the excess kurtosis of its history
+    std::vector<double> ComputeTailDegreesOfFreedom(const std::vector<std::vector<double>>& returns) const;
+    BasicReturns<Real> GenerateReturnsForMultiAsset(const Eigen::MatrixXd& choleskyMatrix, const std::vector<std::pair<double, double>>& assetStatistics, const std::vector<double>& weights, bool ignoreDrift, std::size_t numPaths = 1000000, std::size_t numDays = 252, const SimulationOptions& options = {}) const;
+    // closed-form per-step drift and standard deviation of the Gaussian portfolio log-return GenerateReturnsForMultiAsset draws
+    std::pair<double, double> ComputePortfolioStepMoments(const Eigen::MatrixXd& choleskyMatrix, const std::vector<std::pair<double, double>>& assetStatistics, const std::vector<double>& weights, bool ignoreDrift, std::size_t numDays = 252) const;
+    // per-asset volatility and correlation from a factor model; drifts are annual per asset
+    BasicReturns<Real> GenerateReturnsForFactorModel(const FactorLoadings& model, const std::vector<double>& drifts, const std::vector<double>& weights, bool ignoreDrift, std::size_t numPaths = 1000000, std::size_t numDays = 252, const SimulationOptions& options = {}) const;
+    BasicReturns<Real> GenerateReturnsForSingleAsset(double drift, double volatility, std::size_t numPaths = 1000000, std::size_t numDays = 252, const SimulationOptions& options = {}) const;
+    // common random numbers: every column of weights (assets x portfolios) is evaluated on the same simulated asset returns.
+    // Gaussian shocks only; checkpointDays as SimulationOptions::m_checkpointDays, empty for numDays alone
+    std::vector<PortfolioRisk> SimulatePortfolios(const Eigen::MatrixXd& choleskyMatrix, const std::vector<std::pair<double, double>>& assetStatistics, const Eigen::MatrixXd& weights, bool ignoreDrift, std::size_t numPaths = 1000000, std::size_t numDays = 252, double confidence = 0.95, const std::vector<std::size_t>& checkpointDays = {}) const;
+    // the same with the asset returns drawn from a factor model, k + min(portfolios, assets) shocks per path and horizon
+    std::vector<PortfolioRisk> SimulatePortfolios(const FactorLoadings& model, const std::vector<double>& drifts, const Eigen::MatrixXd& weights, bool ignoreDrift, std::size_t numPaths = 1000000, std::size_t numDays = 252, double confidence = 0.95, const std::vector<std::size_t>& checkpointDays = {}) const;
+    // per-asset holdings along each path under a rebalancing rule, cash flows and proportional costs (Gaussian shocks)
+    WealthReport SimulateWealth(const Eigen::MatrixXd& choleskyMatrix, const std::vector<std::pair<double, double>>& assetStatistics, const WealthPlan& plan, bool ignoreDrift, std::size_t numPaths = 100000, std::size_t numDays = 252, double confidence = 0.95) const;
+    // resamples blocks of the actual joint history (days x assets log-returns) instead of drawing Gaussian shocks.
+    // days with a non-finite return for any asset (GetLogReturnsMat marks non-positive prices so) are dropped whole
+    BasicReturns<Real> GenerateReturnsFromBootstrap(const std::vector<std::vector<double>>& logReturnsMat, const std::vector<double>& weights, std::size_t numPaths = 1000000, std::size_t numDays = 252, const BootstrapOptions& options = {}, const SimulationOptions& simulation = {}) const;
+    // portfolio log-returns with GARCH / GJR conditional variance, starting from the last fitted state (variance reduction is not applied).
+    // the model must be stationary, Persistence() < 1
+    BasicReturns<Real> GenerateReturnsForGarch(const GarchParams& params, std::size_t numPaths = 1000000, std::size_t numDays = 252, const SimulationOptions& options = {}) const;
+    // Markov chain over regimes run per path, each regime with its own drifts and covariance (variance reduction is not applied)
+    BasicReturns<Real> GenerateReturnsForRegimeSwitching(const RegimeSwitchingModel& model, const std::vector<double>& weights, std::size_t numPaths = 1000000, std::size_t numDays = 252, const SimulationOptions& options = {}) const;
+    BasicReturns<Real> BuildPricePaths(const BasicReturns<Real>& returns, double initialPrice);
+    void BuildPricePathsInPlace(BasicReturns<Real>& returns, double initialPrice);
+    VarianceReductionReport EvaluateVarianceReduction(const BasicReturns<Real>& returns, double confidence = 0.95) const;
+    std::vector<double> ComputeTerminalLogReturns(const BasicReturns<Real>& returns) const;
+    PathRiskReport EvaluatePathMetrics(const BasicReturns<Real>& returns, double confidence = 0.95) const;
+    // mean, VaR and CVaR of the simple return at every checkpoint horizon
+    std::vector<HorizonRisk> EvaluateHorizons(const BasicReturns<Real>& returns, double confidence = 0.95) const;
+
+private:
+    GenNormalPCG ReserveStream(uint64_t numDraws) const;
+    BasicReturns<Real> SimulateGaussianPaths(double stepDrift, double stepStdDev, std::size_t numPaths, std::size_t numDays, const SimulationOptions& options) const;
+    // groupCovariance is the per-step covariance of the summed exposures of each group of equal degrees of freedom
+    BasicReturns<Real> SimulateStudentTPaths(double stepDrift, const std::vector<double>& groupDof, const Eigen::MatrixXd& groupCovariance, std::size_t numPaths, std::size_t numDays, const SimulationOptions& options) const;
+    std::vector<PortfolioRisk> SimulatePortfolioShocks(const Eigen::MatrixXd& stepLoadings, const Eigen::VectorXd& stepDrifts, std::size_t numPaths, std::size_t numDays, double confidence, const std::vector<std::size_t>& checkpointDays) const;
+
+    // every simulation takes a disjoint jump-ahead slice of this stream
+    mutable GenNormalPCG m_rng;
+    mutable std::mutex m_rngMutex;
+    // empty unless the engine was built for a caller's path storage
+    std::span<Real> m_pathBuffer;
+};
+
+extern template class BasicMonteCarloEngine<float>;
+extern template class BasicMonteCarloEngine<double>;
+
+// double precision throughout
+using MonteCarloEngine = BasicMonteCarloEngine<double>;
+// float32 paths and shocks with double accumulation, half the memory traffic of MonteCarloEngine
+using MonteCarloEngineF = BasicMonteCarloEngine<float>;
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "MonteCarloEngine.hpp"
+#include "ShardedSimulation.hpp"
+
+struct ProcessRunConfig
+{
+    std::size_t m_numPaths = 0;
+    std::size_t m_numDays = 252;
+    // unit of work: shard i is always BasicMonteCarloEngine(m_seed, i), whichever process runs it
+    std::size_t m_pathsPerShard = 1000000;
+    uint64_t m_seed = 0;
+    // 0 = one worker per NUMA node
+    std::size_t m_numProcesses = 0;
+    // pin each worker process and its thread pool to its node's CPUs, so its memory is first touched there too
+    bool m_pinToNodes = true;
+};
+
+struct ProcessRunResult
+{
+    std::size_t m_numPaths = 0;
+    std::size_t m_numProcesses = 0;
+    // terminal simple-return mean, VaR and CVaR from the merged histogram sketches
+    HorizonRisk m_terminal{};
+    // exact moments of the terminal log-return from the merged sums
+    double m_meanLogReturn = 0.0;
+    double m_logReturnStdDev = 0.0;
+};
+
+namespace MultiProcessSimulation
+{
+    /*
+    Forks one worker per NUMA node (or m_numProcesses workers over the allowed CPUs). Each takes a contiguous
+    range of shards, rebuilds its thread pool on its own CPUs and reduces its paths into a histogram sketch and
+    moment sums, written to a shared anonymous mapping the coordinator merges in worker order after all have
+    exited. Paths are never stored, so memory per worker is one shard of path summaries. The shards, and
+    therefore the simulated paths, are the same for any number of processes. Off Linux everything runs in
+    this process.
+
+    The generator must pass its options through to the engine; importance weights are not supported. Call
+    only while no parallel work is in flight, since worker processes inherit the thread pool's state.
+    */
+    template <typename Real>
+    ProcessRunResult Run(const ProcessRunConfig& config, const ShardedSimulation::ShardGenerator<Real>& generate, double confidence = 0.95, const SimulationOptions& options = {});
+}
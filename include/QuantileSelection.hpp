@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/*
+Exact order statistics and tail means of a large sample without sorting it. One parallel pass builds a
+histogram over the top bits of an order-preserving integer key of every value (sign, exponent and the
+leading mantissa bits, so buckets are narrow wherever values are dense), with a count and a sum per bucket.
+That locates the bucket holding each requested rank and the exact sum of everything below it. A second
+pass gathers just those buckets, and nth_element inside each finishes the job, so any number of quantiles
+and tail means cost about two linear passes. The chunking is fixed by the sample size, so the sums, and
+therefore the results, do not depend on the number of threads. Small samples go straight to nth_element.
+*/
+namespace QuantileSelection
+{
+    struct OrderStatistic
+    {
+        double m_level;
+        // the value std::sort would place at index floor(level * n), clamped to the sample
+        double m_value;
+        // mean of that value and every value before it in sorted order
+        double m_tailMean;
+    };
+
+    // values must not be NaN; levels in [0, 1], in any order, answered in the order given
+    std::vector<OrderStatistic> Select(const double* values, std::size_t count, const std::vector<double>& levels);
+
+    inline std::vector<OrderStatistic> Select(const std::vector<double>& values, const std::vector<double>& levels)
+    {
+        return Select(values.data(), values.size(), levels);
+    }
+}
@@ -2,66 +2,329 @@
 
 #include <Eigen/Dense>
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <random>
-#include <thread>
+#include <numbers>
 #include "lib/pcg_random.hpp"
+#include "ThreadPool.hpp"
 
-class GenNormalPCG 
+/*
+Normal generator on top of pcg64_fast using Box-Muller, so every pair of normals consumes exactly
+two raw draws. That fixed consumption is what makes jump-ahead streams possible: the block of
+normals starting at index i is produced by a copy of the parent advanced by DrawsFor(i), and
+parallel fills give the same numbers regardless of how many threads share the work.
+*/
+class GenNormalPCG
 {
 private:
     pcg64_fast rng;
-    std::normal_distribution<double> dist;
+    double m_mean;
+    double m_stddev;
+
+    double m_spare = 0.0;
+    bool m_hasSpare = false;
+
+    // columns per parallel tile are picked so a tile holds roughly this many cells
+    static constexpr std::size_t TILE_CELLS = 1 << 14;
 
 public:
 
     GenNormalPCG() : GenNormalPCG(0.0, 1.0) {}
 
     GenNormalPCG(double mean, double stddev)
-        : rng(seedFromDevice()), dist(mean, stddev) {}
+        : rng(seedFromDevice()), m_mean(mean), m_stddev(stddev) {}
 
-    double operator()() 
+    static GenNormalPCG FromSeed(uint64_t seed, double mean = 0.0, double stddev = 1.0)
     {
-        return dist(rng);
+        GenNormalPCG gen(mean, stddev);
+        gen.rng.seed(seed);
+        return gen;
     }
 
-    Eigen::MatrixXd GenerateRandomMatrixUnsafe(const std::size_t rows, const std::size_t cols)
+    // raw draws consumed by a block of n normals (Box-Muller pairs, the odd spare is discarded)
+    static constexpr uint64_t DrawsFor(std::size_t n)
     {
-        const std::size_t NUM_THREADS = std::thread::hardware_concurrency();
-        
-        Eigen::MatrixXd matrix(rows, cols);
+        return static_cast<uint64_t>(n + (n & 1));
+    }
+
+    double operator()()
+    {
+        if(m_hasSpare)
+        {
+            m_hasSpare = false;
+            return m_mean + m_stddev * m_spare;
+        }
 
-        std::vector<std::thread> threads;
-        threads.reserve(NUM_THREADS);
+        double z0, z1;
+        NextPair(z0, z1);
+        m_spare = z1;
+        m_hasSpare = true;
+        return m_mean + m_stddev * z0;
+    }
 
-        std::size_t totalCells = rows * cols;
-        const std::size_t cellsPerThread = totalCells / NUM_THREADS;
+    // one raw draw as a uniform in [0, 1), for samplers that need more than normals
+    double NextUniform()
+    {
+        constexpr double scale = 1.0 / 9007199254740992.0;
+        return static_cast<double>(rng() >> 11) * scale;
+    }
 
-        double* ptr = matrix.data();
-        for(std::size_t threadIdx = 0; threadIdx < NUM_THREADS; ++threadIdx)
+    // one raw draw as an integer in [0, bound), for bounds well below 2^53
+    uint64_t NextBelow(uint64_t bound)
+    {
+        return std::min(static_cast<uint64_t>(NextUniform() * static_cast<double>(bound)), bound - 1);
+    }
+
+    // n uniforms in [0, 1), one raw draw each
+    template <typename Real>
+    void FillUniform(Real* out, std::size_t n)
+    {
+        for(std::size_t i = 0; i < n; ++i)
         {
-            const std::size_t start = threadIdx * cellsPerThread;
-            const std::size_t end = (threadIdx == NUM_THREADS - 1) ? totalCells : (threadIdx + 1) * cellsPerThread;
-            threads.emplace_back([&, ptr, start, end]() {
-                for(std::size_t i = start; i < end; ++i)
-                {
-                    ptr[i] = (*this)();
-                }
-            });
+            out[i] = static_cast<Real>(NextUniform());
+        }
+    }
+
+    // n normals by Marsaglia's polar method: no trigonometry, but a random number of raw draws (4 / pi per
+    // normal on average), so only for streams that own a slice with room to spare. the acceptance test runs
+    // in double, so float and double fills from the same stream still consume the same draws
+    template <typename Real>
+    void FillPolar(Real* out, std::size_t n)
+    {
+        m_hasSpare = false;
+
+        const Real mean = static_cast<Real>(m_mean);
+        const Real stddev = static_cast<Real>(m_stddev);
+
+        std::size_t i = 0;
+        while(i < n)
+        {
+            const double u = 2.0 * NextUniform() - 1.0;
+            const double v = 2.0 * NextUniform() - 1.0;
+            const double s = u * u + v * v;
+            if(s >= 1.0 || s == 0.0)
+                continue;
+
+            const double scale = std::sqrt(-2.0 * std::log(s) / s);
+            out[i++] = mean + stddev * static_cast<Real>(u * scale);
+            if(i < n)
+            {
+                out[i++] = mean + stddev * static_cast<Real>(v * scale);
+            }
         }
+    }
+
+    // copy of this stream advanced by numDraws raw draws
+    GenNormalPCG Jump(uint64_t numDraws) const
+    {
+        GenNormalPCG stream = *this;
+        stream.rng.advance(numDraws);
+        stream.m_hasSpare = false;
+        return stream;
+    }
 
-        for(std::thread& th : threads)
+    // copy of this stream advanced by index * 2^64 raw draws, for runs split into pieces that are generated (and
+    // restarted) independently; every piece has room for 2^64 draws before reaching the next
+    GenNormalPCG Substream(uint64_t index) const
+    {
+        using state_type = pcg64_fast::state_type;
+
+        GenNormalPCG stream = *this;
+        stream.rng.advance(static_cast<state_type>(index) << 64);
+        stream.m_hasSpare = false;
+        return stream;
+    }
+
+    // hands out the next numDraws raw draws as an independent stream and moves this one past them
+    GenNormalPCG Split(uint64_t numDraws)
+    {
+        GenNormalPCG stream = Jump(0);
+        rng.advance(numDraws);
+        m_hasSpare = false;
+        return stream;
+    }
+
+    // fills a contiguous block, consuming exactly DrawsFor(n) raw draws whatever the precision,
+    // so float and double fills from the same stream see the same uniforms
+    template <typename Real>
+    void Fill(Real* out, std::size_t n)
+    {
+        m_hasSpare = false;
+
+        const Real mean = static_cast<Real>(m_mean);
+        const Real stddev = static_cast<Real>(m_stddev);
+
+        std::size_t i = 0;
+        for(; i + 1 < n; i += 2)
         {
-            th.join();
+            Real z0, z1;
+            NextPair(z0, z1);
+            out[i] = mean + stddev * z0;
+            out[i + 1] = mean + stddev * z1;
         }
 
+        if(i < n)
+        {
+            Real z0, z1;
+            NextPair(z0, z1);
+            out[i] = mean + stddev * z0;
+        }
+    }
+
+    // fills a column-major matrix in parallel, one jump-ahead stream per tile of whole columns
+    void FillRandomMatrix(Eigen::Ref<Eigen::MatrixXd> matrix)
+    {
+        const std::size_t rows = static_cast<std::size_t>(matrix.rows());
+        const std::size_t cols = static_cast<std::size_t>(matrix.cols());
+        if(rows == 0 || cols == 0)
+            return;
+
+        // tiling depends only on the shape, so the result does not depend on the thread count
+        const std::size_t colsPerTile = std::max<std::size_t>(1, TILE_CELLS / rows);
+        const std::size_t numTiles = (cols + colsPerTile - 1) / colsPerTile;
+        const uint64_t tileStride = DrawsFor(colsPerTile * rows);
+
+        const GenNormalPCG base = Split(tileStride * numTiles);
+        const Eigen::Index outerStride = matrix.outerStride();
+        double* data = matrix.data();
+
+        ThreadPool::Instance().ParallelFor(0, numTiles, [&, data](std::size_t startTile, std::size_t endTile) {
+            for(std::size_t tile = startTile; tile < endTile; ++tile)
+            {
+                GenNormalPCG stream = base.Jump(tile * tileStride);
+
+                const std::size_t firstCol = tile * colsPerTile;
+                const std::size_t lastCol = std::min(cols, firstCol + colsPerTile);
+                if(static_cast<std::size_t>(outerStride) == rows)
+                {
+                    stream.Fill(data + firstCol * rows, (lastCol - firstCol) * rows);
+                    continue;
+                }
+
+                // strided views (e.g. a block of a larger matrix) are filled column by column from the same stream
+                for(std::size_t col = firstCol; col < lastCol; ++col)
+                {
+                    for(std::size_t row = 0; row < rows; ++row)
+                    {
+                        data[col * outerStride + row] = stream();
+                    }
+                }
+            }
+        }, 1);
+    }
+
+    Eigen::MatrixXd GenerateRandomMatrix(const std::size_t rows, const std::size_t cols)
+    {
+        Eigen::MatrixXd matrix(rows, cols);
+        FillRandomMatrix(matrix);
         return matrix;
     }
 
 private:
-    static uint64_t seedFromDevice() 
+    template <typename Real>
+    void NextPair(Real& z0, Real& z1)
+    {
+        // 53-bit uniforms, u1 in (0, 1] so the log is finite
+        constexpr double scale = 1.0 / 9007199254740992.0;
+        const Real u1 = static_cast<Real>(static_cast<double>((rng() >> 11) + 1) * scale);
+        const Real u2 = static_cast<Real>(static_cast<double>(rng() >> 11) * scale);
+
+        const Real radius = std::sqrt(Real(-2) * std::log(u1));
+        const Real angle = Real(2) * std::numbers::pi_v<Real> * u2;
+        z0 = radius * std::cos(angle);
+        z1 = radius * std::sin(angle);
+    }
+
+    static uint64_t seedFromDevice()
     {
         std::random_device rd;
         uint64_t seed = (static_cast<uint64_t>(rd()) << 32) ^ rd();
         return seed;
     }
-};
\ No newline at end of file
+};
+
+/*
+Marsaglia-Tsang gamma sampling (shape >= 1) in batches. With d = shape - 1/3 and c = 1/sqrt(9d), a
+normal z and a uniform u give the draw d * v, v = (1 + cz)^3, accepted when
+log u < z^2/2 + d - dv + d log v. Normals and uniforms are filled a batch at a time and the cheap
+squeeze test runs as one straight-line pass; only the few slots that fail it (around 2% at shape 1,
+fewer above) drop to the exact test and a scalar retry. Rejection already makes the draws consumed
+per sample vary, so the normals come from the polar method rather than Box-Muller.
+*/
+class GammaSampler
+{
+private:
+    double m_d;
+    double m_c;
+
+public:
+    explicit GammaSampler(double shape)
+        : m_d(shape - 1.0 / 3.0), m_c(1.0 / std::sqrt(9.0 * (shape - 1.0 / 3.0)))
+    {
+        assert(shape >= 1.0);
+    }
+
+    double Transform(double z) const
+    {
+        const double v = 1.0 + m_c * z;
+        return m_d * v * v * v;
+    }
+
+    // fills n normals accepted by the sampler; every gamma draw is Transform(z), and callers that need
+    // several comonotone shapes from one draw can map the same z through their own (d, c)
+    template <typename Real>
+    void FillAcceptedNormals(GenNormalPCG& rng, Real* z, std::size_t n, std::vector<Real>& scratch) const
+    {
+        scratch.resize(n);
+        rng.FillPolar(z, n);
+        rng.FillUniform(scratch.data(), n);
+
+        // squeeze pass, marks every slot it accepts with 2 (never a uniform, even after rounding to float)
+        const Real c = static_cast<Real>(m_c);
+        for(std::size_t i = 0; i < n; ++i)
+        {
+            const Real v = Real(1) + c * z[i];
+            const Real z2 = z[i] * z[i];
+            const bool accepted = (v > Real(0)) & (scratch[i] < Real(1) - Real(0.0331) * z2 * z2);
+            scratch[i] = accepted ? Real(2) : scratch[i];
+        }
+
+        for(std::size_t i = 0; i < n; ++i)
+        {
+            if(scratch[i] == Real(2))
+                continue;
+
+            double candidate = static_cast<double>(z[i]);
+            double u = static_cast<double>(scratch[i]);
+            while(!Accept(candidate, u))
+            {
+                candidate = rng();
+                u = rng.NextUniform();
+            }
+            z[i] = static_cast<Real>(candidate);
+        }
+    }
+
+    template <typename Real>
+    void Fill(GenNormalPCG& rng, Real* out, std::size_t n, std::vector<Real>& scratch) const
+    {
+        FillAcceptedNormals(rng, out, n, scratch);
+        for(std::size_t i = 0; i < n; ++i)
+        {
+            out[i] = static_cast<Real>(Transform(static_cast<double>(out[i])));
+        }
+    }
+
+private:
+    bool Accept(double z, double u) const
+    {
+        const double v = 1.0 + m_c * z;
+        if(v <= 0.0 || u <= 0.0)
+            return false;
+
+        const double v3 = v * v * v;
+        return std::log(u) < 0.5 * z * z + m_d - m_d * v3 + m_d * std::log(v3);
+    }
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Eigen/Dense"
+
+#include "MonteCarloEngine.hpp"
+
+/*
+Single entry point for portfolio risk that only simulates when it has to. Under the Gaussian multi-asset
+model the portfolio log-return over d days is N(d * drift, d * stdDev^2) with the step moments of
+BasicMonteCarloEngine::ComputePortfolioStepMoments, so mean, VaR and CVaR of the simple return are closed
+form. Fat tails, jumps, path-dependent metrics and rebalancing have no closed form here and go to the
+engine, and the result says which engine answered and why.
+*/
+namespace RiskEngine
+{
+    enum class Method
+    {
+        ClosedForm,
+        MonteCarlo,
+        // BasicMonteCarloEngine::SimulateWealth, for rebalancing and cash-flow schedules
+        WealthSimulation
+    };
+
+    struct Query
+    {
+        std::size_t m_numDays = 252;
+        double m_confidence = 0.95;
+        bool m_ignoreDrift = false;
+
+        // the model: StudentT shocks, jumps or path metrics here need simulation, checkpoint days add horizons
+        SimulationOptions m_simulation;
+        // set for an account that rebalances and has cash flows, which is always simulated
+        std::optional<WealthPlan> m_wealthPlan;
+
+        // daily portfolio log-returns whose skewness and excess kurtosis drive the Cornish-Fisher figures; empty skips them
+        std::vector<double> m_historicalReturns;
+
+        // paths for the simulation fallback
+        std::size_t m_numPaths = 1'000'000;
+        // simulate even when the closed form applies, e.g. to check one against the other
+        bool m_forceSimulation = false;
+    };
+
+    struct Evaluation
+    {
+        Method m_method;
+        // what in the query needed simulation, empty for ClosedForm
+        std::string m_reason;
+        // one entry per checkpoint horizon, or just numDays. under WealthSimulation only the terminal horizon,
+        // as returns on the contributed capital (initial wealth plus net cash flows)
+        std::vector<HorizonRisk> m_horizons;
+        // Cornish-Fisher adjusted figures for the same horizons, only with historical returns
+        std::vector<HorizonRisk> m_cornishFisher;
+        std::optional<PathRiskReport> m_pathRisk;
+        std::optional<WealthReport> m_wealth;
+        // 0 for ClosedForm
+        std::size_t m_numPaths;
+        double m_elapsedMs;
+    };
+
+    struct ReturnShape
+    {
+        double m_skewness;
+        double m_excessKurtosis;
+    };
+
+    ReturnShape ComputeReturnShape(const std::vector<double>& returns);
+
+    // mean, VaR and CVaR of the simple return exp(X) - 1 with X ~ N(days * stepDrift, days * stepStdDev^2)
+    HorizonRisk GaussianRisk(double stepDrift, double stepStdDev, std::size_t days, double confidence = 0.95);
+
+    /*
+    The same with the standard normal replaced by its Cornish-Fisher expansion in the skewness and excess
+    kurtosis of one step, which shrink by sqrt(days) and days over the horizon for i.i.d. steps. VaR is the
+    expanded quantile; mean and CVaR integrate the expanded variable over the normal density. The expansion
+    is only monotone for moderate skewness and kurtosis.
+    */
+    HorizonRisk CornishFisherRisk(double stepDrift, double stepStdDev, const ReturnShape& stepShape, std::size_t days, double confidence = 0.95);
+
+    template <typename Real>
+    Evaluation Evaluate(
+        const BasicMonteCarloEngine<Real>& engine,
+        const Eigen::MatrixXd& choleskyMatrix,
+        const std::vector<std::pair<double, double>>& assetStatistics,
+        const std::vector<double>& weights,
+        const Query& query);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+Fixed-range histogram that keeps a mass and a running sum per bin, plus an underflow and an overflow bin.
+Quantiles interpolate inside the bin that crosses the level; tail means use the exact sums of the bins
+below it, so CVaR only carries the interpolation error of one partial bin. Sketches over the same range
+merge by adding bins, which lets parallel chunks reduce their own and fold them together afterwards.
+
+A sample's mass is one unless it is given a weight, e.g. an importance-sampling likelihood ratio with unit
+mean. Levels and means are taken against the number of samples rather than the total mass, which is what
+makes weighted quantiles and tail means those of the target distribution.
+*/
+class HistogramSketch
+{
+private:
+    double m_lower = 0.0;
+    double m_upper = 0.0;
+    double m_binWidth = 0.0;
+    double m_invBinWidth = 0.0;
+
+    // [0] underflow, [1..numBins] the range, [numBins + 1] overflow
+    std::vector<double> m_masses;
+    std::vector<double> m_sums;
+    uint64_t m_total = 0;
+
+public:
+    HistogramSketch() = default;
+    HistogramSketch(double lower, double upper, std::size_t numBins);
+
+    void Add(double value, double weight = 1.0)
+    {
+        const double position = (value - m_lower) * m_invBinWidth;
+        const std::size_t numBins = m_masses.size() - 2;
+
+        std::size_t bin = 0;
+        if(position >= 0.0)
+        {
+            bin = (position < static_cast<double>(numBins)) ? static_cast<std::size_t>(position) + 1 : numBins + 1;
+        }
+
+        m_masses[bin] += weight;
+        m_sums[bin] += weight * value;
+        ++m_total;
+    }
+
+    void Merge(const HistogramSketch& other);
+
+    // flat image of the bins (masses, then sums) and the sample count, so a sketch can cross a process boundary through shared memory
+    std::size_t GetSerialisedSize() const;
+    void Serialise(void* out) const;
+    // reads an image written by a sketch with the same range and resolution
+    void Deserialise(const void* in);
+
+    // number of samples added, whatever their weights
+    uint64_t GetCount() const;
+    double GetMean() const;
+    // value below which a fraction p of the samples lie
+    double Quantile(double p) const;
+    // mean of the samples at or below Quantile(p)
+    double TailMean(double p) const;
+};
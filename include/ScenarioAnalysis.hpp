@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Eigen/Dense"
+
+#include "FactorModel.hpp"
+
+/*
+Deterministic stress testing. Every scenario is one vector of simple asset returns over its horizon:
+historical windows replayed from the aligned returns matrix, hypothetical per-asset or factor moves,
+or draws from a stressed covariance (volatilities scaled up, correlations blended towards one). The
+scenarios sit side by side as the columns of one dense assets x scenarios matrix, so the P&L of any
+number of portfolios under every scenario is a single matrix product.
+*/
+namespace ScenarioAnalysis
+{
+    struct ScenarioSet
+    {
+        std::size_t m_numAssets = 0;
+        std::vector<std::string> m_names;
+        // column-major assets x scenarios, so adding a scenario appends one column
+        std::vector<double> m_assetReturns;
+
+        std::size_t GetNumScenarios() const
+        {
+            return m_names.size();
+        }
+
+        Eigen::Map<const Eigen::MatrixXd> Matrix() const
+        {
+            return { m_assetReturns.data(), static_cast<Eigen::Index>(m_numAssets), static_cast<Eigen::Index>(GetNumScenarios()) };
+        }
+    };
+
+    struct WorstCase
+    {
+        std::size_t m_scenario;
+        double m_pnl;
+    };
+
+    // a hypothetical move, the simple return of every asset
+    void AddShock(ScenarioSet& scenarios, const std::string& name, const std::vector<double>& assetReturns);
+
+    // the compounded return of every asset over the rows of a days x assets log-returns matrix whose date falls
+    // in [firstDate, lastDate]; dates compare as ISO strings on the bounds' length, so "2020-02" to "2020-03"
+    // covers February and March 2020. days with a non-finite return for any asset are skipped; returns false,
+    // adding nothing, when the data holds no usable day of the window
+    bool AddHistoricalWindow(
+        ScenarioSet& scenarios,
+        const std::string& name,
+        const std::vector<std::vector<double>>& logReturnsMat,
+        const std::vector<std::string>& dates,
+        const std::string& firstDate,
+        const std::string& lastDate);
+
+    // factor moves in standard deviations over the horizon, mapped to asset log-returns through the (annualised) loadings
+    void AddFactorShock(ScenarioSet& scenarios, const std::string& name, const FactorLoadings& model, const Eigen::VectorXd& factorMoves, std::size_t horizonDays);
+
+    // annualised covariance with every volatility scaled by its multiplier and the correlations blended towards
+    // one, (1 - blend) * rho + blend; blend = 1 is the everything-falls-together limit
+    std::vector<std::vector<double>> StressCovariance(const std::vector<std::vector<double>>& covMatrix, const std::vector<double>& volMultipliers, double correlationBlend);
+
+    // numScenarios zero-drift Gaussian moves over the horizon under an annualised (typically stressed) covariance,
+    // named "<name>/<index>"; the draws depend only on the seed
+    void AddSampledScenarios(ScenarioSet& scenarios, const std::string& name, const std::vector<std::vector<double>>& covMatrix, std::size_t numScenarios, std::size_t horizonDays, uint64_t seed);
+
+    // scenarios x portfolios P&L of every column of holdings (assets x portfolios), so each portfolio's outcomes are
+    // contiguous. weights give returns, currency exposures give P&L in currency
+    Eigen::MatrixXd EvaluatePnL(const ScenarioSet& scenarios, const Eigen::MatrixXd& holdings);
+
+    // the most damaging scenario of every portfolio (column) of a P&L matrix
+    std::vector<WorstCase> FindWorstCases(const Eigen::MatrixXd& pnl);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "MonteCarloEngine.hpp"
+
+struct ShardedRunConfig
+{
+    // created if missing; holds the manifest and one file per shard
+    std::string m_directory;
+    std::size_t m_numPaths = 0;
+    std::size_t m_numDays = 252;
+    std::size_t m_pathsPerShard = 1000000;
+    // shard i is generated by BasicMonteCarloEngine(m_seed, i), whatever else has run before it
+    uint64_t m_seed = 0;
+};
+
+struct ShardInfo
+{
+    std::size_t m_index = 0;
+    std::size_t m_firstPath = 0;
+    std::size_t m_numPaths = 0;
+    // closed-form per-step moments reported by the generator, used to size the reducers' sketches
+    double m_stepDrift = 0.0;
+    double m_stepStdDev = 0.0;
+};
+
+/*
+Plain-text description of a sharded run. Shard files are raw path-major arrays of the run's Real, numPaths x
+numDays each, and a shard is listed here only after its file is complete and synced. The manifest is synced
+before it replaces the old one and the directory after, so whatever it lists survives a crash (on Linux;
+elsewhere durability is left to the OS).
+*/
+struct ShardManifest
+{
+    std::size_t m_numPaths = 0;
+    std::size_t m_numDays = 0;
+    std::size_t m_pathsPerShard = 0;
+    uint64_t m_seed = 0;
+    // sizeof(Real) of the stored values
+    std::size_t m_valueSize = 0;
+    SimulationOutput m_output = SimulationOutput::LogReturns;
+    double m_initialPrice = 1.0;
+
+    // completed shards, in the order they finished
+    std::vector<ShardInfo> m_completed;
+
+    std::size_t GetNumShards() const
+    {
+        return m_pathsPerShard == 0 ? 0 : (m_numPaths + m_pathsPerShard - 1) / m_pathsPerShard;
+    }
+
+    bool IsComplete() const
+    {
+        return m_completed.size() == GetNumShards();
+    }
+};
+
+namespace ShardedSimulation
+{
+    // generates numPaths paths of the run's model with the given engine, which writes them straight into the
+    // shard's file; options must be passed through to the engine unchanged
+    template <typename Real>
+    using ShardGenerator = std::function<BasicReturns<Real>(const BasicMonteCarloEngine<Real>& engine, std::size_t numPaths, const SimulationOptions& options)>;
+
+    // called with the paths of one shard (path-major, numDays per path), valid only for the duration of the call
+    template <typename Real>
+    using ShardVisitor = std::function<void(const Real* paths, const ShardInfo& shard)>;
+
+    // generates every shard not yet listed in the directory's manifest, straight into a memory-mapped file, and
+    // records it once it is on disk. rerunning after an interruption resumes at the first missing shard; a
+    // manifest written for a different configuration throws. paths must be stored, and importance weights,
+    // path metrics and checkpoints are per shard and not kept
+    template <typename Real>
+    ShardManifest Run(const ShardedRunConfig& config, const ShardGenerator<Real>& generate, const SimulationOptions& options = {});
+
+    // false when the directory has no manifest
+    bool LoadManifest(const std::string& directory, ShardManifest& manifest);
+    std::string ShardPath(const std::string& directory, std::size_t shard);
+
+    // maps the completed shards one at a time, in path order, so memory use is one shard however long the run
+    template <typename Real>
+    void ForEachShard(const std::string& directory, const ShardVisitor<Real>& visit);
+
+    // mean, VaR and CVaR of the terminal simple return over every completed shard, streamed through a histogram sketch
+    template <typename Real>
+    HorizonRisk ReduceTerminalRisk(const std::string& directory, double confidence = 0.95);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+enum class HugePages
+{
+    None,
+    // ask the kernel to back the buffer with transparent huge pages (madvise)
+    Transparent,
+    // map from the explicit hugetlbfs pool, falling back to normal pages if it is empty
+    Explicit
+};
+
+namespace SimulationMemory
+{
+    // process-wide policy applied to every simulation buffer allocated afterwards
+    void SetHugePagePolicy(HugePages policy);
+    HugePages GetHugePagePolicy();
+
+    // large buffers are mapped lazily so no page is touched until a worker writes to it
+    void* Allocate(std::size_t bytes);
+    void Deallocate(void* ptr, std::size_t bytes) noexcept;
+}
+
+/*
+Allocator for simulation output. resize() default-initialises instead of zero-filling, so the
+pages of a multi-GB buffer are first touched (and placed on the NUMA node of) the worker thread
+that writes them, rather than all being faulted in serially by the calling thread.
+*/
+template <typename T>
+class SimulationAllocator
+{
+public:
+    using value_type = T;
+
+    SimulationAllocator() noexcept = default;
+
+    template <typename U>
+    SimulationAllocator(const SimulationAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(SimulationMemory::Allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, std::size_t n) noexcept
+    {
+        SimulationMemory::Deallocate(ptr, n * sizeof(T));
+    }
+
+    template <typename U>
+    void construct(U* ptr) noexcept
+    {
+        ::new (static_cast<void*>(ptr)) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* ptr, Args&&... args)
+    {
+        ::new (static_cast<void*>(ptr)) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    bool operator==(const SimulationAllocator<U>&) const noexcept { return true; }
+};
+
+template <typename T>
+using SimulationVector = std::vector<T, SimulationAllocator<T>>;
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+struct ThreadPoolConfig
+{
+    // total threads taking part in a parallel call, including the calling thread (0 = hardware concurrency)
+    std::size_t m_numThreads = 0;
+    // pin each worker to one CPU, taken round-robin from m_cpus (or from all online CPUs if empty)
+    bool m_pinThreads = false;
+    std::vector<int> m_cpus;
+};
+
+/*
+Process-wide work-stealing pool shared by every parallel kernel.
+
+A parallel call is cut into chunks which are dealt out to the per-worker deques in contiguous
+blocks (so neighbouring chunks tend to stay on one core). Workers pop from the front of their
+own deque and steal from the back of the others once it runs dry, which evens out tail
+imbalance. The calling thread always helps, so nested calls from inside a chunk cannot deadlock.
+*/
+class ThreadPool
+{
+public:
+    using RangeFunc = std::function<void(std::size_t, std::size_t)>;
+
+    explicit ThreadPool(const ThreadPoolConfig& config = {});
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    static ThreadPool& Instance();
+    // replaces the process-wide pool; must not be called while parallel work is in flight
+    static void Configure(const ThreadPoolConfig& config);
+    // for a child process after fork(): the inherited pool's workers do not exist there, so it is abandoned
+    // rather than joined and a fresh one is built. fork only while no parallel work is in flight
+    static void ReinitialiseAfterFork(const ThreadPoolConfig& config);
+
+    std::size_t GetNumThreads() const;
+
+    // runs body(chunkBegin, chunkEnd) over [begin, end) split into chunks of grainSize (0 = automatic)
+    void ParallelFor(std::size_t begin, std::size_t end, const RangeFunc& body, std::size_t grainSize = 0);
+
+    // maps every chunk to a partial result and folds the partials in chunk order, so the result is deterministic
+    template <typename T, typename MapFunc, typename ReduceFunc>
+    T ParallelReduce(std::size_t begin, std::size_t end, T identity, MapFunc&& map, ReduceFunc&& reduce, std::size_t grainSize = 0)
+    {
+        if (end <= begin)
+            return identity;
+
+        const std::size_t grain = ResolveGrainSize(end - begin, grainSize);
+        const std::size_t numChunks = (end - begin + grain - 1) / grain;
+
+        std::vector<T> partials(numChunks, identity);
+        ParallelFor(0, numChunks, [&](std::size_t chunkBegin, std::size_t chunkEnd) {
+            for (std::size_t chunk = chunkBegin; chunk < chunkEnd; ++chunk)
+            {
+                const std::size_t first = begin + chunk * grain;
+                const std::size_t last = std::min(end, first + grain);
+                partials[chunk] = map(first, last);
+            }
+        }, 1);
+
+        T result = identity;
+        for (T& partial : partials)
+        {
+            result = reduce(std::move(result), std::move(partial));
+        }
+
+        return result;
+    }
+
+private:
+    struct Job
+    {
+        const RangeFunc* m_body;
+        std::atomic<std::size_t> m_remaining;
+        std::atomic<bool> m_failed{false};
+        std::exception_ptr m_exception;
+        std::mutex m_exceptionMutex;
+    };
+
+    struct Task
+    {
+        std::shared_ptr<Job> m_job;
+        std::size_t m_begin;
+        std::size_t m_end;
+    };
+
+    struct WorkQueue
+    {
+        std::mutex m_mutex;
+        std::deque<Task> m_tasks;
+    };
+
+    std::size_t ResolveGrainSize(std::size_t count, std::size_t grainSize) const;
+    void WorkerLoop(std::size_t workerIdx);
+    bool TryPopTask(std::size_t queueIdx, Task& task);
+    bool TryStealTask(std::size_t thiefIdx, Task& task);
+    bool TryRunOneTask(std::size_t preferredQueue);
+    void RunTask(const Task& task);
+    void PinWorker(std::thread& worker, std::size_t workerIdx);
+
+    ThreadPoolConfig m_config;
+    std::size_t m_numThreads;
+
+    // one queue per worker plus one for submissions from outside the pool
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+    std::vector<std::thread> m_workers;
+
+    std::atomic<std::size_t> m_pendingTasks{0};
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeCondition;
+    bool m_stop = false;
+};
@@ -3,9 +3,9 @@ import matplotlib.pyplot as plt
 import argparse
 import sys
 
-def plot_paths_from_csv(filepath, sample_size, ci_bands):
+def read_csv_or_exit(filepath, **kwargs):
     try:
-        df = pd.read_csv(filepath, header=None)
+        return pd.read_csv(filepath, **kwargs)
     except FileNotFoundError:
         print(f"Error: The file '{filepath}' was not found.")
         sys.exit(1)
@@ -13,7 +13,18 @@ def plot_paths_from_csv(filepath, sample_size, ci_bands):
         print(f"Error: The file '{filepath}' is empty.")
         sys.exit(1)
 
+def band_column(bands_df, level):
+    for column in bands_df.columns[1:]:
+        if abs(float(column[1:]) - level) < 1e-9:
+            return column
+    print(f"Error: The bands file has no {level} quantile.")
+    sys.exit(1)
+
+def plot_paths_from_csv(filepath, sample_size, ci_bands, bands_filepath=None):
+    df = read_csv_or_exit(filepath, header=None)
+
     paths_df = df.T
+    paths_df.index = paths_df.index + 1
     n_paths = len(paths_df.columns)
 
     plt.figure(figsize=(12, 7))
@@ -29,24 +40,31 @@ def plot_paths_from_csv(filepath, sample_size, ci_bands):
                  lw=0.5, 
                  label='_nolegend_')
 
+    # bands computed by the engine over every simulated path; otherwise only the paths in the file are available
+    if bands_filepath:
+        bands_df = read_csv_or_exit(bands_filepath).set_index('Day', drop=False)
+        quantile = lambda level: bands_df[band_column(bands_df, level)]
+    else:
+        quantile = lambda level: paths_df.quantile(level, axis=1)
+
     if ci_bands:
-        q_lower_outer = paths_df.quantile(0.05, axis=1)
-        q_upper_outer = paths_df.quantile(0.95, axis=1)
+        q_lower_outer = quantile(0.05)
+        q_upper_outer = quantile(0.95)
         
-        q_lower_inner = paths_df.quantile(0.25, axis=1)
-        q_upper_inner = paths_df.quantile(0.75, axis=1)
+        q_lower_inner = quantile(0.25)
+        q_upper_inner = quantile(0.75)
     
-    median_path = paths_df.quantile(0.5, axis=1)
+    median_path = quantile(0.5)
     
     if ci_bands:
-        plt.fill_between(paths_df.index, 
+        plt.fill_between(q_lower_outer.index, 
                         q_lower_outer, 
                         q_upper_outer, 
                         color='C0', 
                         alpha=0.2, 
                         label='90% Interval (5th-95th percentile)')
     
-        plt.fill_between(paths_df.index, 
+        plt.fill_between(q_lower_inner.index, 
                         q_lower_inner, 
                         q_upper_inner, 
                         color='C0', 
@@ -74,7 +92,7 @@ def main():
     
     parser.add_argument(
         "filepath", 
-        help="Path to the CSV file containing simulation paths."
+        help="Path to the CSV file containing simulation paths (or the engine's sampled paths)."
     )
     parser.add_argument(
         "-n", "--sample_size", 
@@ -82,6 +100,12 @@ def main():
         default=50,
         help="Number of random sample paths to plot for background texture."
     )
+    parser.add_argument(
+        "-b", "--bands",
+        dest="bands_filepath",
+        default=None,
+        help="Bands CSV written by the engine (Day,Q0.05,...), used instead of quantiles of the sampled paths."
+    )
     parser.add_argument(
         "--no-bands", 
         action="store_false",
@@ -93,7 +117,8 @@ def main():
     
     plot_paths_from_csv(args.filepath, 
                         args.sample_size, 
-                        args.ci_bands)
+                        args.ci_bands,
+                        args.bands_filepath)
     
 if __name__ == "__main__":
     main()
\ No newline at end of file
@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+#include <limits>
+
+#include "../include/AdaptiveMonteCarlo.hpp"
+#include "../include/MathUtils.hpp"
+#include "../include/QuantileSelection.hpp"
+
+namespace
+{
+    struct BatchStatistics
+    {
+        double m_mean;
+        double m_VaR;
+        double m_CVaR;
+        std::vector<double> m_quantiles;
+    };
+
+    // VaR, CVaR and every tracked quantile from one parallel selection over the outcomes
+    BatchStatistics ComputeStatistics(const std::vector<double>& outcomes, double confidence, const std::vector<double>& quantileLevels)
+    {
+        const std::size_t n = outcomes.size();
+        assert(n > 0);
+
+        BatchStatistics stats;
+        stats.m_mean = std::accumulate(outcomes.begin(), outcomes.end(), 0.0) / static_cast<double>(n);
+
+        std::vector<double> levels = { 1.0 - confidence };
+        levels.insert(levels.end(), quantileLevels.begin(), quantileLevels.end());
+        const std::vector<QuantileSelection::OrderStatistic> selected = QuantileSelection::Select(outcomes, levels);
+
+        stats.m_VaR = -selected[0].m_value;
+        stats.m_CVaR = -selected[0].m_tailMean;
+
+        stats.m_quantiles.reserve(quantileLevels.size());
+        for(std::size_t i = 1; i < selected.size(); ++i)
+        {
+            stats.m_quantiles.push_back(selected[i].m_value);
+        }
+
+        return stats;
+    }
+
+    // share of the remaining budget a batch is planned to fill, leaving room for the pooled statistics and timing noise
+    constexpr double DEADLINE_SAFETY = 0.8;
+
+    // per-batch statistics and the number of paths behind each, since batches shrink as a deadline nears
+    struct BatchHistory
+    {
+        std::vector<std::size_t> m_sizes;
+        std::vector<double> m_means;
+        std::vector<double> m_VaRs;
+        std::vector<double> m_CVaRs;
+        std::vector<std::vector<double>> m_quantiles;
+    };
+
+    double WeightedAverage(const std::vector<double>& values, const std::vector<std::size_t>& sizes, std::size_t numPaths)
+    {
+        double sum = 0.0;
+        for(std::size_t b = 0; b < values.size(); ++b)
+        {
+            sum += static_cast<double>(sizes[b]) * values[b];
+        }
+        return sum / static_cast<double>(numPaths);
+    }
+
+    // batch-means error: a batch statistic over n paths has variance of about sigma^2 / n, so the size-weighted
+    // spread of the batch values estimates sigma^2 and the pooled value over N paths has error sigma / sqrt(N).
+    // with equal batches this is the familiar spread of the batch values over sqrt(numBatches)
+    double BatchStandardError(const std::vector<double>& values, const std::vector<std::size_t>& sizes, std::size_t numPaths)
+    {
+        const std::size_t numBatches = values.size();
+        if(numBatches < 2)
+            return std::numeric_limits<double>::infinity();
+
+        const double mean = WeightedAverage(values, sizes, numPaths);
+        double variance = 0.0;
+        for(std::size_t b = 0; b < numBatches; ++b)
+        {
+            variance += static_cast<double>(sizes[b]) * (values[b] - mean) * (values[b] - mean);
+        }
+        variance /= static_cast<double>(numBatches - 1);
+
+        return std::sqrt(variance / static_cast<double>(numPaths));
+    }
+
+    AdaptiveMonteCarlo::Estimate MakeEstimate(double value, double standardError, double z)
+    {
+        return { value, standardError, value - z * standardError, value + z * standardError };
+    }
+
+    bool HasConverged(const AdaptiveMonteCarlo::Estimate& estimate, const AdaptiveMonteCarlo::Config& config)
+    {
+        const double halfWidth = estimate.m_upper - estimate.m_value;
+        return halfWidth <= std::max(config.m_absoluteTolerance, config.m_relativeTolerance * std::abs(estimate.m_value));
+    }
+
+    /*
+    Paths the next batch should simulate, or zero when no batch worth running fits before the deadline.
+    Without a budget every batch is a full one. With a budget the first batch is a small pilot that measures
+    the throughput (everything per path included: simulation, statistics, progress updates), and each later
+    batch is sized from it to fill a safe share of the remaining time, spread over the batches still needed
+    for an error estimate, so the loop never starts work it does not expect to finish in time.
+    */
+    std::size_t PlanBatch(const AdaptiveMonteCarlo::Config& config, std::size_t numPaths, std::size_t numBatches, double elapsedMs)
+    {
+        const std::size_t capacity = std::min(config.m_batchSize, config.m_maxPaths - numPaths);
+        if(config.m_timeBudget.count() <= 0)
+            return capacity;
+
+        if(numBatches == 0)
+            return std::min(config.m_minBatchSize, capacity);
+
+        const double remainingMs = static_cast<double>(config.m_timeBudget.count()) - elapsedMs;
+        const double pathsPerMs = static_cast<double>(numPaths) / std::max(elapsedMs, 1e-3);
+        const double affordable = DEADLINE_SAFETY * std::max(remainingMs, 0.0) * pathsPerMs;
+        const std::size_t batchesNeeded = (numBatches < config.m_minBatches) ? config.m_minBatches - numBatches : 1;
+
+        const std::size_t smallest = std::min(config.m_minBatchSize, capacity);
+        if(affordable < static_cast<double>(smallest))
+            return 0;
+
+        // too tight for all the batches still wanted: fewer, smallest batches still narrow the interval
+        return std::clamp(static_cast<std::size_t>(affordable / static_cast<double>(batchesNeeded)), smallest, capacity);
+    }
+
+    // point estimates come from the pooled sample, which is less biased than the average of batch quantiles
+    AdaptiveMonteCarlo::Result Summarise(const std::vector<double>& outcomes, const BatchHistory& history, const AdaptiveMonteCarlo::Config& config, double z)
+    {
+        const std::size_t numPaths = outcomes.size();
+        const BatchStatistics pooled = ComputeStatistics(outcomes, config.m_confidence, config.m_quantiles);
+
+        AdaptiveMonteCarlo::Result result;
+        result.m_mean = MakeEstimate(pooled.m_mean, BatchStandardError(history.m_means, history.m_sizes, numPaths), z);
+        result.m_VaR = MakeEstimate(pooled.m_VaR, BatchStandardError(history.m_VaRs, history.m_sizes, numPaths), z);
+        result.m_CVaR = MakeEstimate(pooled.m_CVaR, BatchStandardError(history.m_CVaRs, history.m_sizes, numPaths), z);
+        result.m_quantileLevels = config.m_quantiles;
+        for(std::size_t q = 0; q < config.m_quantiles.size(); ++q)
+        {
+            result.m_quantiles.push_back(MakeEstimate(pooled.m_quantiles[q], BatchStandardError(history.m_quantiles[q], history.m_sizes, numPaths), z));
+        }
+
+        result.m_numPaths = numPaths;
+        result.m_numBatches = history.m_sizes.size();
+        result.m_stopReason = AdaptiveMonteCarlo::StopReason::Running;
+        return result;
+    }
+}
+
+namespace AdaptiveMonteCarlo
+{
+    Result Run(const BatchSimulator& simulateBatch, const Config& config, const ProgressCallback& onProgress)
+    {
+        assert(config.m_batchSize > 0 && config.m_minBatchSize > 0 && config.m_maxPaths > 0);
+        assert(config.m_confidence > 0.0 && config.m_confidence < 1.0);
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto elapsedMs = [start]() {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+        const double z = MathUtils::NormalQuantile(0.5 * (1.0 + config.m_ciLevel));
+        const std::size_t numQuantiles = config.m_quantiles.size();
+
+        std::vector<double> outcomes;
+        BatchHistory history;
+        history.m_quantiles.resize(numQuantiles);
+
+        StopReason stopReason = StopReason::MaxPaths;
+        while(outcomes.size() < config.m_maxPaths)
+        {
+            const std::size_t batchPaths = PlanBatch(config, outcomes.size(), history.m_sizes.size(), elapsedMs());
+            if(batchPaths == 0)
+            {
+                stopReason = StopReason::TimeBudget;
+                break;
+            }
+
+            std::vector<double> batch = simulateBatch(batchPaths);
+            for(double& logReturn : batch)
+            {
+                logReturn = std::expm1(logReturn);
+            }
+            outcomes.insert(outcomes.end(), batch.begin(), batch.end());
+
+            const BatchStatistics stats = ComputeStatistics(batch, config.m_confidence, config.m_quantiles);
+            history.m_sizes.push_back(batch.size());
+            history.m_means.push_back(stats.m_mean);
+            history.m_VaRs.push_back(stats.m_VaR);
+            history.m_CVaRs.push_back(stats.m_CVaR);
+            for(std::size_t q = 0; q < numQuantiles; ++q)
+            {
+                history.m_quantiles[q].push_back(stats.m_quantiles[q]);
+            }
+
+            if(onProgress)
+            {
+                Result snapshot = Summarise(outcomes, history, config, z);
+                snapshot.m_elapsedMs = elapsedMs();
+                onProgress(snapshot);
+            }
+
+            if(config.m_timeBudget.count() > 0 && elapsedMs() >= static_cast<double>(config.m_timeBudget.count()))
+            {
+                stopReason = StopReason::TimeBudget;
+                break;
+            }
+
+            if(history.m_sizes.size() < config.m_minBatches)
+                continue;
+
+            const double tailSamples = (1.0 - config.m_confidence) * static_cast<double>(outcomes.size());
+            if(tailSamples < static_cast<double>(config.m_minTailSamples))
+                continue;
+
+            const std::size_t numPaths = outcomes.size();
+            const auto estimate = [&](const std::vector<double>& values) {
+                return MakeEstimate(WeightedAverage(values, history.m_sizes, numPaths), BatchStandardError(values, history.m_sizes, numPaths), z);
+            };
+
+            bool converged = HasConverged(estimate(history.m_means), config)
+                          && HasConverged(estimate(history.m_VaRs), config)
+                          && HasConverged(estimate(history.m_CVaRs), config);
+            for(std::size_t q = 0; q < numQuantiles && converged; ++q)
+            {
+                converged = HasConverged(estimate(history.m_quantiles[q]), config);
+            }
+
+            if(converged)
+            {
+                stopReason = StopReason::Converged;
+                break;
+            }
+        }
+
+        Result result = Summarise(outcomes, history, config, z);
+        result.m_stopReason = stopReason;
+        result.m_elapsedMs = elapsedMs();
+
+        return result;
+    }
+}
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "../include/FactorModel.hpp"
+
+namespace
+{
+    constexpr double TRADING_DAYS = 252.0;
+
+    // idiosyncratic variance never drops below this fraction of an asset's total, so every asset keeps some noise of its own
+    constexpr double MIN_IDIOSYNCRATIC_SHARE = 1e-6;
+}
+
+namespace FactorModel
+{
+    /*
+    With X the centred days x assets returns, the covariance is C = X^T X / (T - 1). When there are fewer days
+    than assets the eigenvectors come from the T x T Gram matrix instead: if X X^T u = (T - 1) lambda u then
+    X^T u is an eigenvector of C with the same eigenvalue and norm sqrt((T - 1) lambda), so the loading column
+    sqrt(lambda) v is simply X^T u / sqrt(T - 1). Either way the decomposition is of the smaller of the two
+    sizes, and only the diagonal of C is ever needed in full.
+    */
+    FactorLoadings FitStatistical(const std::vector<std::vector<double>>& logReturnsMat, std::size_t numFactors, bool annualise)
+    {
+        assert(!logReturnsMat.empty());
+
+        // days with a non-finite return for any asset (GetLogReturnsMat marks non-positive prices so) are dropped whole,
+        // otherwise one missing price would turn every loading into NaN
+        std::vector<std::size_t> usableDays;
+        usableDays.reserve(logReturnsMat.size());
+        for(std::size_t t = 0; t < logReturnsMat.size(); ++t)
+        {
+            if(std::all_of(logReturnsMat[t].begin(), logReturnsMat[t].end(), [](double value) { return std::isfinite(value); }))
+            {
+                usableDays.push_back(t);
+            }
+        }
+
+        const std::size_t numPeriods = usableDays.size();
+        const std::size_t numAssets = logReturnsMat[0].size();
+        assert(numPeriods > 1 && numFactors > 0 && numFactors <= std::min(numPeriods - 1, numAssets));
+
+        Eigen::MatrixXd centred(static_cast<Eigen::Index>(numPeriods), static_cast<Eigen::Index>(numAssets));
+        for(std::size_t t = 0; t < numPeriods; ++t)
+        {
+            for(std::size_t asset = 0; asset < numAssets; ++asset)
+            {
+                centred(static_cast<Eigen::Index>(t), static_cast<Eigen::Index>(asset)) = logReturnsMat[usableDays[t]][asset];
+            }
+        }
+        centred.rowwise() -= centred.colwise().mean();
+
+        const double scale = (annualise ? TRADING_DAYS : 1.0) / static_cast<double>(numPeriods - 1);
+        const Eigen::Index k = static_cast<Eigen::Index>(numFactors);
+
+        FactorLoadings model;
+        if(numPeriods < numAssets)
+        {
+            const Eigen::MatrixXd gram = scale * (centred * centred.transpose());
+            Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(gram);
+            assert(solver.info() == Eigen::Success);
+
+            // eigenvalues come back ascending, the leading factors are the last columns
+            const Eigen::MatrixXd leading = solver.eigenvectors().rightCols(k).rowwise().reverse();
+            model.m_loadings = std::sqrt(scale) * (centred.transpose() * leading);
+        }
+        else
+        {
+            const Eigen::MatrixXd covariance = scale * (centred.transpose() * centred);
+            Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(covariance);
+            assert(solver.info() == Eigen::Success);
+
+            const Eigen::VectorXd eigenvalues = solver.eigenvalues().tail(k).reverse().cwiseMax(0.0);
+            model.m_loadings = solver.eigenvectors().rightCols(k).rowwise().reverse() * eigenvalues.cwiseSqrt().asDiagonal();
+        }
+
+        const Eigen::VectorXd totalVariance = scale * centred.colwise().squaredNorm().transpose();
+        const Eigen::VectorXd residual = totalVariance - model.m_loadings.rowwise().squaredNorm();
+        model.m_idiosyncraticVols = residual.cwiseMax(MIN_IDIOSYNCRATIC_SHARE * totalVariance).cwiseSqrt();
+        return model;
+    }
+
+    FactorLoadings FromLoadings(const Eigen::MatrixXd& loadings, const std::vector<double>& assetVols)
+    {
+        assert(static_cast<std::size_t>(loadings.rows()) == assetVols.size());
+
+        FactorLoadings model;
+        model.m_loadings = loadings;
+        model.m_idiosyncraticVols.resize(loadings.rows());
+        for(Eigen::Index asset = 0; asset < loadings.rows(); ++asset)
+        {
+            const double totalVariance = assetVols[static_cast<std::size_t>(asset)] * assetVols[static_cast<std::size_t>(asset)];
+            model.m_idiosyncraticVols(asset) = std::sqrt(std::max(totalVariance - loadings.row(asset).squaredNorm(), 0.0));
+        }
+
+        return model;
+    }
+}
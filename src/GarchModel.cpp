@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <iterator>
+#include <numbers>
+#include <numeric>
+
+#include "../include/GarchModel.hpp"
+#include "../include/ThreadPool.hpp"
+
+namespace
+{
+    constexpr std::size_t NUM_PARAMS = 4;
+    using Vector = std::array<double, NUM_PARAMS>;
+    using Matrix = std::array<Vector, NUM_PARAMS>;
+
+    // alpha + beta is kept strictly below one so the fitted process stays covariance stationary
+    constexpr double MAX_PERSISTENCE = 0.9999;
+
+    double Sigmoid(double x)
+    {
+        return 1.0 / (1.0 + std::exp(-x));
+    }
+
+    double Logit(double p)
+    {
+        return std::log(p / (1.0 - p));
+    }
+
+    double Dot(const Vector& a, const Vector& b)
+    {
+        return std::inner_product(a.begin(), a.end(), b.begin(), 0.0);
+    }
+
+    /*
+    The optimiser works on standardised returns (unit sample variance) and on unconstrained coordinates
+        x = { mu, log(omega), logit(persistence / MAX_PERSISTENCE), logit(alpha / persistence) }
+    so every point it visits is a valid stationary GARCH(1,1).
+    */
+    struct Model
+    {
+        const std::vector<double>& m_returns;
+        double m_backcast;
+
+        GarchParams ToParams(const Vector& x) const
+        {
+            const double persistence = MAX_PERSISTENCE * Sigmoid(x[2]);
+            const double share = Sigmoid(x[3]);
+
+            GarchParams params;
+            params.m_mu = x[0];
+            params.m_omega = std::exp(x[1]);
+            params.m_alpha = persistence * share;
+            params.m_beta = persistence * (1.0 - share);
+            return params;
+        }
+
+        Vector FromParams(const GarchParams& params) const
+        {
+            const double persistence = std::clamp(params.m_alpha + params.m_beta, 1e-4, MAX_PERSISTENCE * (1.0 - 1e-6));
+            const double share = std::clamp(params.m_alpha / persistence, 1e-4, 1.0 - 1e-4);
+            return { params.m_mu, std::log(params.m_omega), Logit(persistence / MAX_PERSISTENCE), Logit(share) };
+        }
+
+        // mean negative log-likelihood (constants dropped) and its gradient in x, from one forward pass that
+        // carries the derivatives of h_t with respect to (mu, omega, alpha, beta) alongside the recursion
+        double Evaluate(const Vector& x, Vector& gradient) const
+        {
+            const GarchParams params = ToParams(x);
+            const double n = static_cast<double>(m_returns.size());
+
+            double variance = m_backcast;
+            Vector dVariance{};
+            Vector dLoss{};
+            double loss = 0.0;
+
+            for(double r : m_returns)
+            {
+                const double residual = r - params.m_mu;
+                const double residualSq = residual * residual;
+                const double invVariance = 1.0 / variance;
+
+                loss += std::log(variance) + residualSq * invVariance;
+
+                // d/dtheta of log h + e^2 / h = (1/h - e^2/h^2) dh/dtheta, plus -2e/h through mu directly
+                const double scale = invVariance * (1.0 - residualSq * invVariance);
+                for(std::size_t k = 0; k < NUM_PARAMS; ++k)
+                {
+                    dLoss[k] += scale * dVariance[k];
+                }
+                dLoss[0] -= 2.0 * residual * invVariance;
+
+                // h_t+1 = omega + alpha e_t^2 + beta h_t
+                dVariance[0] = -2.0 * params.m_alpha * residual + params.m_beta * dVariance[0];
+                dVariance[1] = 1.0 + params.m_beta * dVariance[1];
+                dVariance[2] = residualSq + params.m_beta * dVariance[2];
+                dVariance[3] = variance + params.m_beta * dVariance[3];
+                variance = params.m_omega + params.m_alpha * residualSq + params.m_beta * variance;
+            }
+
+            // chain rule from (mu, omega, alpha, beta) to the unconstrained coordinates
+            const double sigmaP = Sigmoid(x[2]);
+            const double sigmaS = Sigmoid(x[3]);
+            const double persistence = MAX_PERSISTENCE * sigmaP;
+            const double dPersistence = MAX_PERSISTENCE * sigmaP * (1.0 - sigmaP);
+            const double dShare = sigmaS * (1.0 - sigmaS);
+
+            const double scale = 0.5 / n;
+            gradient[0] = scale * dLoss[0];
+            gradient[1] = scale * dLoss[1] * params.m_omega;
+            gradient[2] = scale * (dLoss[2] * dPersistence * sigmaS + dLoss[3] * dPersistence * (1.0 - sigmaS));
+            gradient[3] = scale * (dLoss[2] - dLoss[3]) * persistence * dShare;
+
+            return scale * loss;
+        }
+
+        // conditional variance and residual of the last day under the given parameters
+        void FilterLastState(GarchParams& params) const
+        {
+            double variance = m_backcast;
+            double residual = 0.0;
+            for(std::size_t t = 0; t < m_returns.size(); ++t)
+            {
+                if(t > 0)
+                {
+                    variance = params.NextVariance(variance, residual);
+                }
+                residual = m_returns[t] - params.m_mu;
+            }
+
+            params.m_lastVariance = variance;
+            params.m_lastResidual = residual;
+        }
+    };
+
+    bool IsUsableStart(const GarchParams& params)
+    {
+        return std::isfinite(params.m_mu) && params.m_omega > 0.0 && params.m_alpha > 0.0 && params.m_beta > 0.0
+            && params.m_alpha + params.m_beta < MAX_PERSISTENCE;
+    }
+
+    // BFGS on the inverse Hessian with a backtracking Armijo line search
+    std::size_t Minimise(const Model& model, Vector& x, const GarchFitOptions& options, bool& converged)
+    {
+        Matrix inverseHessian{};
+        for(std::size_t k = 0; k < NUM_PARAMS; ++k)
+        {
+            inverseHessian[k][k] = 1.0;
+        }
+
+        Vector gradient;
+        double loss = model.Evaluate(x, gradient);
+
+        converged = false;
+        std::size_t iteration = 0;
+        for(; iteration < options.m_maxIterations; ++iteration)
+        {
+            if(std::sqrt(Dot(gradient, gradient)) < options.m_gradientTolerance)
+            {
+                converged = true;
+                break;
+            }
+
+            Vector direction{};
+            for(std::size_t i = 0; i < NUM_PARAMS; ++i)
+            {
+                direction[i] = -Dot(inverseHessian[i], gradient);
+            }
+
+            // fall back to steepest descent if the curvature estimate stopped giving a descent direction
+            double slope = Dot(direction, gradient);
+            if(slope >= 0.0)
+            {
+                inverseHessian = Matrix{};
+                for(std::size_t k = 0; k < NUM_PARAMS; ++k)
+                {
+                    inverseHessian[k][k] = 1.0;
+                    direction[k] = -gradient[k];
+                }
+                slope = -Dot(gradient, gradient);
+            }
+
+            double step = 1.0;
+            Vector candidate;
+            Vector candidateGradient;
+            double candidateLoss = loss;
+            bool accepted = false;
+            for(int attempt = 0; attempt < 40; ++attempt, step *= 0.5)
+            {
+                for(std::size_t k = 0; k < NUM_PARAMS; ++k)
+                {
+                    candidate[k] = x[k] + step * direction[k];
+                }
+
+                candidateLoss = model.Evaluate(candidate, candidateGradient);
+                if(std::isfinite(candidateLoss) && candidateLoss <= loss + 1e-4 * step * slope)
+                {
+                    accepted = true;
+                    break;
+                }
+            }
+
+            if(!accepted)
+            {
+                // no further decrease is possible at double precision
+                converged = true;
+                break;
+            }
+
+            Vector s, y;
+            for(std::size_t k = 0; k < NUM_PARAMS; ++k)
+            {
+                s[k] = candidate[k] - x[k];
+                y[k] = candidateGradient[k] - gradient[k];
+            }
+
+            const double sy = Dot(s, y);
+            if(sy > 1e-12)
+            {
+                // H' = (I - rho s y^T) H (I - rho y s^T) + rho s s^T
+                const double rho = 1.0 / sy;
+                Vector hy{};
+                for(std::size_t i = 0; i < NUM_PARAMS; ++i)
+                {
+                    hy[i] = Dot(inverseHessian[i], y);
+                }
+                const double yhy = Dot(y, hy);
+
+                for(std::size_t i = 0; i < NUM_PARAMS; ++i)
+                {
+                    for(std::size_t j = 0; j < NUM_PARAMS; ++j)
+                    {
+                        inverseHessian[i][j] += rho * ((1.0 + rho * yhy) * s[i] * s[j] - hy[i] * s[j] - s[i] * hy[j]);
+                    }
+                }
+            }
+
+            x = candidate;
+            gradient = candidateGradient;
+            loss = candidateLoss;
+        }
+
+        return iteration;
+    }
+}
+
+namespace GarchModel
+{
+    GarchFit Fit(const std::vector<double>& returns, const GarchParams* warmStart, const GarchFitOptions& options)
+    {
+        std::vector<double> clean;
+        clean.reserve(returns.size());
+        std::copy_if(returns.begin(), returns.end(), std::back_inserter(clean), [](double r) { return std::isfinite(r); });
+
+        GarchFit fit;
+        fit.m_numObservations = clean.size();
+        if(clean.empty())
+            return fit;
+
+        const double n = static_cast<double>(clean.size());
+        const double mean = std::accumulate(clean.begin(), clean.end(), 0.0) / n;
+        double variance = 0.0;
+        for(double r : clean)
+        {
+            variance += (r - mean) * (r - mean);
+        }
+        variance = std::max(variance / n, 1e-20);
+
+        if(clean.size() < options.m_minObservations)
+        {
+            fit.m_params.m_mu = mean;
+            fit.m_params.m_omega = variance;
+            fit.m_params.m_lastVariance = variance;
+            fit.m_params.m_lastResidual = clean.back() - mean;
+            return fit;
+        }
+
+        // fit in standardised units so the optimiser sees O(1) coordinates whatever the asset's scale
+        const double scale = std::sqrt(variance);
+        for(double& r : clean)
+        {
+            r /= scale;
+        }
+
+        const Model model{ clean, 1.0 };
+
+        GarchParams start;
+        if(warmStart && IsUsableStart(*warmStart))
+        {
+            start = *warmStart;
+            start.m_mu /= scale;
+            start.m_omega /= variance;
+        }
+        else
+        {
+            start.m_mu = mean / scale;
+            start.m_alpha = 0.05;
+            start.m_beta = 0.90;
+            start.m_omega = 1.0 - start.m_alpha - start.m_beta;
+        }
+
+        Vector x = model.FromParams(start);
+        fit.m_iterations = Minimise(model, x, options, fit.m_converged);
+
+        Vector gradient;
+        const double meanLoss = model.Evaluate(x, gradient);
+        GarchParams params = model.ToParams(x);
+        model.FilterLastState(params);
+
+        // back to the units of the input returns
+        params.m_mu *= scale;
+        params.m_omega *= variance;
+        params.m_lastVariance *= variance;
+        params.m_lastResidual *= scale;
+
+        fit.m_params = params;
+        fit.m_logLikelihood = -0.5 * n * std::log(2.0 * std::numbers::pi * variance) - n * meanLoss;
+        return fit;
+    }
+
+    std::vector<GarchFit> FitAssets(const std::vector<std::vector<double>>& logReturnsMat, const std::vector<GarchParams>& warmStarts, const GarchFitOptions& options)
+    {
+        if(logReturnsMat.empty())
+            return {};
+
+        const std::size_t numAssets = logReturnsMat[0].size();
+        assert(warmStarts.empty() || warmStarts.size() == numAssets);
+
+        std::vector<GarchFit> fits(numAssets);
+        ThreadPool::Instance().ParallelFor(0, numAssets, [&](std::size_t startAsset, std::size_t endAsset) {
+            std::vector<double> column(logReturnsMat.size());
+            for(std::size_t asset = startAsset; asset < endAsset; ++asset)
+            {
+                for(std::size_t t = 0; t < logReturnsMat.size(); ++t)
+                {
+                    column[t] = logReturnsMat[t][asset];
+                }
+
+                fits[asset] = Fit(column, warmStarts.empty() ? nullptr : &warmStarts[asset], options);
+            }
+        }, 1);
+
+        return fits;
+    }
+}
@@ -5,180 +5,1503 @@
 #include <cmath>
 #include <algorithm>
 #include <functional>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
 
 #include "../include/MonteCarloEngine.hpp"
 #include "../include/DataHandler.hpp"
 #include "../include/PortfolioOptimisation.hpp"
+#include "../include/MathUtils.hpp"
+#include "../include/ThreadPool.hpp"
+#include "../include/RiskSketches.hpp"
+#include "../include/QuantileSelection.hpp"
+
+namespace
+{
+    // one path of log-returns to prices: a running sum in double, then an exp pass the compiler can vectorise.
+    // logReturns and prices may alias, the sum is finished before anything is written
+    template <typename Real>
+    void LogReturnsToPrices(const Real* logReturns, Real* prices, std::size_t numDays, double initialPrice, double* cumulative)
+    {
+        double sum = 0.0;
+        for(std::size_t dayIdx = 0; dayIdx < numDays; ++dayIdx)
+        {
+            sum += static_cast<double>(logReturns[dayIdx]);
+            cumulative[dayIdx] = sum;
+        }
+
+        for(std::size_t dayIdx = 0; dayIdx < numDays; ++dayIdx)
+        {
+            prices[dayIdx] = static_cast<Real>(initialPrice * std::exp(cumulative[dayIdx]));
+        }
+    }
+
+    // paths advanced together by the GARCH kernel: one AVX-512 register of doubles, or two AVX2 registers
+    constexpr std::size_t GARCH_LANES = 8;
+
+    // runs the variance recursion for GARCH_LANES paths at once. lanes are day-major (day * GARCH_LANES + lane)
+    // and hold shocks on entry, log-returns on exit. the lane loop has a fixed trip count and no cross-lane
+    // dependence, so the variance state stays in registers and the compiler turns it into vector code
+    template <typename Real>
+    void GarchLaneKernel(Real* lanes, std::size_t numDays, const GarchParams& params, double firstVariance)
+    {
+        const Real mu = static_cast<Real>(params.m_mu);
+        const Real omega = static_cast<Real>(params.m_omega);
+        const Real alpha = static_cast<Real>(params.m_alpha);
+        const Real beta = static_cast<Real>(params.m_beta);
+        const Real gamma = static_cast<Real>(params.m_gamma);
+
+        Real variance[GARCH_LANES];
+        for(std::size_t lane = 0; lane < GARCH_LANES; ++lane)
+        {
+            variance[lane] = static_cast<Real>(firstVariance);
+        }
+
+        for(std::size_t dayIdx = 0; dayIdx < numDays; ++dayIdx)
+        {
+            Real* row = lanes + dayIdx * GARCH_LANES;
+            for(std::size_t lane = 0; lane < GARCH_LANES; ++lane)
+            {
+                const Real residual = std::sqrt(variance[lane]) * row[lane];
+                const Real leverage = (residual < Real(0)) ? gamma : Real(0);
+                row[lane] = mu + residual;
+                variance[lane] = omega + (alpha + leverage) * residual * residual + beta * variance[lane];
+            }
+        }
+    }
+
+    // GetCholeskyMatrix factors the covariance; scaling each row to unit length leaves a factor of the correlation
+    // matrix, so the per-asset volatilities are applied exactly once
+    Eigen::MatrixXd CorrelationFactor(const Eigen::MatrixXd& choleskyMatrix)
+    {
+        Eigen::MatrixXd factor = choleskyMatrix;
+        for(Eigen::Index row = 0; row < factor.rows(); ++row)
+        {
+            const double norm = factor.row(row).norm();
+            if(norm > 0.0)
+            {
+                factor.row(row) /= norm;
+            }
+        }
+
+        return factor;
+    }
+
+    // StudentT degrees of freedom are clamped to where the kurtosis estimate means something and
+    // rounded to half-units, so assets with similar tails share a mixing group
+    constexpr double MIN_DEGREES_OF_FREEDOM = 4.5;
+    constexpr double MAX_DEGREES_OF_FREEDOM = 50.0;
+
+    // each StudentT path owns a slice of this many raw draws; it only has to outlast the polar method's and
+    // the gamma sampler's (unbounded but rare) retries, and jump-ahead makes the unused remainder free
+    constexpr uint64_t STUDENT_T_PATH_STRIDE = uint64_t(1) << 32;
+
+    // m_degreesOfFreedom holds one value per asset or a single shared one
+    std::vector<double> AssetDegreesOfFreedom(const SimulationOptions& options, std::size_t numAssets)
+    {
+        assert(options.m_degreesOfFreedom.size() == numAssets || options.m_degreesOfFreedom.size() == 1);
+
+        std::vector<double> degreesOfFreedom = options.m_degreesOfFreedom;
+        degreesOfFreedom.resize(numAssets, options.m_degreesOfFreedom.front());
+        return degreesOfFreedom;
+    }
+
+    // ascending distinct degrees of freedom, one StudentT mixing group each
+    std::vector<double> DistinctDegreesOfFreedom(std::vector<double> degreesOfFreedom)
+    {
+        std::sort(degreesOfFreedom.begin(), degreesOfFreedom.end());
+        degreesOfFreedom.erase(std::unique(degreesOfFreedom.begin(), degreesOfFreedom.end()), degreesOfFreedom.end());
+        return degreesOfFreedom;
+    }
+
+    // groups x assets, each asset's exposure placed in the row of its group
+    Eigen::MatrixXd GroupExposures(const Eigen::VectorXd& exposures, const std::vector<double>& degreesOfFreedom, const std::vector<double>& groupDof)
+    {
+        Eigen::MatrixXd groupExposures = Eigen::MatrixXd::Zero(static_cast<Eigen::Index>(groupDof.size()), exposures.size());
+        for(Eigen::Index asset = 0; asset < exposures.size(); ++asset)
+        {
+            const auto group = std::lower_bound(groupDof.begin(), groupDof.end(), degreesOfFreedom[static_cast<std::size_t>(asset)]) - groupDof.begin();
+            groupExposures(static_cast<Eigen::Index>(group), asset) = exposures(asset);
+        }
+
+        return groupExposures;
+    }
+
+    // per-step drift of the weighted portfolio log-return
+    double PortfolioStepDrift(const std::vector<std::pair<double, double>>& assetStatistics, const std::vector<double>& weights, bool ignoreDrift, double dt)
+    {
+        double totalDrift = 0.0;
+        if(!ignoreDrift)
+        {
+            for(std::size_t i = 0; i < assetStatistics.size(); ++i) 
+            {
+                totalDrift += weights[i] * assetStatistics[i].first * dt;
+            }
+        }
+        else
+        {
+            // use an arbitrary risk free rate (should probably put this as an argument)
+            double riskFreeRate = 0.04;
+            totalDrift = riskFreeRate * dt;
+        }
+
+        return totalDrift;
+    }
+
+    // per-step volatility of each position in isolation
+    Eigen::VectorXd PositionStepRisks(const std::vector<std::pair<double, double>>& assetStatistics, const std::vector<double>& weights, double sqrtDt)
+    {
+        Eigen::VectorXd positionRisks(static_cast<Eigen::Index>(assetStatistics.size()));
+        for(std::size_t i = 0; i < assetStatistics.size(); ++i) 
+        {
+            positionRisks(static_cast<Eigen::Index>(i)) = weights[i] * (assetStatistics[i].second * sqrtDt);
+        }
+
+        return positionRisks;
+    }
+
+    // annual drifts to per-step ones; the flat rate GenerateReturnsForMultiAsset uses when the historical drift is ignored
+    Eigen::VectorXd AssetStepDrifts(const std::vector<double>& drifts, bool ignoreDrift, double dt)
+    {
+        constexpr double riskFreeRate = 0.04;
+
+        Eigen::VectorXd stepDrifts(static_cast<Eigen::Index>(drifts.size()));
+        for(std::size_t i = 0; i < drifts.size(); ++i)
+        {
+            stepDrifts(static_cast<Eigen::Index>(i)) = (ignoreDrift ? riskFreeRate : drifts[i]) * dt;
+        }
+
+        return stepDrifts;
+    }
+
+    // jump counts above this are folded into the last one; the cut is far out in the Poisson tail at any daily intensity
+    constexpr std::size_t MAX_JUMPS_PER_STEP = 8;
+
+    // sizes the path buffer (left empty when only summaries are kept, or when the engine writes to caller-owned
+    // storage) and the path metrics of a simulation
+    template <typename Real>
+    void PrepareOutput(BasicReturns<Real>& returns, std::size_t numPaths, std::size_t numDays, const SimulationOptions& options, std::span<Real> pathBuffer)
+    {
+        assert(options.m_storePaths || options.m_trackPathMetrics || !options.m_checkpointDays.empty() || !options.m_bandQuantiles.empty() || options.m_samplePaths > 0);
+        assert(std::is_sorted(options.m_checkpointDays.begin(), options.m_checkpointDays.end()));
+        assert(options.m_checkpointDays.empty() || (options.m_checkpointDays.front() > 0 && options.m_checkpointDays.back() <= numDays));
+
+        if(!pathBuffer.empty() && (!options.m_storePaths || pathBuffer.size() != numPaths * numDays))
+            throw std::runtime_error("Path buffer of " + std::to_string(pathBuffer.size()) + " values does not fit " + std::to_string(numPaths) + " stored paths of " + std::to_string(numDays) + " days");
+
+        returns.m_returns.resize((options.m_storePaths && pathBuffer.empty()) ? numPaths * numDays : 0);
+        returns.m_blockSize = numDays;
+        returns.m_output = options.m_output;
+        returns.m_initialPrice = (options.m_output == SimulationOutput::PricePaths) ? options.m_initialPrice : 1.0;
+
+        if(options.m_trackPathMetrics)
+        {
+            PathMetrics& metrics = returns.m_pathMetrics;
+            metrics.m_lossBarrier = options.m_lossBarrier;
+            metrics.m_terminalLogReturns.resize(numPaths);
+            metrics.m_maxDrawdowns.resize(numPaths);
+            metrics.m_daysUnderWater.resize(numPaths);
+            metrics.m_firstPassageDays.resize(numPaths);
+        }
+
+    }
+
+    // where stored paths go: the caller's buffer when one is given, otherwise m_returns
+    template <typename Real>
+    Real* PathStorage(BasicReturns<Real>& returns, std::span<Real> pathBuffer)
+    {
+        return pathBuffer.empty() ? returns.m_returns.data() : pathBuffer.data();
+    }
+
+    // walks a freshly generated path of log-returns while it is still in L1, keeping wealth, peak and the
+    // barrier flag in locals; everything is tracked in log space so no exp is needed per step
+    template <typename Real>
+    void ObservePath(const Real* logReturns, std::size_t numDays, double logBarrier, PathMetrics& metrics, std::size_t path)
+    {
+        double logWealth = 0.0;
+        double logPeak = 0.0;
+        double maxLogDrawdown = 0.0;
+        uint32_t daysUnderWater = 0;
+        int32_t firstPassage = -1;
+
+        for(std::size_t dayIdx = 0; dayIdx < numDays; ++dayIdx)
+        {
+            logWealth += static_cast<double>(logReturns[dayIdx]);
+            logPeak = std::max(logPeak, logWealth);
+
+            const double logDrawdown = logPeak - logWealth;
+            maxLogDrawdown = std::max(maxLogDrawdown, logDrawdown);
+            daysUnderWater += (logDrawdown > 0.0) ? 1 : 0;
+            firstPassage = (firstPassage < 0 && logWealth <= logBarrier) ? static_cast<int32_t>(dayIdx) : firstPassage;
+        }
+
+        metrics.m_terminalLogReturns[path] = logWealth;
+        metrics.m_maxDrawdowns[path] = -std::expm1(-maxLogDrawdown);
+        metrics.m_daysUnderWater[path] = daysUnderWater;
+        metrics.m_firstPassageDays[path] = firstPassage;
+    }
+
+    // the collectors split the paths into at most this many blocks of whole generation units, fixed by the path
+    // count alone so that what they merge does not depend on the thread count
+    constexpr std::size_t NUM_COLLECTOR_BLOCKS = 32;
+
+    struct PathBlocks
+    {
+        std::size_t m_unitsPerBlock;
+        std::size_t m_pathsPerBlock;
+        std::size_t m_numBlocks;
+    };
+
+    // a generator that produces pathsPerUnit consecutive paths at a time splits its units into contiguous blocks
+    PathBlocks SplitIntoBlocks(std::size_t numPaths, std::size_t pathsPerUnit = 1)
+    {
+        const std::size_t numUnits = (numPaths + pathsPerUnit - 1) / pathsPerUnit;
+        const std::size_t unitsPerBlock = std::max<std::size_t>((numUnits + NUM_COLLECTOR_BLOCKS - 1) / NUM_COLLECTOR_BLOCKS, 1);
+        const std::size_t pathsPerBlock = unitsPerBlock * pathsPerUnit;
+        return { unitsPerBlock, pathsPerBlock, (numPaths + pathsPerBlock - 1) / pathsPerBlock };
+    }
+
+    // fan-chart band sketches: per-day resolution and range, as for the SimulatePortfolios sketches
+    constexpr std::size_t BAND_BINS = 512;
+    constexpr double BAND_RANGE_STDDEVS = 8.0;
+    // the path sample is drawn from its own fixed-seed generator, so asking for one never changes the paths
+    constexpr uint64_t PATH_SAMPLE_SEED = 0x9e3779b97f4a7c15;
+
+    /*
+    Per-day quantile bands and a sample of whole paths, fed from FinishPath by whichever chunk generates each
+    path. Every block of paths has its own per-day sketches, filled by the one chunk that generates the block,
+    and Finish merges them in block order, so the bands are the same bits for every thread count. The sample
+    is a uniform set of path indices drawn up front with Floyd's algorithm, which is what a reservoir over the
+    stream of paths keeps, fixed before any chunk runs so each sampled path has its own slot to write.
+    */
+    template <typename Real>
+    class FanChartCollector
+    {
+    public:
+        FanChartCollector(const SimulationOptions& options, std::size_t numPaths, const PathBlocks& blocks, std::size_t numDays, double stepDrift, double stepStdDev)
+            : m_levels(options.m_bandQuantiles)
+            , m_pathsPerBlock(blocks.m_pathsPerBlock)
+            , m_numDays(numDays)
+        {
+            if(!m_levels.empty())
+            {
+                std::vector<HistogramSketch> identity;
+                identity.reserve(numDays);
+                for(std::size_t dayIdx = 0; dayIdx < numDays; ++dayIdx)
+                {
+                    const double days = static_cast<double>(dayIdx + 1);
+                    const double halfWidth = std::max(BAND_RANGE_STDDEVS * stepStdDev * std::sqrt(days), 1e-9);
+                    identity.emplace_back(stepDrift * days - halfWidth, stepDrift * days + halfWidth, BAND_BINS);
+                }
+
+                m_blocks.assign(std::max<std::size_t>(blocks.m_numBlocks, 1), identity);
+            }
+
+            const std::size_t numSamples = std::min(options.m_samplePaths, numPaths);
+            if(numSamples > 0)
+            {
+                std::mt19937_64 selector(PATH_SAMPLE_SEED);
+                std::unordered_set<std::size_t> chosen;
+                chosen.reserve(numSamples);
+                for(std::size_t candidate = numPaths - numSamples; candidate < numPaths; ++candidate)
+                {
+                    const std::size_t pick = std::uniform_int_distribution<std::size_t>(0, candidate)(selector);
+                    chosen.insert(chosen.count(pick) == 0 ? pick : candidate);
+                }
+
+                m_samplePaths.assign(chosen.begin(), chosen.end());
+                std::sort(m_samplePaths.begin(), m_samplePaths.end());
+                m_samples.resize(numSamples * numDays);
+            }
+        }
+
+        bool IsEnabled() const
+        {
+            return !m_blocks.empty() || !m_samplePaths.empty();
+        }
+
+        bool HasBands() const
+        {
+            return !m_blocks.empty();
+        }
+
+        void Observe(const Real* logReturns, std::size_t path)
+        {
+            if(!m_blocks.empty())
+            {
+                std::vector<HistogramSketch>& days = m_blocks[path / m_pathsPerBlock];
+
+                double sum = 0.0;
+                for(std::size_t dayIdx = 0; dayIdx < m_numDays; ++dayIdx)
+                {
+                    sum += static_cast<double>(logReturns[dayIdx]);
+                    days[dayIdx].Add(sum);
+                }
+            }
+
+            const auto sampled = std::lower_bound(m_samplePaths.begin(), m_samplePaths.end(), path);
+            if(sampled != m_samplePaths.end() && *sampled == path)
+            {
+                double* out = m_samples.data() + static_cast<std::size_t>(sampled - m_samplePaths.begin()) * m_numDays;
+                double sum = 0.0;
+                for(std::size_t dayIdx = 0; dayIdx < m_numDays; ++dayIdx)
+                {
+                    sum += static_cast<double>(logReturns[dayIdx]);
+                    out[dayIdx] = sum;
+                }
+            }
+        }
+
+        // merges the blocks in order and reads every day's quantiles off the merged sketch
+        void Finish(FanChart& chart)
+        {
+            chart.m_levels = m_levels;
+            chart.m_bands.clear();
+            if(!m_blocks.empty())
+            {
+                chart.m_bands.resize(m_numDays * m_levels.size());
+                ThreadPool::Instance().ParallelFor(0, m_numDays, [&](std::size_t startDay, std::size_t endDay) {
+                    for(std::size_t dayIdx = startDay; dayIdx < endDay; ++dayIdx)
+                    {
+                        HistogramSketch merged = m_blocks.front()[dayIdx];
+                        for(std::size_t block = 1; block < m_blocks.size(); ++block)
+                        {
+                            merged.Merge(m_blocks[block][dayIdx]);
+                        }
+                        for(std::size_t level = 0; level < m_levels.size(); ++level)
+                        {
+                            chart.m_bands[dayIdx * m_levels.size() + level] = merged.Quantile(m_levels[level]);
+                        }
+                    }
+                });
+            }
+
+            chart.m_samplePaths = std::move(m_samplePaths);
+            chart.m_samples = std::move(m_samples);
+        }
+
+    private:
+        std::vector<double> m_levels;
+        std::size_t m_pathsPerBlock;
+        std::size_t m_numDays;
+        std::vector<std::vector<HistogramSketch>> m_blocks;
+        std::vector<std::size_t> m_samplePaths;
+        std::vector<double> m_samples;
+    };
+
+    // checkpoint sketches: resolution and range as for the SimulatePortfolios sketches, over simple returns
+    constexpr std::size_t HORIZON_BINS = 2048;
+    constexpr double HORIZON_RANGE_STDDEVS = 8.0;
+
+    /*
+    The simple return of every path at each checkpoint horizon, sketched as the path passes it, so the term
+    structure costs a fixed number of bins per horizon however many paths feed it. Every block of paths has its
+    own sketches, filled by the one chunk that generates the block, and Finish merges them in block order; under
+    importance sampling each value goes in weighted by the likelihood ratio up to its checkpoint, and those
+    weighted sums come out the same bits for every thread count.
+    */
+    template <typename Real>
+    class HorizonCollector
+    {
+    public:
+        HorizonCollector(const SimulationOptions& options, const PathBlocks& blocks, double stepDrift, double stepStdDev)
+            : m_days(options.m_checkpointDays)
+            , m_pathsPerBlock(blocks.m_pathsPerBlock)
+        {
+            if(m_days.empty())
+                return;
+
+            std::vector<HistogramSketch> identity;
+            identity.reserve(m_days.size());
+            for(const std::size_t horizon : m_days)
+            {
+                const double days = static_cast<double>(horizon);
+                const double halfWidth = std::max(HORIZON_RANGE_STDDEVS * stepStdDev * std::sqrt(days), 1e-9);
+                identity.emplace_back(std::expm1(stepDrift * days - halfWidth), std::expm1(stepDrift * days + halfWidth), HORIZON_BINS);
+            }
+            m_blocks.assign(std::max<std::size_t>(blocks.m_numBlocks, 1), identity);
+        }
+
+        bool IsEnabled() const
+        {
+            return !m_blocks.empty();
+        }
+
+        // one running sum over the path, read off as it passes each checkpoint
+        void Observe(const Real* logReturns, std::size_t path, const double* weights)
+        {
+            std::vector<HistogramSketch>& sketches = m_blocks[path / m_pathsPerBlock];
+
+            double sum = 0.0;
+            std::size_t dayIdx = 0;
+            for(std::size_t checkpoint = 0; checkpoint < m_days.size(); ++checkpoint)
+            {
+                for(; dayIdx < m_days[checkpoint]; ++dayIdx)
+                {
+                    sum += static_cast<double>(logReturns[dayIdx]);
+                }
+                sketches[checkpoint].Add(std::expm1(sum), weights ? weights[checkpoint] : 1.0);
+            }
+        }
+
+        void Finish(HorizonSketches& horizons)
+        {
+            horizons.m_days = m_days;
+            horizons.m_sketches.clear();
+            if(m_blocks.empty())
+                return;
+
+            horizons.m_sketches = std::move(m_blocks.front());
+            for(std::size_t block = 1; block < m_blocks.size(); ++block)
+            {
+                for(std::size_t checkpoint = 0; checkpoint < m_days.size(); ++checkpoint)
+                {
+                    horizons.m_sketches[checkpoint].Merge(m_blocks[block][checkpoint]);
+                }
+            }
+        }
+
+    private:
+        std::vector<std::size_t> m_days;
+        std::size_t m_pathsPerBlock;
+        std::vector<std::vector<HistogramSketch>> m_blocks;
+    };
+
+    // chunks of whole blocks while a collector keeps per-block sketches, the pool's own split otherwise
+    template <typename Real>
+    std::size_t CollectorGrain(const PathBlocks& blocks, const FanChartCollector<Real>& fanChart, const HorizonCollector<Real>& horizons)
+    {
+        return (fanChart.HasBands() || horizons.IsEnabled()) ? blocks.m_unitsPerBlock : 0;
+    }
+
+    // last step for every generated path of log-returns: feed the observers, then convert to prices if asked;
+    // checkpointWeights are the likelihood ratios at each checkpoint under importance sampling, null otherwise
+    template <typename Real>
+    void FinishPath(Real* logReturns, std::size_t numDays, std::size_t path, const SimulationOptions& options, BasicReturns<Real>& returns, FanChartCollector<Real>& fanChart, HorizonCollector<Real>& horizons, double* cumulative, const double* checkpointWeights = nullptr)
+    {
+        if(fanChart.IsEnabled())
+        {
+            fanChart.Observe(logReturns, path);
+        }
+        if(options.m_trackPathMetrics)
+        {
+            ObservePath(logReturns, numDays, std::log1p(options.m_lossBarrier), returns.m_pathMetrics, path);
+        }
+        if(horizons.IsEnabled())
+        {
+            horizons.Observe(logReturns, path, checkpointWeights);
+        }
+        if(options.m_storePaths && options.m_output == SimulationOutput::PricePaths)
+        {
+            LogReturnsToPrices(logReturns, logReturns, numDays, options.m_initialPrice, cumulative);
+        }
+    }
+
+    // SimulatePortfolios: paths per tile (one GEMM each), histogram resolution and range, and the number of
+    // partial reductions, fixed by the path count alone so the result does not depend on the thread count
+    constexpr std::size_t PORTFOLIO_TILE_PATHS = 1024;
+    constexpr std::size_t SKETCH_BINS = 2048;
+    constexpr double SKETCH_RANGE_STDDEVS = 8.0;
+    constexpr std::size_t NUM_REDUCTION_BLOCKS = 32;
+
+    // SimulateWealth: paths per tile of structure-of-arrays holdings, a multiple of every SIMD width
+    constexpr std::size_t WEALTH_TILE_PATHS = 256;
+
+    // VaR and CVaR (as positive losses) of a sample, optionally weighted by likelihood ratios with unit mean
+    std::pair<double, double> WeightedTailRisk(const std::vector<double>& outcomes, const std::vector<double>& weights, double confidence)
+    {
+        const std::size_t numOutcomes = outcomes.size();
+        const double n = static_cast<double>(numOutcomes);
+        const double tailProbability = 1.0 - confidence;
+
+        if(weights.empty())
+        {
+            const QuantileSelection::OrderStatistic tail = QuantileSelection::Select(outcomes, { tailProbability }).front();
+            return { -tail.m_value, -tail.m_tailMean };
+        }
+
+        std::vector<std::size_t> order(numOutcomes);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return outcomes[a] < outcomes[b]; });
+
+        // walk up from the worst outcome until the weighted probability mass reaches the tail level
+        double mass = 0.0;
+        double weightedSum = 0.0;
+        double threshold = outcomes[order.back()];
+        for(std::size_t idx : order)
+        {
+            const double p = weights[idx] / n;
+            mass += p;
+            weightedSum += p * outcomes[idx];
+            if(mass >= tailProbability)
+            {
+                threshold = outcomes[idx];
+                break;
+            }
+        }
+
+        return { -threshold, -weightedSum / std::max(mass, tailProbability) };
+    }
+}
 
 /* -------------------------- PUBLIC METHODS ------------------------------ */
 
-MonteCarloEngine::MonteCarloEngine()
+template <typename Real>
+BasicMonteCarloEngine<Real>::BasicMonteCarloEngine()
 {}
 
-MonteCarloEngine::~MonteCarloEngine()
+template <typename Real>
+BasicMonteCarloEngine<Real>::BasicMonteCarloEngine(uint64_t seed)
+    : m_rng(GenNormalPCG::FromSeed(seed))
 {}
 
+template <typename Real>
+BasicMonteCarloEngine<Real>::BasicMonteCarloEngine(uint64_t seed, uint64_t substream)
+    : m_rng(GenNormalPCG::FromSeed(seed).Substream(substream))
+{}
 
-Returns MonteCarloEngine::GenerateReturnsForMultiAsset(
+template <typename Real>
+BasicMonteCarloEngine<Real>::BasicMonteCarloEngine(uint64_t seed, uint64_t substream, std::span<Real> pathBuffer)
+    : m_rng(GenNormalPCG::FromSeed(seed).Substream(substream)),
+      m_pathBuffer(pathBuffer)
+{}
+
+template <typename Real>
+BasicMonteCarloEngine<Real>::~BasicMonteCarloEngine()
+{}
+
+
+template <typename Real>
+BasicReturns<Real> BasicMonteCarloEngine<Real>::GenerateReturnsForMultiAsset(
     const Eigen::MatrixXd& choleskyMatrix, 
     const std::vector<std::pair<double, double>>& assetStatistics,
     const std::vector<double>& weights,
     bool ignoreDrift, 
     std::size_t numPaths, 
-    std::size_t numDays) const
+    std::size_t numDays,
+    const SimulationOptions& options) const
 {    
     const std::size_t numAssets = assetStatistics.size();
-    
-    Returns returns;
-    returns.m_returns.resize(numPaths * numDays);
-    returns.m_blockSize = numDays;
+
+    if(options.m_shocks == ShockDistribution::StudentT)
+    {
+        const double dt = 1.0 / static_cast<double>(numDays);
+        const double totalDrift = PortfolioStepDrift(assetStatistics, weights, ignoreDrift, dt);
+
+        // represents the raw risk of each position in isolation
+        const Eigen::VectorXd positionRisks = PositionStepRisks(assetStatistics, weights, std::sqrt(dt));
+        const Eigen::MatrixXd correlationFactor = CorrelationFactor(choleskyMatrix);
+
+        const std::vector<double> degreesOfFreedom = AssetDegreesOfFreedom(options, numAssets);
+        const std::vector<double> groupDof = DistinctDegreesOfFreedom(degreesOfFreedom);
+        const Eigen::MatrixXd groupLoadings = GroupExposures(positionRisks, degreesOfFreedom, groupDof) * correlationFactor;
+        return SimulateStudentTPaths(totalDrift, groupDof, groupLoadings * groupLoadings.transpose(), numPaths, numDays, options);
+    }
+
+    const std::pair<double, double> stepMoments = ComputePortfolioStepMoments(choleskyMatrix, assetStatistics, weights, ignoreDrift, numDays);
+    return SimulateGaussianPaths(stepMoments.first, stepMoments.second, numPaths, numDays, options);
+}
+
+template <typename Real>
+std::pair<double, double> BasicMonteCarloEngine<Real>::ComputePortfolioStepMoments(
+    const Eigen::MatrixXd& choleskyMatrix,
+    const std::vector<std::pair<double, double>>& assetStatistics,
+    const std::vector<double>& weights,
+    bool ignoreDrift,
+    std::size_t numDays) const
+{
+    assert(weights.size() == assetStatistics.size());
+
+    const double dt = 1.0 / static_cast<double>(numDays);
+    const Eigen::VectorXd positionRisks = PositionStepRisks(assetStatistics, weights, std::sqrt(dt));
+
+    // pre-calculate (Vol^T * L)
+    // project the position risks onto the independent correlation factors
+    Eigen::VectorXd exposureToIndependentFactors = positionRisks.transpose() * CorrelationFactor(choleskyMatrix);
+
+    // since factors are independent, total variance is the sum of squared exposures
+    return { PortfolioStepDrift(assetStatistics, weights, ignoreDrift, dt), exposureToIndependentFactors.norm() };
+}
+
+/*
+The portfolio only sees the factor model through its exposures: the factor part w^T B f has variance |B^T w|^2
+and the idiosyncratic part w^T D e has variance sum (w_i d_i)^2, so the Gaussian step collapses to a scalar in
+O(n k) without any n x n covariance. StudentT groups get the same treatment per group of equal nu.
+*/
+template <typename Real>
+BasicReturns<Real> BasicMonteCarloEngine<Real>::GenerateReturnsForFactorModel(
+    const FactorLoadings& model,
+    const std::vector<double>& drifts,
+    const std::vector<double>& weights,
+    bool ignoreDrift,
+    std::size_t numPaths,
+    std::size_t numDays,
+    const SimulationOptions& options) const
+{
+    const std::size_t numAssets = model.GetNumAssets();
+    assert(weights.size() == numAssets && drifts.size() == numAssets);
+
+    const double dt = 1.0 / static_cast<double>(numDays);
+    const double sqrtDt = std::sqrt(dt);
+
+    const Eigen::Map<const Eigen::VectorXd> weightVec(weights.data(), static_cast<Eigen::Index>(numAssets));
+    const double stepDrift = weightVec.dot(AssetStepDrifts(drifts, ignoreDrift, dt));
+    const Eigen::VectorXd positionExposures = sqrtDt * weightVec;
+
+    if(options.m_shocks == ShockDistribution::StudentT)
+    {
+        const std::vector<double> degreesOfFreedom = AssetDegreesOfFreedom(options, numAssets);
+        const std::vector<double> groupDof = DistinctDegreesOfFreedom(degreesOfFreedom);
+        const Eigen::MatrixXd groupExposures = GroupExposures(positionExposures, degreesOfFreedom, groupDof);
+
+        const Eigen::MatrixXd groupFactorLoadings = groupExposures * model.m_loadings;
+        const Eigen::MatrixXd groupIdiosyncratic = groupExposures * model.m_idiosyncraticVols.asDiagonal();
+        const Eigen::MatrixXd groupCovariance = groupFactorLoadings * groupFactorLoadings.transpose() + groupIdiosyncratic * groupIdiosyncratic.transpose();
+        return SimulateStudentTPaths(stepDrift, groupDof, groupCovariance, numPaths, numDays, options);
+    }
+
+    const double factorVariance = (model.m_loadings.transpose() * positionExposures).squaredNorm();
+    const double idiosyncraticVariance = positionExposures.cwiseProduct(model.m_idiosyncraticVols).squaredNorm();
+    return SimulateGaussianPaths(stepDrift, std::sqrt(factorVariance + idiosyncraticVariance), numPaths, numDays, options);
+}
+
+template <typename Real>
+BasicReturns<Real> BasicMonteCarloEngine<Real>::GenerateReturnsForSingleAsset(double drift, double volatility, std::size_t numPaths/*1000000*/,  std::size_t numDays/*252*/, const SimulationOptions& options) const
+{
+    const double dt = 1.0 / static_cast<double>(numDays);
+    const double dailyVolatility = volatility * std::sqrt(dt);
+    const double dailyDrift = drift * dt;
+
+    return SimulateGaussianPaths(dailyDrift, dailyVolatility, numPaths, numDays, options);
+}
+
+/*
+Under the Gaussian model the daily asset shocks are i.i.d., so the cumulative asset returns between two
+checkpoints are a single normal draw per asset with the summed drift and variance; drawing those directly
+is exact and skips the per-day work entirely. The correlation and volatility scaling are folded into the
+weights once (loadings = W^T diag(vol) L), so each tile of paths costs one GEMM of (portfolios x assets)
+by (assets x paths) per horizon, and every portfolio sees exactly the same shocks.
+*/
+template <typename Real>
+std::vector<PortfolioRisk> BasicMonteCarloEngine<Real>::SimulatePortfolios(
+    const Eigen::MatrixXd& choleskyMatrix,
+    const std::vector<std::pair<double, double>>& assetStatistics,
+    const Eigen::MatrixXd& weights,
+    bool ignoreDrift,
+    std::size_t numPaths,
+    std::size_t numDays,
+    double confidence,
+    const std::vector<std::size_t>& checkpointDays) const
+{
+    const std::size_t numAssets = assetStatistics.size();
+    assert(static_cast<std::size_t>(weights.rows()) == numAssets);
+
+    const double dt = 1.0 / static_cast<double>(numDays);
+
+    std::vector<double> drifts(numAssets);
+    Eigen::VectorXd assetStepVol(numAssets);
+    for(std::size_t i = 0; i < numAssets; ++i)
+    {
+        drifts[i] = assetStatistics[i].first;
+        assetStepVol(static_cast<Eigen::Index>(i)) = assetStatistics[i].second * std::sqrt(dt);
+    }
+
+    const Eigen::MatrixXd loadings = weights.transpose() * assetStepVol.asDiagonal() * CorrelationFactor(choleskyMatrix);
+    const Eigen::VectorXd portfolioDrift = weights.transpose() * AssetStepDrifts(drifts, ignoreDrift, dt);
+    return SimulatePortfolioShocks(loadings, portfolioDrift, numPaths, numDays, confidence, checkpointDays);
+}
+
+/*
+Under a factor model each portfolio's step is W^T B f + W^T D e. The factor part needs only the k factor
+shocks. The idiosyncratic parts of the portfolios are jointly normal with covariance W^T D^2 W, so when there
+are fewer portfolios than assets a Cholesky factor of that P x P matrix replaces the n idiosyncratic shocks
+with P. Either way each tile draws k + min(P, n) normals per path and horizon instead of n, and nothing of
+size n x n is ever formed.
+*/
+template <typename Real>
+std::vector<PortfolioRisk> BasicMonteCarloEngine<Real>::SimulatePortfolios(
+    const FactorLoadings& model,
+    const std::vector<double>& drifts,
+    const Eigen::MatrixXd& weights,
+    bool ignoreDrift,
+    std::size_t numPaths,
+    std::size_t numDays,
+    double confidence,
+    const std::vector<std::size_t>& checkpointDays) const
+{
+    const std::size_t numAssets = model.GetNumAssets();
+    const std::size_t numPortfolios = static_cast<std::size_t>(weights.cols());
+    assert(static_cast<std::size_t>(weights.rows()) == numAssets && drifts.size() == numAssets);
+
+    const double dt = 1.0 / static_cast<double>(numDays);
+    const double sqrtDt = std::sqrt(dt);
+
+    const Eigen::MatrixXd factorLoadings = sqrtDt * (weights.transpose() * model.m_loadings);
+    const Eigen::MatrixXd idiosyncraticExposures = sqrtDt * (weights.transpose() * model.m_idiosyncraticVols.asDiagonal());
+
+    Eigen::MatrixXd idiosyncraticLoadings = idiosyncraticExposures;
+    if(numPortfolios < numAssets)
+    {
+        Eigen::MatrixXd idiosyncraticCovariance = idiosyncraticExposures * idiosyncraticExposures.transpose();
+
+        // duplicate or zero-weight portfolios make the covariance singular, a jitter far below any real variance keeps the factor defined
+        idiosyncraticCovariance.diagonal().array() += 1e-14 * std::max(idiosyncraticCovariance.trace(), 1e-300);
+        Eigen::LLT<Eigen::MatrixXd> llt(idiosyncraticCovariance);
+        assert(llt.info() == Eigen::Success);
+        idiosyncraticLoadings = llt.matrixL();
+    }
+
+    Eigen::MatrixXd loadings(static_cast<Eigen::Index>(numPortfolios), factorLoadings.cols() + idiosyncraticLoadings.cols());
+    loadings << factorLoadings, idiosyncraticLoadings;
+
+    const Eigen::VectorXd portfolioDrift = weights.transpose() * AssetStepDrifts(drifts, ignoreDrift, dt);
+    return SimulatePortfolioShocks(loadings, portfolioDrift, numPaths, numDays, confidence, checkpointDays);
+}
+
+// every portfolio's per-step log-return is drift + loadings * eps with eps ~ N(0, I); one column of loadings per shock
+template <typename Real>
+std::vector<PortfolioRisk> BasicMonteCarloEngine<Real>::SimulatePortfolioShocks(
+    const Eigen::MatrixXd& stepLoadings,
+    const Eigen::VectorXd& stepDrifts,
+    std::size_t numPaths,
+    std::size_t numDays,
+    double confidence,
+    const std::vector<std::size_t>& checkpointDays) const
+{
+    using Matrix = Eigen::Matrix<Real, Eigen::Dynamic, Eigen::Dynamic>;
+    using Vector = Eigen::Matrix<Real, Eigen::Dynamic, 1>;
+
+    const std::size_t numShocks = static_cast<std::size_t>(stepLoadings.cols());
+    const std::size_t numPortfolios = static_cast<std::size_t>(stepLoadings.rows());
+
+    const std::vector<std::size_t> horizons = checkpointDays.empty() ? std::vector<std::size_t>{ numDays } : checkpointDays;
+    const std::size_t numHorizons = horizons.size();
+    assert(std::is_sorted(horizons.begin(), horizons.end()) && horizons.front() > 0 && horizons.back() <= numDays);
+
+    const Matrix loadings = stepLoadings.cast<Real>();
+
+    // per-horizon increments: days since the previous checkpoint
+    std::vector<double> incrementDays(numHorizons);
+    for(std::size_t h = 0; h < numHorizons; ++h)
+    {
+        incrementDays[h] = static_cast<double>(horizons[h] - (h > 0 ? horizons[h - 1] : 0));
+    }
+
+    // every sketch spans +-SKETCH_RANGE_STDDEVS of its portfolio's log-return at that horizon, mapped to simple returns
+    std::vector<HistogramSketch> identity;
+    identity.reserve(numPortfolios * numHorizons);
+    for(std::size_t p = 0; p < numPortfolios; ++p)
+    {
+        const double stepStdDev = stepLoadings.row(static_cast<Eigen::Index>(p)).norm();
+        for(std::size_t h = 0; h < numHorizons; ++h)
+        {
+            const double days = static_cast<double>(horizons[h]);
+            const double mean = stepDrifts(static_cast<Eigen::Index>(p)) * days;
+            const double halfWidth = std::max(SKETCH_RANGE_STDDEVS * stepStdDev * std::sqrt(days), 1e-9);
+            identity.emplace_back(std::expm1(mean - halfWidth), std::expm1(mean + halfWidth), SKETCH_BINS);
+        }
+    }
+
+    const std::size_t numTiles = (numPaths + PORTFOLIO_TILE_PATHS - 1) / PORTFOLIO_TILE_PATHS;
+    const uint64_t tileStride = GenNormalPCG::DrawsFor(numShocks * numHorizons * PORTFOLIO_TILE_PATHS);
+    const GenNormalPCG runStream = ReserveStream(tileStride * numTiles);
+
+    const auto simulateTiles = [&](std::size_t firstTile, std::size_t lastTile) {
+        std::vector<HistogramSketch> sketches = identity;
+        Matrix shocks(static_cast<Eigen::Index>(numShocks * numHorizons), static_cast<Eigen::Index>(PORTFOLIO_TILE_PATHS));
+        Matrix cumulative(static_cast<Eigen::Index>(numPortfolios), static_cast<Eigen::Index>(PORTFOLIO_TILE_PATHS));
+
+        for(std::size_t tile = firstTile; tile < lastTile; ++tile)
+        {
+            const std::size_t tilePaths = std::min(PORTFOLIO_TILE_PATHS, numPaths - tile * PORTFOLIO_TILE_PATHS);
+            const Eigen::Index cols = static_cast<Eigen::Index>(tilePaths);
+
+            GenNormalPCG rng = runStream.Jump(tile * tileStride);
+            rng.Fill(shocks.data(), numShocks * numHorizons * tilePaths);
+
+            cumulative.leftCols(cols).setZero();
+            for(std::size_t h = 0; h < numHorizons; ++h)
+            {
+                const Real scale = static_cast<Real>(std::sqrt(incrementDays[h]));
+                const Vector drift = (stepDrifts * incrementDays[h]).cast<Real>();
+
+                // shocks are laid out column by column, so horizon h of every path is a block of rows
+                cumulative.leftCols(cols).noalias() += scale * (loadings * shocks.block(static_cast<Eigen::Index>(h * numShocks), 0, static_cast<Eigen::Index>(numShocks), cols));
+                cumulative.leftCols(cols).colwise() += drift;
+
+                for(Eigen::Index path = 0; path < cols; ++path)
+                {
+                    for(std::size_t p = 0; p < numPortfolios; ++p)
+                    {
+                        sketches[p * numHorizons + h].Add(std::expm1(static_cast<double>(cumulative(static_cast<Eigen::Index>(p), path))));
+                    }
+                }
+            }
+        }
+
+        return sketches;
+    };
+
+    const auto mergeSketches = [](std::vector<HistogramSketch> lhs, std::vector<HistogramSketch> rhs) {
+        for(std::size_t i = 0; i < lhs.size(); ++i)
+        {
+            lhs[i].Merge(rhs[i]);
+        }
+        return lhs;
+    };
+
+    const std::size_t tilesPerBlock = (numTiles + NUM_REDUCTION_BLOCKS - 1) / NUM_REDUCTION_BLOCKS;
+    const std::vector<HistogramSketch> sketches = ThreadPool::Instance().ParallelReduce(std::size_t(0), numTiles, identity, simulateTiles, mergeSketches, tilesPerBlock);
+
+    const double tailProbability = 1.0 - confidence;
+    std::vector<PortfolioRisk> risks(numPortfolios);
+    for(std::size_t p = 0; p < numPortfolios; ++p)
+    {
+        for(std::size_t h = 0; h < numHorizons; ++h)
+        {
+            const HistogramSketch& sketch = sketches[p * numHorizons + h];
+            risks[p].m_horizons.push_back({ horizons[h], sketch.GetMean(), -sketch.Quantile(tailProbability), -sketch.TailMean(tailProbability) });
+        }
+    }
+
+    return risks;
+}
+
+/*
+Wealth paths keep the holdings of every asset rather than a weighted sum of returns, since rebalancing and
+cash flows make the portfolio weights path-dependent. A tile of WEALTH_TILE_PATHS paths stores its holdings
+asset-major with the paths contiguous (structure of arrays), so each step of the day - growth, cash flow,
+the drift test and the rebalance - is a loop over independent lanes that the compiler vectorises, and the
+rebalance is applied through a per-lane select rather than a branch. The correlated asset shocks of the
+whole tile come from one (paths x assets) by (assets x assets) product per day, laid out so every asset's
+column is again contiguous across the paths.
+
+Costs are charged on the value traded to reach the targets of the pre-cost wealth, the usual first-order
+approximation (the exact solution differs by cost^2 of the turnover).
+*/
+template <typename Real>
+WealthReport BasicMonteCarloEngine<Real>::SimulateWealth(
+    const Eigen::MatrixXd& choleskyMatrix,
+    const std::vector<std::pair<double, double>>& assetStatistics,
+    const WealthPlan& plan,
+    bool ignoreDrift,
+    std::size_t numPaths,
+    std::size_t numDays,
+    double confidence) const
+{
+    using Matrix = Eigen::Matrix<Real, Eigen::Dynamic, Eigen::Dynamic>;
+
+    const std::size_t numAssets = assetStatistics.size();
+    assert(plan.m_targetWeights.size() == numAssets && numPaths > 0);
+    assert(plan.m_rule != RebalanceRule::Calendar || plan.m_rebalanceInterval > 0);
+
+    const double dt = 1.0 / static_cast<double>(numDays);
+
+    std::vector<double> drifts(numAssets);
+    Eigen::VectorXd assetStepVol(numAssets);
+    for(std::size_t i = 0; i < numAssets; ++i)
+    {
+        drifts[i] = assetStatistics[i].first;
+        assetStepVol(static_cast<Eigen::Index>(i)) = assetStatistics[i].second * std::sqrt(dt);
+    }
+
+    // transposed, so the day's returns come out paths x assets
+    const Matrix shockLoadings = (assetStepVol.asDiagonal() * CorrelationFactor(choleskyMatrix)).transpose().cast<Real>();
+    const Eigen::VectorXd stepDrifts = AssetStepDrifts(drifts, ignoreDrift, dt);
+
+    // several flows on one day are netted
+    std::vector<double> dailyFlows(numDays, 0.0);
+    double netFlows = 0.0;
+    for(const CashFlow& flow : plan.m_cashFlows)
+    {
+        assert(flow.m_day < numDays);
+        dailyFlows[flow.m_day] += flow.m_amount;
+        netFlows += flow.m_amount;
+    }
+
+    const std::vector<Real> targets(plan.m_targetWeights.begin(), plan.m_targetWeights.end());
+    const Real initialWealth = static_cast<Real>(plan.m_initialWealth);
+    const Real costRate = static_cast<Real>(plan.m_transactionCost);
+    const Real driftThreshold = static_cast<Real>(plan.m_driftThreshold);
+
+    std::vector<double> terminalWealth(numPaths);
+    std::vector<double> turnover(numPaths);
+    std::vector<double> costs(numPaths);
+    std::vector<uint8_t> depleted(numPaths);
+
+    // every tile draws a full tile of shocks per day, so the stream layout depends on the path count alone
+    const std::size_t numTiles = (numPaths + WEALTH_TILE_PATHS - 1) / WEALTH_TILE_PATHS;
+    const uint64_t drawsPerDay = GenNormalPCG::DrawsFor(numAssets * WEALTH_TILE_PATHS);
+    const uint64_t tileStride = drawsPerDay * numDays;
+    const GenNormalPCG runStream = ReserveStream(tileStride * numTiles);
+
+    ThreadPool::Instance().ParallelFor(0, numTiles, [&](std::size_t startTile, std::size_t endTile) {
+        constexpr std::size_t LANES = WEALTH_TILE_PATHS;
+        const Eigen::Index tileRows = static_cast<Eigen::Index>(LANES);
+
+        Matrix shocks(tileRows, static_cast<Eigen::Index>(numAssets));
+        Matrix logReturns(tileRows, static_cast<Eigen::Index>(numAssets));
+        std::vector<Real> holdings(numAssets * LANES);
+        std::vector<Real> wealth(LANES);
+        std::vector<Real> rebalance(LANES);
+        std::vector<Real> scratch(LANES);
+        std::vector<double> tileTurnover(LANES);
+        std::vector<double> tileCosts(LANES);
+        std::vector<uint8_t> tileDepleted(LANES);
+
+        for(std::size_t tile = startTile; tile < endTile; ++tile)
+        {
+            GenNormalPCG rng = runStream.Jump(tile * tileStride);
+
+            for(std::size_t asset = 0; asset < numAssets; ++asset)
+            {
+                std::fill_n(holdings.data() + asset * LANES, LANES, targets[asset] * initialWealth);
+            }
+            std::fill(wealth.begin(), wealth.end(), initialWealth);
+            std::fill(tileTurnover.begin(), tileTurnover.end(), 0.0);
+            std::fill(tileCosts.begin(), tileCosts.end(), 0.0);
+            std::fill(tileDepleted.begin(), tileDepleted.end(), uint8_t(0));
+
+            for(std::size_t day = 0; day < numDays; ++day)
+            {
+                rng.Fill(shocks.data(), numAssets * LANES);
+                logReturns.noalias() = shocks * shockLoadings;
+
+                std::fill(wealth.begin(), wealth.end(), Real(0));
+                for(std::size_t asset = 0; asset < numAssets; ++asset)
+                {
+                    Real* held = holdings.data() + asset * LANES;
+                    const Real* assetReturns = logReturns.data() + asset * LANES;
+                    const Real drift = static_cast<Real>(stepDrifts(static_cast<Eigen::Index>(asset)));
+                    for(std::size_t lane = 0; lane < LANES; ++lane)
+                    {
+                        held[lane] *= std::exp(drift + assetReturns[lane]);
+                        wealth[lane] += held[lane];
+                    }
+                }
+
+                const Real flow = static_cast<Real>(dailyFlows[day]);
+                if(flow > Real(0))
+                {
+                    for(std::size_t asset = 0; asset < numAssets; ++asset)
+                    {
+                        Real* held = holdings.data() + asset * LANES;
+                        const Real deposit = targets[asset] * flow;
+                        for(std::size_t lane = 0; lane < LANES; ++lane)
+                        {
+                            held[lane] += deposit;
+                        }
+                    }
+                    for(std::size_t lane = 0; lane < LANES; ++lane)
+                    {
+                        wealth[lane] += flow;
+                    }
+                }
+                else if(flow < Real(0))
+                {
+                    // a withdrawal larger than the account empties it
+                    for(std::size_t lane = 0; lane < LANES; ++lane)
+                    {
+                        const Real remaining = wealth[lane] + flow;
+                        tileDepleted[lane] |= static_cast<uint8_t>(remaining <= Real(0));
+                        scratch[lane] = (remaining > Real(0) && wealth[lane] > Real(0)) ? remaining / wealth[lane] : Real(0);
+                        wealth[lane] *= scratch[lane];
+                    }
+                    for(std::size_t asset = 0; asset < numAssets; ++asset)
+                    {
+                        Real* held = holdings.data() + asset * LANES;
+                        for(std::size_t lane = 0; lane < LANES; ++lane)
+                        {
+                            held[lane] *= scratch[lane];
+                        }
+                    }
+                }
+
+                // 1 on the lanes that rebalance today, 0 elsewhere
+                bool anyRebalance = false;
+                if(plan.m_rule == RebalanceRule::Calendar)
+                {
+                    anyRebalance = (day + 1) % plan.m_rebalanceInterval == 0;
+                    std::fill(rebalance.begin(), rebalance.end(), anyRebalance ? Real(1) : Real(0));
+                }
+                else if(plan.m_rule == RebalanceRule::Threshold)
+                {
+                    std::fill(scratch.begin(), scratch.end(), Real(0));
+                    for(std::size_t asset = 0; asset < numAssets; ++asset)
+                    {
+                        const Real* held = holdings.data() + asset * LANES;
+                        for(std::size_t lane = 0; lane < LANES; ++lane)
+                        {
+                            scratch[lane] = std::max(scratch[lane], std::abs(held[lane] - targets[asset] * wealth[lane]));
+                        }
+                    }
+                    for(std::size_t lane = 0; lane < LANES; ++lane)
+                    {
+                        const bool drifted = scratch[lane] > driftThreshold * wealth[lane] && wealth[lane] > Real(0);
+                        rebalance[lane] = drifted ? Real(1) : Real(0);
+                        anyRebalance |= drifted;
+                    }
+                }
+
+                if(!anyRebalance)
+                    continue;
+
+                std::fill(scratch.begin(), scratch.end(), Real(0));
+                for(std::size_t asset = 0; asset < numAssets; ++asset)
+                {
+                    const Real* held = holdings.data() + asset * LANES;
+                    for(std::size_t lane = 0; lane < LANES; ++lane)
+                    {
+                        scratch[lane] += std::abs(targets[asset] * wealth[lane] - held[lane]);
+                    }
+                }
+                for(std::size_t lane = 0; lane < LANES; ++lane)
+                {
+                    const Real traded = rebalance[lane] * scratch[lane];
+                    tileTurnover[lane] += static_cast<double>(traded);
+                    tileCosts[lane] += static_cast<double>(costRate * traded);
+                    wealth[lane] -= costRate * traded;
+                }
+                for(std::size_t asset = 0; asset < numAssets; ++asset)
+                {
+                    Real* held = holdings.data() + asset * LANES;
+                    for(std::size_t lane = 0; lane < LANES; ++lane)
+                    {
+                        held[lane] = (rebalance[lane] > Real(0)) ? targets[asset] * wealth[lane] : held[lane];
+                    }
+                }
+            }
+
+            const std::size_t firstPath = tile * WEALTH_TILE_PATHS;
+            const std::size_t tilePaths = std::min(WEALTH_TILE_PATHS, numPaths - firstPath);
+            for(std::size_t lane = 0; lane < tilePaths; ++lane)
+            {
+                terminalWealth[firstPath + lane] = static_cast<double>(wealth[lane]);
+                turnover[firstPath + lane] = tileTurnover[lane];
+                costs[firstPath + lane] = tileCosts[lane];
+                depleted[firstPath + lane] = tileDepleted[lane];
+            }
+        }
+    });
+
+    WealthReport report{};
+    report.m_numPaths = numPaths;
+    report.m_shortfallLevel = plan.m_shortfallLevel.value_or(plan.m_initialWealth + netFlows);
+
+    const double n = static_cast<double>(numPaths);
+    std::size_t numShort = 0;
+    double shortfallSum = 0.0;
+    for(std::size_t path = 0; path < numPaths; ++path)
+    {
+        report.m_meanTerminalWealth += terminalWealth[path];
+        report.m_meanTurnover += turnover[path];
+        report.m_meanCosts += costs[path];
+        report.m_depletionProbability += depleted[path];
+        if(terminalWealth[path] < report.m_shortfallLevel)
+        {
+            ++numShort;
+            shortfallSum += report.m_shortfallLevel - terminalWealth[path];
+        }
+    }
+    report.m_meanTerminalWealth /= n;
+    report.m_meanTurnover /= n;
+    report.m_meanCosts /= n;
+    report.m_depletionProbability /= n;
+    report.m_shortfallProbability = static_cast<double>(numShort) / n;
+    report.m_meanShortfall = (numShort > 0) ? shortfallSum / static_cast<double>(numShort) : 0.0;
+
+    const std::vector<QuantileSelection::OrderStatistic> quantiles = QuantileSelection::Select(terminalWealth, { 0.5, 1.0 - confidence });
+    report.m_medianTerminalWealth = quantiles[0].m_value;
+    report.m_terminalWealthAtRisk = quantiles[1].m_value;
+    report.m_terminalWealth = std::move(terminalWealth);
+
+    return report;
+}
+
+template <typename Real>
+BasicReturns<Real> BasicMonteCarloEngine<Real>::GenerateReturnsFromBootstrap(
+    const std::vector<std::vector<double>>& logReturnsMat,
+    const std::vector<double>& weights,
+    std::size_t numPaths,
+    std::size_t numDays,
+    const BootstrapOptions& options,
+    const SimulationOptions& simulation) const
+{
+    assert(!logReturnsMat.empty());
+    assert(logReturnsMat[0].size() == weights.size());
+    assert(options.m_blockLength >= 1.0);
+
+    // collapse the history to portfolio returns once; every path is then just a gather of blocks. a day with a
+    // missing return is dropped rather than read as flat, which would understate the risk of that day
+    std::vector<Real> history;
+    history.reserve(2 * logReturnsMat.size());
+    double historySum = 0.0;
+    double historySqSum = 0.0;
+    for(const std::vector<double>& day : logReturnsMat)
+    {
+        if(!std::all_of(day.begin(), day.end(), [](double assetReturn) { return std::isfinite(assetReturn); }))
+            continue;
+
+        const double portfolioReturn = std::inner_product(weights.begin(), weights.end(), day.begin(), 0.0);
+        history.push_back(static_cast<Real>(portfolioReturn));
+        historySum += portfolioReturn;
+        historySqSum += portfolioReturn * portfolioReturn;
+    }
+
+    const std::size_t historyLength = history.size();
+    assert(historyLength > 0);
+
+    // the series is stored twice back to back so a block wrapping past the end is still one contiguous copy
+    history.resize(2 * historyLength);
+    std::copy_n(history.begin(), historyLength, history.begin() + static_cast<std::ptrdiff_t>(historyLength));
+
+    BasicReturns<Real> returns;
+    PrepareOutput(returns, numPaths, numDays, simulation, m_pathBuffer);
+    returns.m_stepDrift = historySum / static_cast<double>(historyLength);
+    returns.m_stepStdDev = std::sqrt(std::max(historySqSum / static_cast<double>(historyLength) - returns.m_stepDrift * returns.m_stepDrift, 0.0));
+
+    const std::size_t maxBlock = std::min<std::size_t>(historyLength, numDays);
+    const std::size_t fixedBlock = std::min<std::size_t>(static_cast<std::size_t>(options.m_blockLength), maxBlock);
+    const double logContinue = std::log(1.0 - 1.0 / options.m_blockLength);
+    const bool stationary = (options.m_scheme == BootstrapScheme::Stationary) && logContinue < 0.0;
+
+    // a path uses at most numDays blocks of two draws each (start and length)
+    const uint64_t pathStride = 2 * static_cast<uint64_t>(numDays);
+    const GenNormalPCG runStream = ReserveStream(pathStride * numPaths);
+
+    const PathBlocks blocks = SplitIntoBlocks(numPaths);
+    FanChartCollector<Real> fanChart(simulation, numPaths, blocks, numDays, returns.m_stepDrift, returns.m_stepStdDev);
+    HorizonCollector<Real> horizons(simulation, blocks, returns.m_stepDrift, returns.m_stepStdDev);
+
+    ThreadPool::Instance().ParallelFor(0, numPaths, [&](std::size_t startPath, std::size_t endPath) {
+        const Real* historyPtr = history.data();
+        Real* returnsPtr = PathStorage(returns, m_pathBuffer);
+        std::vector<Real> scratch(simulation.m_storePaths ? 0 : numDays);
+        std::vector<double> cumulative(numDays);
+
+        for(std::size_t path = startPath; path < endPath; ++path)
+        {
+            GenNormalPCG rng = runStream.Jump(path * pathStride);
+
+            const auto drawBlock = [&](std::size_t& start, std::size_t& length) {
+                start = static_cast<std::size_t>(rng.NextBelow(historyLength));
+                if(stationary)
+                {
+                    const double u = 1.0 - rng.NextUniform();
+                    length = std::min<std::size_t>(1 + static_cast<std::size_t>(std::log(u) / logContinue), maxBlock);
+                }
+                else
+                {
+                    rng.NextUniform();
+                    length = fixedBlock;
+                }
+            };
+
+            // the next block is drawn before the current one is copied, so its source can be prefetched
+            std::size_t start, length;
+            drawBlock(start, length);
+
+            Real* out = simulation.m_storePaths ? returnsPtr + path * numDays : scratch.data();
+            std::size_t filled = 0;
+            while(filled < numDays)
+            {
+                std::size_t nextStart = 0, nextLength = 0;
+                const std::size_t count = std::min(length, numDays - filled);
+                if(filled + count < numDays)
+                {
+                    drawBlock(nextStart, nextLength);
+#if defined(__GNUC__)
+                    __builtin_prefetch(historyPtr + nextStart);
+#endif
+                }
+
+                std::copy(historyPtr + start, historyPtr + start + count, out + filled);
+                filled += count;
+                start = nextStart;
+                length = nextLength;
+            }
+
+            FinishPath(out, numDays, path, simulation, returns, fanChart, horizons, cumulative.data());
+        }
+    }, CollectorGrain(blocks, fanChart, horizons));
+    fanChart.Finish(returns.m_fanChart);
+    horizons.Finish(returns.m_horizons);
+
+    return returns;
+}
+
+template <typename Real>
+BasicReturns<Real> BasicMonteCarloEngine<Real>::GenerateReturnsForGarch(const GarchParams& params, std::size_t numPaths, std::size_t numDays, const SimulationOptions& options) const
+{
+    assert(params.m_omega > 0.0 && params.m_alpha >= 0.0 && params.m_beta >= 0.0);
+    assert(params.m_alpha + params.m_gamma >= 0.0);
+    // the unconditional variance, and with it the fan chart's step scale, only exists for a stationary model
+    assert(params.Persistence() < 1.0);
+    assert(options.m_varianceReduction == VarianceReduction::None);
+
+    BasicReturns<Real> returns;
+    PrepareOutput(returns, numPaths, numDays, options, m_pathBuffer);
+    returns.m_stepDrift = params.m_mu;
+    returns.m_stepStdDev = std::sqrt(params.UnconditionalVariance());
+
+    // the first step's variance follows from the last observed state and is shared by every path
+    const double firstVariance = params.NextVariance(params.m_lastVariance, params.m_lastResidual);
+
+    // each path owns a fixed slice of the run's stream; the paths of a lane group are consecutive,
+    // so one jump per group followed by back-to-back fills lands every path on its own slice
+    const uint64_t pathStride = GenNormalPCG::DrawsFor(numDays);
+    const GenNormalPCG runStream = ReserveStream(pathStride * numPaths);
+    const std::size_t numGroups = (numPaths + GARCH_LANES - 1) / GARCH_LANES;
+
+    const PathBlocks blocks = SplitIntoBlocks(numPaths, GARCH_LANES);
+    FanChartCollector<Real> fanChart(options, numPaths, blocks, numDays, returns.m_stepDrift, returns.m_stepStdDev);
+    HorizonCollector<Real> horizons(options, blocks, returns.m_stepDrift, returns.m_stepStdDev);
+
+    ThreadPool::Instance().ParallelFor(0, numGroups, [&](std::size_t startGroup, std::size_t endGroup) {
+        std::vector<Real> lanes(GARCH_LANES * numDays);
+        std::vector<Real> shocks(numDays);
+        std::vector<Real> scratch(options.m_storePaths ? 0 : numDays);
+        std::vector<double> cumulative(numDays);
+
+        Real* returnsPtr = PathStorage(returns, m_pathBuffer);
+        for(std::size_t group = startGroup; group < endGroup; ++group)
+        {
+            const std::size_t firstPath = group * GARCH_LANES;
+            const std::size_t activeLanes = std::min(GARCH_LANES, numPaths - firstPath);
+            GenNormalPCG rng = runStream.Jump(firstPath * pathStride);
+
+            // shocks are drawn per path and transposed to day-major so the kernel reads one row per day;
+            // unused lanes of the last group run on zero shocks and are never stored
+            for(std::size_t lane = 0; lane < GARCH_LANES; ++lane)
+            {
+                if(lane < activeLanes)
+                {
+                    rng.Fill(shocks.data(), numDays);
+                }
+                else
+                {
+                    std::fill(shocks.begin(), shocks.end(), Real(0));
+                }
+
+                for(std::size_t dayIdx = 0; dayIdx < numDays; ++dayIdx)
+                {
+                    lanes[dayIdx * GARCH_LANES + lane] = shocks[dayIdx];
+                }
+            }
+
+            GarchLaneKernel(lanes.data(), numDays, params, firstVariance);
+
+            for(std::size_t lane = 0; lane < activeLanes; ++lane)
+            {
+                Real* out = options.m_storePaths ? returnsPtr + (firstPath + lane) * numDays : scratch.data();
+                for(std::size_t dayIdx = 0; dayIdx < numDays; ++dayIdx)
+                {
+                    out[dayIdx] = lanes[dayIdx * GARCH_LANES + lane];
+                }
+                FinishPath(out, numDays, firstPath + lane, options, returns, fanChart, horizons, cumulative.data());
+            }
+        }
+    }, CollectorGrain(blocks, fanChart, horizons));
+    fanChart.Finish(returns.m_fanChart);
+    horizons.Finish(returns.m_horizons);
+
+    return returns;
+}
+
+/*
+Each regime's multi-asset shock only reaches the output through the weights, so w^T (mu_k dt + L_k sqrt(dt) eps)
+is a normal with a per-regime mean and standard deviation; the per-regime GEMM against the factor collapses to a
+scalar affine map. The kernel then needs no grouping of paths by regime: every path-step looks its regime's two
+coefficients up in a K-entry table, and the chain itself advances by a branch-free threshold count.
+*/
+template <typename Real>
+BasicReturns<Real> BasicMonteCarloEngine<Real>::GenerateReturnsForRegimeSwitching(
+    const RegimeSwitchingModel& model,
+    const std::vector<double>& weights,
+    std::size_t numPaths,
+    std::size_t numDays,
+    const SimulationOptions& options) const
+{
+    const std::size_t numRegimes = model.m_regimes.size();
+    assert(numRegimes > 0 && model.m_transitionMatrix.size() == numRegimes);
+    assert(model.m_initialRegime < numRegimes);
+    assert(options.m_varianceReduction == VarianceReduction::None);
 
     const double dt = 1.0 / static_cast<double>(numDays);
-    const double sqrtDt = std::sqrt(dt);
+    const Eigen::Map<const Eigen::VectorXd> weightVec(weights.data(), static_cast<Eigen::Index>(weights.size()));
 
-    double totalDrift = 0.0;
-    if(!ignoreDrift)
+    std::vector<double> regimeDrift(numRegimes);
+    std::vector<double> regimeStdDev(numRegimes);
+    for(std::size_t regime = 0; regime < numRegimes; ++regime)
     {
-        for(std::size_t i = 0; i < numAssets; ++i) 
+        const MarketRegime& params = model.m_regimes[regime];
+        assert(params.m_drifts.size() == weights.size());
+
+        double drift = 0.0;
+        for(std::size_t i = 0; i < weights.size(); ++i)
         {
-            totalDrift += weights[i] * assetStatistics[i].first * dt;
+            drift += weights[i] * params.m_drifts[i];
         }
-    }
-    else
-    {
-        // use an arbitrary risk free rate (should probably put this as an argument)
-        double riskFreeRate = 0.04;
-        totalDrift = riskFreeRate * dt;
-    }
 
-    // represents the raw risk of each position in isolation
-    Eigen::VectorXd positionRisks(numAssets);
-    for(std::size_t i = 0; i < numAssets; ++i) 
-    {
-        positionRisks(i) = weights[i] * (assetStatistics[i].second * sqrtDt);
+        regimeDrift[regime] = drift * dt;
+        regimeStdDev[regime] = (weightVec.transpose() * params.m_choleskyMatrix).norm() * std::sqrt(dt);
     }
 
-    // pre-calculate (Vol^T * L)
-    // project the position risks onto the independent Cholesky factors
-    Eigen::VectorXd exposureToIndependentFactors = positionRisks.transpose() * choleskyMatrix;
-
-    // since factors are independent, total variance is the sum of squared exposures
-    const double portfolioStepStdDev = exposureToIndependentFactors.norm();
+    // row-wise cumulative transition probabilities: the next regime is the number of thresholds a uniform clears.
+    // the last threshold of each row is pushed past 1 so rounding in a row sum can never leave the chain
+    std::vector<Real> thresholds(numRegimes * numRegimes);
+    for(std::size_t from = 0; from < numRegimes; ++from)
+    {
+        assert(model.m_transitionMatrix[from].size() == numRegimes);
 
-    const std::size_t NUM_THREADS = std::thread::hardware_concurrency();
-    std::vector<std::thread> threads;
-    threads.reserve(NUM_THREADS);
+        double cdf = 0.0;
+        for(std::size_t to = 0; to < numRegimes; ++to)
+        {
+            cdf += model.m_transitionMatrix[from][to];
+            thresholds[from * numRegimes + to] = (to + 1 < numRegimes) ? static_cast<Real>(cdf) : Real(2);
+        }
+    }
 
-    const std::size_t pathsPerThread = numPaths / NUM_THREADS;
-    const std::size_t remainderPaths = numPaths % NUM_THREADS;
-    std::size_t currentStartPath = 0;
+    BasicReturns<Real> returns;
+    PrepareOutput(returns, numPaths, numDays, options, m_pathBuffer);
 
-    for(std::size_t threadIdx = 0; threadIdx < NUM_THREADS; ++threadIdx)
+    // per-step moments averaged over the horizon, from the regime distribution propagated from the initial regime
     {
-        const std::size_t count = pathsPerThread + (threadIdx < remainderPaths ? 1 : 0);
-        const std::size_t startPath = currentStartPath;
-        const std::size_t endPath = startPath + count;
-        currentStartPath = endPath;
+        std::vector<double> distribution(numRegimes, 0.0);
+        std::vector<double> next(numRegimes);
+        distribution[model.m_initialRegime] = 1.0;
 
-        threads.emplace_back([&, startPath, endPath, totalDrift]() {
-            thread_local GenNormalPCG rng; 
+        double meanSum = 0.0;
+        double secondMomentSum = 0.0;
+        for(std::size_t dayIdx = 0; dayIdx < numDays; ++dayIdx)
+        {
+            double mean = 0.0;
+            for(std::size_t regime = 0; regime < numRegimes; ++regime)
+            {
+                mean += distribution[regime] * regimeDrift[regime];
+                secondMomentSum += distribution[regime] * (regimeStdDev[regime] * regimeStdDev[regime] + regimeDrift[regime] * regimeDrift[regime]);
+            }
+            meanSum += mean;
 
-            double* returnsPtr = returns.m_returns.data();
-            for(std::size_t path = startPath; path < endPath; ++path)
+            std::fill(next.begin(), next.end(), 0.0);
+            for(std::size_t from = 0; from < numRegimes; ++from)
             {
-                std::size_t baseIdx = path * numDays;
-                for(std::size_t dayIdx = 0; dayIdx < numDays; ++dayIdx)
+                for(std::size_t to = 0; to < numRegimes; ++to)
                 {
-                    const double shock = rng(); 
-                    returnsPtr[baseIdx + dayIdx] = totalDrift + (portfolioStepStdDev * shock);
+                    next[to] += distribution[from] * model.m_transitionMatrix[from][to];
                 }
             }
-        });
-    }
+            distribution.swap(next);
+        }
 
-    for(std::thread& th : threads) 
-    {
-        th.join();
+        const double n = static_cast<double>(numDays);
+        returns.m_stepDrift = meanSum / n;
+        returns.m_stepStdDev = std::sqrt(std::max(secondMomentSum / n - returns.m_stepDrift * returns.m_stepDrift, 0.0));
     }
-    
-    return returns;
-}
 
-Returns MonteCarloEngine::GenerateReturnsForSingleAsset(double drift, double volatility, std::size_t numPaths/*1000000*/,  std::size_t numDays/*252*/) const
-{
-    Returns returns;
-    returns.m_returns.resize(numPaths * numDays);
-    returns.m_blockSize = numDays;
+    std::vector<Real> drifts(regimeDrift.begin(), regimeDrift.end());
+    std::vector<Real> stdDevs(regimeStdDev.begin(), regimeStdDev.end());
 
-    const double dt = 1.0 / static_cast<double>(numDays);
-    const double dailyVolatility = volatility * std::sqrt(dt);
-    const double dailyDrift = drift * dt;
+    // every path consumes a fixed number of draws (its shocks, then one uniform per step), so a chunk jumps once
+    const uint64_t pathStride = GenNormalPCG::DrawsFor(numDays) + static_cast<uint64_t>(numDays);
+    const GenNormalPCG runStream = ReserveStream(pathStride * numPaths);
 
-    const std::size_t NUM_THREADS = std::thread::hardware_concurrency();
-    std::vector<std::thread> threads;
-    threads.reserve(NUM_THREADS);
+    const PathBlocks blocks = SplitIntoBlocks(numPaths);
+    FanChartCollector<Real> fanChart(options, numPaths, blocks, numDays, returns.m_stepDrift, returns.m_stepStdDev);
+    HorizonCollector<Real> horizons(options, blocks, returns.m_stepDrift, returns.m_stepStdDev);
 
-    const std::size_t pathsPerThread = numPaths / NUM_THREADS;
-    const std::size_t remainderPaths = numPaths % NUM_THREADS;
-    std::size_t currentStartPath = 0;
+    ThreadPool::Instance().ParallelFor(0, numPaths, [&](std::size_t startPath, std::size_t endPath) {
+        GenNormalPCG rng = runStream.Jump(startPath * pathStride);
+        std::vector<Real> shocks(numDays);
+        std::vector<Real> uniforms(numDays);
+        std::vector<Real> scratch(options.m_storePaths ? 0 : numDays);
+        std::vector<double> cumulative(numDays);
 
-    for(std::size_t threadIdx = 0; threadIdx < NUM_THREADS; ++threadIdx)
-    {
-        const std::size_t count = pathsPerThread + (threadIdx < remainderPaths ? 1 : 0);
-        const std::size_t startPath = currentStartPath;
-        const std::size_t endPath = startPath + count;
-        currentStartPath = endPath;
+        Real* returnsPtr = PathStorage(returns, m_pathBuffer);
+        for(std::size_t path = startPath; path < endPath; ++path)
+        {
+            rng.Fill(shocks.data(), numDays);
+            rng.FillUniform(uniforms.data(), numDays);
 
-        threads.emplace_back([&, threadIdx, startPath, endPath, dailyDrift, dailyVolatility]() {
-            thread_local static GenNormalPCG rng;
+            Real* out = options.m_storePaths ? returnsPtr + path * numDays : scratch.data();
+            std::size_t regime = model.m_initialRegime;
+            for(std::size_t dayIdx = 0; dayIdx < numDays; ++dayIdx)
+            {
+                out[dayIdx] = drifts[regime] + stdDevs[regime] * shocks[dayIdx];
 
-            double* returnsPtr = returns.m_returns.data();
-            for(std::size_t path = startPath; path < endPath; ++path)
-            {                
-                std::size_t baseIdx = path * numDays;
-                for(std::size_t dayIdx = 0; dayIdx < numDays; ++dayIdx)
+                const Real* row = thresholds.data() + regime * numRegimes;
+                std::size_t nextRegime = 0;
+                for(std::size_t to = 0; to < numRegimes; ++to)
                 {
-                    const double shock = rng();
-                    returnsPtr[baseIdx + dayIdx] = dailyDrift + (dailyVolatility * shock);
+                    nextRegime += (uniforms[dayIdx] >= row[to]) ? 1 : 0;
                 }
+                regime = nextRegime;
             }
-        });
-    }
 
-    for(std::thread& th : threads)
-    {
-        th.join();
-    }
+            FinishPath(out, numDays, path, options, returns, fanChart, horizons, cumulative.data());
+        }
+    }, CollectorGrain(blocks, fanChart, horizons));
+    fanChart.Finish(returns.m_fanChart);
+    horizons.Finish(returns.m_horizons);
 
     return returns;
 }
 
-Returns MonteCarloEngine::BuildPricePaths(const Returns& returns, double initialPrice) 
+template <typename Real>
+BasicReturns<Real> BasicMonteCarloEngine<Real>::BuildPricePaths(const BasicReturns<Real>& returns, double initialPrice) 
 {
-    std::size_t n = returns.m_returns.size();
-    
-    Returns prices;
-    prices.m_returns.resize(n);
-    prices.m_blockSize = returns.m_blockSize;
+    assert(returns.m_output == SimulationOutput::LogReturns);
 
-    double S = initialPrice;
-    std::size_t idx = 0;
-    while(idx < n)
-    {
-        if(idx % returns.m_blockSize == 0)
+    const std::size_t numDays = returns.m_blockSize;
+    const std::size_t numPaths = returns.m_returns.size() / numDays;
+
+    BasicReturns<Real> prices;
+    prices.m_returns.resize(returns.m_returns.size());
+    prices.m_blockSize = numDays;
+    prices.m_stepDrift = returns.m_stepDrift;
+    prices.m_stepStdDev = returns.m_stepStdDev;
+    prices.m_varianceReduction = returns.m_varianceReduction;
+    prices.m_tailTilt = returns.m_tailTilt;
+    prices.m_weights = returns.m_weights;
+    prices.m_output = SimulationOutput::PricePaths;
+    prices.m_initialPrice = initialPrice;
+
+    ThreadPool::Instance().ParallelFor(0, numPaths, [&](std::size_t startPath, std::size_t endPath) {
+        std::vector<double> cumulative(numDays);
+        for(std::size_t path = startPath; path < endPath; ++path)
         {
-            S = initialPrice;
+            const std::size_t baseIdx = path * numDays;
+            LogReturnsToPrices(returns.m_returns.data() + baseIdx, prices.m_returns.data() + baseIdx, numDays, initialPrice, cumulative.data());
         }
-
-        S *= std::exp(returns.m_returns[idx]);
-        prices.m_returns[idx] = S;
-        idx++;
-    }
+    });
 
     return prices;
 }
 
-std::pair<double, double> MonteCarloEngine::ComputeAssetStatistics(const std::size_t assetIdx, const std::vector<std::vector<double>>& assetReturns, bool annualise)
+template <typename Real>
+void BasicMonteCarloEngine<Real>::BuildPricePathsInPlace(BasicReturns<Real>& returns, double initialPrice)
+{
+    assert(returns.m_output == SimulationOutput::LogReturns);
+
+    const std::size_t numDays = returns.m_blockSize;
+    const std::size_t numPaths = returns.m_returns.size() / numDays;
+
+    ThreadPool::Instance().ParallelFor(0, numPaths, [&](std::size_t startPath, std::size_t endPath) {
+        std::vector<double> cumulative(numDays);
+        for(std::size_t path = startPath; path < endPath; ++path)
+        {
+            Real* pathPtr = returns.m_returns.data() + path * numDays;
+            LogReturnsToPrices(pathPtr, pathPtr, numDays, initialPrice, cumulative.data());
+        }
+    });
+
+    returns.m_output = SimulationOutput::PricePaths;
+    returns.m_initialPrice = initialPrice;
+}
+
+template <typename Real>
+std::pair<double, double> BasicMonteCarloEngine<Real>::ComputeAssetStatistics(const std::size_t assetIdx, const std::vector<std::vector<double>>& assetReturns, bool annualise)
 {
     assert(!assetReturns.empty());
 
@@ -209,7 +1532,8 @@ std::pair<double, double> MonteCarloEngine::ComputeAssetStatistics(const std::si
     return { mean, stddev };
 }
 
-std::vector<std::pair<double, double>> MonteCarloEngine::ComputeMultiAssetStatistics(const std::vector<std::vector<double>>& returns, bool annualise)
+template <typename Real>
+std::vector<std::pair<double, double>> BasicMonteCarloEngine<Real>::ComputeMultiAssetStatistics(const std::vector<std::vector<double>>& returns, bool annualise)
 {
     const std::size_t numDays = returns.size();
     assert(numDays > 0);
@@ -228,7 +1552,8 @@ std::vector<std::pair<double, double>> MonteCarloEngine::ComputeMultiAssetStatis
     return statistics;
 }
 
-std::vector<double> MonteCarloEngine::CombineAssetReturns(const Portfolio& portfolio)
+template <typename Real>
+std::vector<double> BasicMonteCarloEngine<Real>::CombineAssetReturns(const Portfolio& portfolio)
 {
     const std::vector<double>& weights = portfolio.GetWeights();
     const std::vector<std::string>& tickers = portfolio.GetTickers();
@@ -252,3 +1577,609 @@ std::vector<double> MonteCarloEngine::CombineAssetReturns(const Portfolio& portf
 
     return portfolioReturns;
 }
+
+
+template <typename Real>
+std::vector<double> BasicMonteCarloEngine<Real>::ComputeTailDegreesOfFreedom(const std::vector<std::vector<double>>& returns) const
+{
+    assert(!returns.empty());
+
+    const std::size_t numAssets = returns[0].size();
+    std::vector<double> degreesOfFreedom(numAssets, MAX_DEGREES_OF_FREEDOM);
+
+    for(std::size_t asset = 0; asset < numAssets; ++asset)
+    {
+        double sum = 0.0;
+        std::size_t count = 0;
+        for(const std::vector<double>& tReturns : returns)
+        {
+            if(std::isfinite(tReturns[asset]))
+            {
+                sum += tReturns[asset];
+                ++count;
+            }
+        }
+        if(count < 4)
+            continue;
+
+        const double mean = sum / static_cast<double>(count);
+        double m2 = 0.0;
+        double m4 = 0.0;
+        for(const std::vector<double>& tReturns : returns)
+        {
+            if(std::isfinite(tReturns[asset]))
+            {
+                const double d2 = (tReturns[asset] - mean) * (tReturns[asset] - mean);
+                m2 += d2;
+                m4 += d2 * d2;
+            }
+        }
+        m2 /= static_cast<double>(count);
+        m4 /= static_cast<double>(count);
+
+        // a t with nu > 4 degrees of freedom has excess kurtosis 6 / (nu - 4)
+        const double excessKurtosis = (m2 > 0.0) ? m4 / (m2 * m2) - 3.0 : 0.0;
+        const double nu = (excessKurtosis > 0.0) ? 4.0 + 6.0 / excessKurtosis : MAX_DEGREES_OF_FREEDOM;
+        degreesOfFreedom[asset] = std::round(std::clamp(nu, MIN_DEGREES_OF_FREEDOM, MAX_DEGREES_OF_FREEDOM) * 2.0) / 2.0;
+    }
+
+    return degreesOfFreedom;
+}
+
+template <typename Real>
+VarianceReductionReport BasicMonteCarloEngine<Real>::EvaluateVarianceReduction(const BasicReturns<Real>& returns, double confidence) const
+{
+    assert(returns.m_blockSize > 0);
+
+    const std::size_t numDays = returns.m_blockSize;
+    const std::size_t numPaths = returns.GetNumPaths();
+    assert(numPaths > 1);
+
+    const double n = static_cast<double>(numPaths);
+
+    // terminal log-returns (control variate) and terminal simple returns (target)
+    const std::vector<double> terminalLogReturns = ComputeTerminalLogReturns(returns);
+    std::vector<double> terminalReturns(numPaths);
+    for(std::size_t path = 0; path < numPaths; ++path)
+    {
+        terminalReturns[path] = std::expm1(terminalLogReturns[path]);
+    }
+
+    const double plainMean = std::accumulate(terminalReturns.begin(), terminalReturns.end(), 0.0) / n;
+    double plainVariance = 0.0;
+    for(double y : terminalReturns)
+    {
+        plainVariance += (y - plainMean) * (y - plainMean);
+    }
+    plainVariance /= (n - 1.0);
+
+    VarianceReductionReport report;
+    report.m_mode = returns.m_varianceReduction;
+    report.m_numPaths = numPaths;
+    report.m_meanTerminalReturn = plainMean;
+    report.m_standardError = std::sqrt(plainVariance / n);
+    report.m_effectiveSampleSize = n;
+    report.m_varianceRatio = 1.0;
+
+    const std::vector<double> unitWeights;
+    const std::vector<double>& weights = (returns.m_varianceReduction == VarianceReduction::TailImportanceSampling) ? returns.m_weights : unitWeights;
+    const std::pair<double, double> tail = WeightedTailRisk(terminalReturns, weights, confidence);
+    report.m_VaR = tail.first;
+    report.m_CVaR = tail.second;
+
+    switch(returns.m_varianceReduction)
+    {
+        case VarianceReduction::None:
+            break;
+
+        case VarianceReduction::Antithetic:
+        {
+            // each antithetic pair is a single independent observation
+            const std::size_t numPairs = numPaths / 2;
+            if(numPairs < 2)
+                break;
+
+            double pairMean = 0.0;
+            for(std::size_t pair = 0; pair < numPairs; ++pair)
+            {
+                pairMean += 0.5 * (terminalReturns[2 * pair] + terminalReturns[2 * pair + 1]);
+            }
+            pairMean /= static_cast<double>(numPairs);
+
+            double pairVariance = 0.0;
+            for(std::size_t pair = 0; pair < numPairs; ++pair)
+            {
+                const double dev = 0.5 * (terminalReturns[2 * pair] + terminalReturns[2 * pair + 1]) - pairMean;
+                pairVariance += dev * dev;
+            }
+            pairVariance /= static_cast<double>(numPairs - 1);
+
+            const double estimatorVariance = pairVariance / static_cast<double>(numPairs);
+            report.m_meanTerminalReturn = pairMean;
+            report.m_standardError = std::sqrt(estimatorVariance);
+            report.m_varianceRatio = (estimatorVariance > 0.0) ? (plainVariance / n) / estimatorVariance : 1.0;
+            report.m_effectiveSampleSize = n * report.m_varianceRatio;
+            break;
+        }
+
+        case VarianceReduction::ControlVariate:
+        {
+            // the terminal log-return is Gaussian with a known mean under GBM, so it makes an exact control
+            const double expectedControl = static_cast<double>(numDays) * returns.m_stepDrift;
+            const double controlMean = std::accumulate(terminalLogReturns.begin(), terminalLogReturns.end(), 0.0) / n;
+
+            double covariance = 0.0;
+            double controlVariance = 0.0;
+            for(std::size_t path = 0; path < numPaths; ++path)
+            {
+                const double dc = terminalLogReturns[path] - controlMean;
+                covariance += (terminalReturns[path] - plainMean) * dc;
+                controlVariance += dc * dc;
+            }
+            covariance /= (n - 1.0);
+            controlVariance /= (n - 1.0);
+
+            if(controlVariance <= 0.0 || plainVariance <= 0.0)
+                break;
+
+            const double beta = covariance / controlVariance;
+            const double rhoSquared = std::min(covariance * covariance / (controlVariance * plainVariance), 1.0 - 1e-12);
+
+            report.m_meanTerminalReturn = plainMean - beta * (controlMean - expectedControl);
+            report.m_standardError = std::sqrt(plainVariance * (1.0 - rhoSquared) / n);
+            report.m_varianceRatio = 1.0 / (1.0 - rhoSquared);
+            report.m_effectiveSampleSize = n * report.m_varianceRatio;
+            break;
+        }
+
+        case VarianceReduction::TailImportanceSampling:
+        {
+            assert(weights.size() == numPaths);
+
+            double weightSum = 0.0;
+            double weightSqSum = 0.0;
+            double weightedMean = 0.0;
+            for(std::size_t path = 0; path < numPaths; ++path)
+            {
+                weightSum += weights[path];
+                weightSqSum += weights[path] * weights[path];
+                weightedMean += weights[path] * terminalReturns[path];
+            }
+            weightedMean /= n;
+
+            double weightedVariance = 0.0;
+            for(std::size_t path = 0; path < numPaths; ++path)
+            {
+                const double dev = weights[path] * terminalReturns[path] - weightedMean;
+                weightedVariance += dev * dev;
+            }
+            weightedVariance /= (n - 1.0);
+
+            // efficiency is judged on the tail probability at the VaR level, which is what the tilt targets
+            const double tailProbability = 1.0 - confidence;
+            double tailSum = 0.0;
+            double tailSqSum = 0.0;
+            for(std::size_t path = 0; path < numPaths; ++path)
+            {
+                if(terminalReturns[path] <= -report.m_VaR)
+                {
+                    tailSum += weights[path];
+                    tailSqSum += weights[path] * weights[path];
+                }
+            }
+            const double tailMean = tailSum / n;
+            const double tailVariance = tailSqSum / n - tailMean * tailMean;
+
+            report.m_meanTerminalReturn = weightedMean;
+            report.m_standardError = std::sqrt(weightedVariance / n);
+            report.m_effectiveSampleSize = (weightSqSum > 0.0) ? weightSum * weightSum / weightSqSum : 0.0;
+            report.m_varianceRatio = (tailVariance > 0.0) ? tailProbability * (1.0 - tailProbability) / tailVariance : 1.0;
+            break;
+        }
+    }
+
+    return report;
+}
+
+template <typename Real>
+std::vector<double> BasicMonteCarloEngine<Real>::ComputeTerminalLogReturns(const BasicReturns<Real>& returns) const
+{
+    // paths that were not stored still carry their terminal log-returns in the path metrics
+    if(returns.m_returns.empty())
+    {
+        assert(!returns.m_pathMetrics.m_terminalLogReturns.empty());
+        return returns.m_pathMetrics.m_terminalLogReturns;
+    }
+
+    const std::size_t numDays = returns.m_blockSize;
+    const std::size_t numPaths = returns.m_returns.size() / numDays;
+
+    std::vector<double> terminalLogReturns(numPaths);
+    ThreadPool::Instance().ParallelFor(0, numPaths, [&](std::size_t startPath, std::size_t endPath) {
+        for(std::size_t path = startPath; path < endPath; ++path)
+        {
+            const Real* pathPtr = returns.m_returns.data() + path * numDays;
+            terminalLogReturns[path] = (returns.m_output == SimulationOutput::PricePaths)
+                ? std::log(static_cast<double>(pathPtr[numDays - 1]) / returns.m_initialPrice)
+                : std::accumulate(pathPtr, pathPtr + numDays, 0.0);
+        }
+    });
+
+    return terminalLogReturns;
+}
+
+template <typename Real>
+PathRiskReport BasicMonteCarloEngine<Real>::EvaluatePathMetrics(const BasicReturns<Real>& returns, double confidence) const
+{
+    const PathMetrics& metrics = returns.m_pathMetrics;
+    const std::size_t numPaths = metrics.m_maxDrawdowns.size();
+    assert(numPaths > 0);
+
+    // importance-sampled runs carry likelihood ratios with unit mean, plain runs weight every path by one
+    const bool weighted = !returns.m_weights.empty();
+    const auto weightOf = [&](std::size_t path) { return weighted ? returns.m_weights[path] : 1.0; };
+
+    double hitMass = 0.0;
+    double hitDaySum = 0.0;
+    double drawdownSum = 0.0;
+    double underWaterSum = 0.0;
+    for(std::size_t path = 0; path < numPaths; ++path)
+    {
+        const double weight = weightOf(path);
+        drawdownSum += weight * metrics.m_maxDrawdowns[path];
+        underWaterSum += weight * static_cast<double>(metrics.m_daysUnderWater[path]);
+        if(metrics.m_firstPassageDays[path] >= 0)
+        {
+            hitMass += weight;
+            hitDaySum += weight * static_cast<double>(metrics.m_firstPassageDays[path]);
+        }
+    }
+
+    const double n = static_cast<double>(numPaths);
+
+    PathRiskReport report;
+    report.m_numPaths = numPaths;
+    report.m_lossBarrier = metrics.m_lossBarrier;
+    report.m_barrierHitProbability = hitMass / n;
+    report.m_meanFirstPassageDay = (hitMass > 0.0) ? hitDaySum / hitMass : 0.0;
+    report.m_meanMaxDrawdown = drawdownSum / n;
+    report.m_meanDaysUnderWater = underWaterSum / n;
+
+    // WeightedTailRisk works on the lower tail, so drawdowns are negated
+    std::vector<double> negatedDrawdowns(numPaths);
+    for(std::size_t path = 0; path < numPaths; ++path)
+    {
+        negatedDrawdowns[path] = -metrics.m_maxDrawdowns[path];
+    }
+    report.m_maxDrawdownAtConfidence = WeightedTailRisk(negatedDrawdowns, returns.m_weights, confidence).first;
+
+    return report;
+}
+
+template <typename Real>
+std::vector<HorizonRisk> BasicMonteCarloEngine<Real>::EvaluateHorizons(const BasicReturns<Real>& returns, double confidence) const
+{
+    const HorizonSketches& horizons = returns.m_horizons;
+    assert(!horizons.m_days.empty() && horizons.m_sketches.size() == horizons.m_days.size());
+
+    // importance-sampled paths went into the sketches with their likelihood ratios, so these are already unbiased
+    const double tailProbability = 1.0 - confidence;
+    std::vector<HorizonRisk> risks;
+    risks.reserve(horizons.m_days.size());
+    for(std::size_t checkpoint = 0; checkpoint < horizons.m_days.size(); ++checkpoint)
+    {
+        const HistogramSketch& sketch = horizons.m_sketches[checkpoint];
+        risks.push_back({ horizons.m_days[checkpoint], sketch.GetMean(), -sketch.Quantile(tailProbability), -sketch.TailMean(tailProbability) });
+    }
+
+    return risks;
+}
+
+
+/* -------------------------- PRIVATE METHODS ------------------------------ */
+
+template <typename Real>
+GenNormalPCG BasicMonteCarloEngine<Real>::ReserveStream(uint64_t numDraws) const
+{
+    std::lock_guard<std::mutex> lock(m_rngMutex);
+    return m_rng.Split(numDraws);
+}
+
+template <typename Real>
+BasicReturns<Real> BasicMonteCarloEngine<Real>::SimulateGaussianPaths(double stepDrift, double stepStdDev, std::size_t numPaths, std::size_t numDays, const SimulationOptions& options) const
+{
+    // the jump intensity is annual and a simulated year spans numDays steps, as in the drift and volatility scaling
+    const bool jumps = options.m_jumpIntensity > 0.0;
+    const double stepIntensity = options.m_jumpIntensity / static_cast<double>(numDays);
+    const double diffusionDrift = stepDrift - stepIntensity * options.m_jumpMean;
+
+    BasicReturns<Real> returns;
+    PrepareOutput(returns, numPaths, numDays, options, m_pathBuffer);
+    returns.m_stepDrift = stepDrift;
+    returns.m_stepStdDev = std::sqrt(stepStdDev * stepStdDev + stepIntensity * (options.m_jumpStdDev * options.m_jumpStdDev + options.m_jumpMean * options.m_jumpMean));
+    returns.m_varianceReduction = options.m_varianceReduction;
+
+    const bool antithetic = options.m_varianceReduction == VarianceReduction::Antithetic;
+    const bool importanceSampling = options.m_varianceReduction == VarianceReduction::TailImportanceSampling;
+
+    double tilt = 0.0;
+    if(importanceSampling)
+    {
+        // shift the terminal shock sum onto the VaR quantile: numDays * tilt / sqrt(numDays) = z_(1-confidence)
+        tilt = (options.m_tailTilt != 0.0) ? options.m_tailTilt : MathUtils::NormalQuantile(1.0 - options.m_tailConfidence) / std::sqrt(static_cast<double>(numDays));
+        returns.m_weights.resize(numPaths);
+    }
+    returns.m_tailTilt = tilt;
+
+    // log of the per-path likelihood ratio is -tilt * sum(shocks) + logRatioOffset
+    const double logRatioOffset = 0.5 * static_cast<double>(numDays) * tilt * tilt;
+
+    // an antithetic pair is generated from one shock buffer, so work is split in pairs
+    const std::size_t numUnits = antithetic ? (numPaths + 1) / 2 : numPaths;
+    const std::size_t pathsPerUnit = antithetic ? 2 : 1;
+
+    // each unit owns a fixed slice of the run's stream, so results do not depend on how chunks are scheduled
+    const uint64_t unitStride = GenNormalPCG::DrawsFor(numDays);
+    const GenNormalPCG runStream = ReserveStream(unitStride * numUnits);
+
+    // jumps come from a separate stream: one uniform per step, then at most one normal per step with a jump
+    const uint64_t jumpStride = static_cast<uint64_t>(numDays) + GenNormalPCG::DrawsFor(numDays);
+    const GenNormalPCG jumpStream = jumps ? ReserveStream(jumpStride * numUnits) : GenNormalPCG();
+
+    // a step has more than k jumps when its uniform clears the Poisson cdf at k
+    std::vector<Real> jumpThresholds(MAX_JUMPS_PER_STEP, Real(2));
+    if(jumps)
+    {
+        double probability = std::exp(-stepIntensity);
+        double cdf = probability;
+        for(std::size_t k = 0; k < MAX_JUMPS_PER_STEP; ++k)
+        {
+            jumpThresholds[k] = static_cast<Real>(cdf);
+            probability *= stepIntensity / static_cast<double>(k + 1);
+            cdf += probability;
+        }
+    }
+
+    const PathBlocks blocks = SplitIntoBlocks(numPaths, pathsPerUnit);
+    FanChartCollector<Real> fanChart(options, numPaths, blocks, numDays, returns.m_stepDrift, returns.m_stepStdDev);
+    HorizonCollector<Real> horizons(options, blocks, returns.m_stepDrift, returns.m_stepStdDev);
+
+    ThreadPool::Instance().ParallelFor(0, numUnits, [&](std::size_t startUnit, std::size_t endUnit) {
+        GenNormalPCG rng = runStream.Jump(startUnit * unitStride);
+        std::vector<Real> shocks(numDays);
+        std::vector<Real> jumpSizes(jumps ? numDays : 0);
+        std::vector<Real> uniforms(jumps ? numDays : 0);
+        std::vector<Real> scratch(options.m_storePaths ? 0 : numDays);
+        std::vector<double> cumulative(numDays);
+        std::vector<double> checkpointWeights(importanceSampling ? options.m_checkpointDays.size() : 0);
+
+        // shocks and stores run in Real, the likelihood-ratio sum is accumulated in double
+        const Real drift = static_cast<Real>(diffusionDrift);
+        const Real stdDev = static_cast<Real>(stepStdDev);
+        const Real shift = static_cast<Real>(tilt);
+
+        Real* returnsPtr = PathStorage(returns, m_pathBuffer);
+        for(std::size_t unit = startUnit; unit < endUnit; ++unit)
+        {
+            const std::size_t path = unit * pathsPerUnit;
+
+            rng.Fill(shocks.data(), numDays);
+
+            double shockSum = 0.0;
+            for(std::size_t dayIdx = 0; dayIdx < numDays; ++dayIdx)
+            {
+                shocks[dayIdx] += shift;
+                shockSum += shocks[dayIdx];
+            }
+
+            if(jumps)
+            {
+                GenNormalPCG jumpRng = jumpStream.Jump(unit * jumpStride);
+                jumpRng.FillUniform(uniforms.data(), numDays);
+
+                // jump counts for the whole path as a fixed-width compare-and-add with no branches; on almost
+                // every day this is zero, and the count is kept in the jump buffer until the sparse pass below
+                for(std::size_t dayIdx = 0; dayIdx < numDays; ++dayIdx)
+                {
+                    Real count = Real(0);
+                    for(std::size_t k = 0; k < MAX_JUMPS_PER_STEP; ++k)
+                    {
+                        count += (uniforms[dayIdx] >= jumpThresholds[k]) ? Real(1) : Real(0);
+                    }
+                    jumpSizes[dayIdx] = count;
+                }
+
+                // only the hits draw a size: k normal jumps sum to N(k mean, k variance)
+                const double jumpMean = options.m_jumpMean;
+                const double jumpStdDev = options.m_jumpStdDev;
+                for(std::size_t dayIdx = 0; dayIdx < numDays; ++dayIdx)
+                {
+                    const double count = static_cast<double>(jumpSizes[dayIdx]);
+                    if(count != 0.0)
+                    {
+                        jumpSizes[dayIdx] = static_cast<Real>(count * jumpMean + jumpStdDev * std::sqrt(count) * jumpRng());
+                    }
+                }
+            }
+
+            Real* out = options.m_storePaths ? returnsPtr + path * numDays : scratch.data();
+            for(std::size_t dayIdx = 0; dayIdx < numDays; ++dayIdx)
+            {
+                out[dayIdx] = drift + (stdDev * shocks[dayIdx]);
+            }
+            if(jumps)
+            {
+                for(std::size_t dayIdx = 0; dayIdx < numDays; ++dayIdx)
+                {
+                    out[dayIdx] += jumpSizes[dayIdx];
+                }
+            }
+            if(importanceSampling)
+            {
+                returns.m_weights[path] = std::exp(-tilt * shockSum + logRatioOffset);
+
+                // each checkpoint takes the likelihood ratio of the shocks it has seen, the path's ratio conditioned
+                // on them: just as unbiased, without the noise of the days after it
+                double partialSum = 0.0;
+                std::size_t dayIdx = 0;
+                for(std::size_t checkpoint = 0; checkpoint < checkpointWeights.size(); ++checkpoint)
+                {
+                    const std::size_t horizon = options.m_checkpointDays[checkpoint];
+                    for(; dayIdx < horizon; ++dayIdx)
+                    {
+                        partialSum += static_cast<double>(shocks[dayIdx]);
+                    }
+                    checkpointWeights[checkpoint] = std::exp(-tilt * partialSum + 0.5 * static_cast<double>(horizon) * tilt * tilt);
+                }
+            }
+            FinishPath(out, numDays, path, options, returns, fanChart, horizons, cumulative.data(), checkpointWeights.empty() ? nullptr : checkpointWeights.data());
+
+            if(antithetic && path + 1 < numPaths)
+            {
+                out = options.m_storePaths ? out + numDays : scratch.data();
+                for(std::size_t dayIdx = 0; dayIdx < numDays; ++dayIdx)
+                {
+                    out[dayIdx] = drift - (stdDev * shocks[dayIdx]);
+                }
+                // the pair shares its jumps, only the diffusion is mirrored
+                if(jumps)
+                {
+                    for(std::size_t dayIdx = 0; dayIdx < numDays; ++dayIdx)
+                    {
+                        out[dayIdx] += jumpSizes[dayIdx];
+                    }
+                }
+                FinishPath(out, numDays, path + 1, options, returns, fanChart, horizons, cumulative.data());
+            }
+        }
+    }, CollectorGrain(blocks, fanChart, horizons));
+    fanChart.Finish(returns.m_fanChart);
+    horizons.Finish(returns.m_horizons);
+
+    return returns;
+}
+
+/*
+Each asset's shock is a correlated normal scaled by sqrt((nu_i - 2) / W_i), a unit-variance t with nu_i degrees of
+freedom. W_i is chi-square with nu_i degrees of freedom, and all of them come from one Marsaglia-Tsang draw per
+path-step: the accepted normal z is mapped through each asset's own (d, c) as W_i = 2 d_i (1 + c_i z)^3, which is
+exact for the heaviest-tailed asset (whose shape drives the sampler) and the Wilson-Hilferty approximation for the
+rest, so the mixing is comonotone across assets.
+
+Assets with equal degrees of freedom share a scale s_g, so given the mixing draw the portfolio shock sum_g s_g y_g
+is a normal with variance s^T G s, where G is the covariance of the group exposures y = A L eps (A R A^T, or
+A (B B^T + D^2) A^T under a factor model, which the caller forms without the full n x n matrix). A path-step
+therefore takes one normal and one mixing draw however many groups there are. Both come from the polar method:
+a path's slice already has room for the gamma sampler's retries, and skipping Box-Muller's sine and cosine keeps
+a step within twice the cost of a Gaussian one.
+*/
+template <typename Real>
+BasicReturns<Real> BasicMonteCarloEngine<Real>::SimulateStudentTPaths(
+    double stepDrift,
+    const std::vector<double>& groupDof,
+    const Eigen::MatrixXd& groupCovariance,
+    std::size_t numPaths,
+    std::size_t numDays,
+    const SimulationOptions& options) const
+{
+    assert(options.m_varianceReduction == VarianceReduction::None);
+    assert(options.m_jumpIntensity == 0.0);
+    assert(groupDof.front() > 2.0);
+
+    const std::size_t numGroups = groupDof.size();
+    assert(static_cast<std::size_t>(groupCovariance.rows()) == numGroups && static_cast<std::size_t>(groupCovariance.cols()) == numGroups);
+
+    BasicReturns<Real> returns;
+    PrepareOutput(returns, numPaths, numDays, options, m_pathBuffer);
+    returns.m_stepDrift = stepDrift;
+    // unit-variance marginals, so this is exact for a single nu and close otherwise
+    returns.m_stepStdDev = std::sqrt(groupCovariance.sum());
+
+    // per group: W / nu = 2 d (1 + c z)^3 / nu, and the shock scale is sqrt(scaleNumerator / (1 + c z)^3)
+    const GammaSampler sampler(0.5 * groupDof.front());
+    std::vector<Real> groupC(numGroups);
+    std::vector<Real> scaleNumerator(numGroups);
+    for(std::size_t group = 0; group < numGroups; ++group)
+    {
+        const double d = 0.5 * groupDof[group] - 1.0 / 3.0;
+        groupC[group] = static_cast<Real>(1.0 / std::sqrt(9.0 * d));
+        scaleNumerator[group] = static_cast<Real>((groupDof[group] - 2.0) / (2.0 * d));
+    }
+
+    std::vector<Real> covariance(numGroups * numGroups);
+    for(std::size_t row = 0; row < numGroups; ++row)
+    {
+        for(std::size_t col = 0; col < numGroups; ++col)
+        {
+            covariance[row * numGroups + col] = static_cast<Real>(groupCovariance(static_cast<Eigen::Index>(row), static_cast<Eigen::Index>(col)));
+        }
+    }
+
+    const GenNormalPCG runStream = ReserveStream(STUDENT_T_PATH_STRIDE * numPaths);
+
+    const PathBlocks blocks = SplitIntoBlocks(numPaths);
+    FanChartCollector<Real> fanChart(options, numPaths, blocks, numDays, returns.m_stepDrift, returns.m_stepStdDev);
+    HorizonCollector<Real> horizons(options, blocks, returns.m_stepDrift, returns.m_stepStdDev);
+
+    // the per-step scales go through Eigen arrays, whose square roots vectorise where a loop over std::sqrt does not
+    using Array = Eigen::Array<Real, Eigen::Dynamic, 1>;
+    using ArrayMap = Eigen::Map<Array>;
+    const Eigen::Index days = static_cast<Eigen::Index>(numDays);
+
+    ThreadPool::Instance().ParallelFor(0, numPaths, [&](std::size_t startPath, std::size_t endPath) {
+        Array shocks(days);
+        Array mixing(days);
+        std::vector<Real> scratch(numDays);
+        Eigen::Array<Real, Eigen::Dynamic, Eigen::Dynamic> groupScales(days, static_cast<Eigen::Index>(numGroups > 1 ? numGroups : 0));
+        Array variance(numGroups > 1 ? days : 0);
+        std::vector<Real> pathScratch(options.m_storePaths ? 0 : numDays);
+        std::vector<double> cumulative(numDays);
+
+        const Real drift = static_cast<Real>(stepDrift);
+        const Real minBase = static_cast<Real>(1e-6);
+        Real* returnsPtr = PathStorage(returns, m_pathBuffer);
+
+        for(std::size_t path = startPath; path < endPath; ++path)
+        {
+            GenNormalPCG rng = runStream.Jump(path * STUDENT_T_PATH_STRIDE);
+            rng.FillPolar(shocks.data(), numDays);
+            sampler.FillAcceptedNormals(rng, mixing.data(), numDays, scratch);
+
+            Real* out = options.m_storePaths ? returnsPtr + path * numDays : pathScratch.data();
+            if(numGroups == 1)
+            {
+                const Real stdDev = std::sqrt(covariance[0]);
+                ArrayMap(out, days) = drift + stdDev * (scaleNumerator[0] / (Real(1) + groupC[0] * mixing).max(minBase).cube()).sqrt() * shocks;
+            }
+            else
+            {
+                for(std::size_t group = 0; group < numGroups; ++group)
+                {
+                    groupScales.col(static_cast<Eigen::Index>(group)) = (scaleNumerator[group] / (Real(1) + groupC[group] * mixing).max(minBase).cube()).sqrt();
+                }
+
+                variance.setZero();
+                for(std::size_t row = 0; row < numGroups; ++row)
+                {
+                    for(std::size_t col = 0; col <= row; ++col)
+                    {
+                        // off-diagonal terms appear twice in s^T G s
+                        const Real term = (col == row ? Real(1) : Real(2)) * covariance[row * numGroups + col];
+                        variance += term * groupScales.col(static_cast<Eigen::Index>(row)) * groupScales.col(static_cast<Eigen::Index>(col));
+                    }
+                }
+
+                ArrayMap(out, days) = drift + variance.max(Real(0)).sqrt() * shocks;
+            }
+
+            FinishPath(out, numDays, path, options, returns, fanChart, horizons, cumulative.data());
+        }
+    }, CollectorGrain(blocks, fanChart, horizons));
+    fanChart.Finish(returns.m_fanChart);
+    horizons.Finish(returns.m_horizons);
+
+    return returns;
+}
+
+template class BasicMonteCarloEngine<float>;
+template class BasicMonteCarloEngine<double>;
@@ -0,0 +1,342 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "../include/MultiProcessSimulation.hpp"
+#include "../include/RiskSketches.hpp"
+#include "../include/ThreadPool.hpp"
+
+namespace
+{
+    // terminal-return sketch resolution and range in standard deviations of the terminal log-return
+    constexpr std::size_t SKETCH_BINS = 4096;
+    constexpr double SKETCH_RANGE_STDDEVS = 8.0;
+
+    // worker slots start on their own cache lines
+    constexpr std::size_t SLOT_ALIGNMENT = 64;
+
+    // start of every worker's slot in the shared mapping, followed by its serialised sketch. the coordinator
+    // only reads it after waitpid, which orders the worker's writes before the reads
+    struct WorkerSlot
+    {
+        // 0 running, 1 finished, -1 failed
+        int32_t m_status;
+        uint64_t m_numPaths;
+        // terminal log-returns less the model's mean, so the squares do not cancel
+        double m_sum;
+        double m_sumSquares;
+    };
+
+    std::size_t RoundUp(std::size_t value, std::size_t multiple)
+    {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+
+    // sysfs CPU lists, e.g. "0-3,8,10-11"
+    std::vector<int> ParseCpuList(const std::string& list)
+    {
+        std::vector<int> cpus;
+        std::stringstream stream(list);
+        std::string range;
+        while(std::getline(stream, range, ','))
+        {
+            if(range.empty() || range == "\n")
+                continue;
+
+            const std::size_t dash = range.find('-');
+            const int first = std::stoi(range.substr(0, dash));
+            const int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+            for(int cpu = first; cpu <= last; ++cpu)
+            {
+                cpus.push_back(cpu);
+            }
+        }
+
+        return cpus;
+    }
+
+    // CPUs this process may run on (a container or taskset can restrict them)
+    std::vector<int> AllowedCpus()
+    {
+        std::vector<int> cpus;
+#if defined(__linux__)
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if(sched_getaffinity(0, sizeof(cpu_set_t), &allowed) == 0)
+        {
+            for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            {
+                if(CPU_ISSET(cpu, &allowed))
+                {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+#endif
+        if(cpus.empty())
+        {
+            const int numCpus = static_cast<int>(std::max<unsigned>(std::thread::hardware_concurrency(), 1));
+            for(int cpu = 0; cpu < numCpus; ++cpu)
+            {
+                cpus.push_back(cpu);
+            }
+        }
+
+        return cpus;
+    }
+
+    // allowed CPUs of every NUMA node that has any; a machine without sysfs node information is one node
+    std::vector<std::vector<int>> NumaNodeCpus(const std::vector<int>& allowed)
+    {
+        std::vector<std::vector<int>> nodes;
+        for(int node = 0; ; ++node)
+        {
+            std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if(!file)
+                break;
+
+            std::string list;
+            std::getline(file, list);
+
+            std::vector<int> cpus;
+            for(int cpu : ParseCpuList(list))
+            {
+                if(std::find(allowed.begin(), allowed.end(), cpu) != allowed.end())
+                {
+                    cpus.push_back(cpu);
+                }
+            }
+
+            if(!cpus.empty())
+            {
+                nodes.push_back(std::move(cpus));
+            }
+        }
+
+        if(nodes.empty())
+        {
+            nodes.push_back(allowed);
+        }
+
+        return nodes;
+    }
+
+    // one CPU set per worker: whole nodes when there are as many workers as nodes, otherwise the allowed CPUs
+    // dealt round-robin (sharing when there are more workers than CPUs)
+    std::vector<std::vector<int>> AssignCpus(std::size_t numProcesses, const std::vector<std::vector<int>>& nodes, const std::vector<int>& allowed)
+    {
+        if(numProcesses == nodes.size())
+            return nodes;
+
+        std::vector<std::vector<int>> groups(numProcesses);
+        for(std::size_t i = 0; i < allowed.size(); ++i)
+        {
+            groups[i % numProcesses].push_back(allowed[i]);
+        }
+        for(std::size_t worker = 0; worker < numProcesses; ++worker)
+        {
+            if(groups[worker].empty())
+            {
+                groups[worker].push_back(allowed[worker % allowed.size()]);
+            }
+        }
+
+        return groups;
+    }
+
+    template <typename Real>
+    void SimulateShards(
+        const ProcessRunConfig& config,
+        const ShardedSimulation::ShardGenerator<Real>& generate,
+        const SimulationOptions& options,
+        std::size_t firstShard,
+        std::size_t lastShard,
+        const HistogramSketch& identity,
+        double center,
+        WorkerSlot& slot)
+    {
+        HistogramSketch sketch = identity;
+        double sum = 0.0;
+        double sumSquares = 0.0;
+        uint64_t numPaths = 0;
+
+        for(std::size_t shard = firstShard; shard < lastShard; ++shard)
+        {
+            const std::size_t shardPaths = std::min(config.m_pathsPerShard, config.m_numPaths - shard * config.m_pathsPerShard);
+            const BasicMonteCarloEngine<Real> engine(config.m_seed, shard);
+            const BasicReturns<Real> returns = generate(engine, shardPaths, options);
+
+            for(double logReturn : engine.ComputeTerminalLogReturns(returns))
+            {
+                sketch.Add(std::expm1(logReturn));
+                const double deviation = logReturn - center;
+                sum += deviation;
+                sumSquares += deviation * deviation;
+            }
+            numPaths += shardPaths;
+        }
+
+        slot.m_numPaths = numPaths;
+        slot.m_sum = sum;
+        slot.m_sumSquares = sumSquares;
+        sketch.Serialise(reinterpret_cast<char*>(&slot) + sizeof(WorkerSlot));
+        slot.m_status = 1;
+    }
+}
+
+namespace MultiProcessSimulation
+{
+    template <typename Real>
+    ProcessRunResult Run(const ProcessRunConfig& config, const ShardedSimulation::ShardGenerator<Real>& generate, double confidence, const SimulationOptions& options)
+    {
+        assert(config.m_numPaths > 0 && config.m_numDays > 0 && config.m_pathsPerShard > 0);
+        assert(options.m_varianceReduction != VarianceReduction::TailImportanceSampling);
+
+        // only the terminal log-return of each path is needed, and the path metrics keep it
+        SimulationOptions workerOptions = options;
+        workerOptions.m_storePaths = false;
+        workerOptions.m_trackPathMetrics = true;
+        workerOptions.m_checkpointDays.clear();
+
+        const std::size_t numShards = (config.m_numPaths + config.m_pathsPerShard - 1) / config.m_pathsPerShard;
+
+        // one path from a substream no shard uses, just for the model's closed-form moments that size the sketch
+        const BasicMonteCarloEngine<Real> pilotEngine(config.m_seed, numShards);
+        const BasicReturns<Real> pilot = generate(pilotEngine, 1, workerOptions);
+        const double days = static_cast<double>(config.m_numDays);
+        const double center = pilot.m_stepDrift * days;
+        const double halfWidth = std::max(SKETCH_RANGE_STDDEVS * pilot.m_stepStdDev * std::sqrt(days), 1e-9);
+        const HistogramSketch identity(std::expm1(center - halfWidth), std::expm1(center + halfWidth), SKETCH_BINS);
+
+        const std::vector<int> allowed = AllowedCpus();
+        const std::vector<std::vector<int>> nodes = NumaNodeCpus(allowed);
+
+        std::size_t numProcesses = (config.m_numProcesses > 0) ? config.m_numProcesses : nodes.size();
+        numProcesses = std::min(numProcesses, numShards);
+
+        const std::size_t slotSize = RoundUp(sizeof(WorkerSlot) + identity.GetSerialisedSize(), SLOT_ALIGNMENT);
+        const auto slotAt = [&](char* shared, std::size_t worker) -> WorkerSlot& {
+            return *reinterpret_cast<WorkerSlot*>(shared + worker * slotSize);
+        };
+
+        bool failed = false;
+#if defined(__linux__)
+        const std::vector<std::vector<int>> workerCpus = AssignCpus(numProcesses, nodes, allowed);
+
+        // mapped before forking, so every worker writes its slot into the same physical pages
+        void* mapping = mmap(nullptr, slotSize * numProcesses, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if(mapping == MAP_FAILED)
+            throw std::runtime_error("Could not map shared memory for simulation workers");
+        char* shared = static_cast<char*>(mapping);
+        std::memset(shared, 0, slotSize * numProcesses);
+
+        std::vector<pid_t> workers;
+        for(std::size_t worker = 0; worker < numProcesses; ++worker)
+        {
+            const pid_t pid = fork();
+            if(pid < 0)
+            {
+                failed = true;
+                break;
+            }
+
+            if(pid == 0)
+            {
+                WorkerSlot& slot = slotAt(shared, worker);
+                try
+                {
+                    const std::vector<int>& cpus = workerCpus[worker];
+                    if(config.m_pinToNodes)
+                    {
+                        cpu_set_t cpuSet;
+                        CPU_ZERO(&cpuSet);
+                        for(int cpu : cpus)
+                        {
+                            CPU_SET(cpu, &cpuSet);
+                        }
+                        sched_setaffinity(0, sizeof(cpu_set_t), &cpuSet);
+                    }
+
+                    ThreadPoolConfig poolConfig;
+                    poolConfig.m_numThreads = cpus.size();
+                    poolConfig.m_pinThreads = config.m_pinToNodes;
+                    poolConfig.m_cpus = cpus;
+                    ThreadPool::ReinitialiseAfterFork(poolConfig);
+
+                    SimulateShards(config, generate, workerOptions, worker * numShards / numProcesses, (worker + 1) * numShards / numProcesses, identity, center, slot);
+                }
+                catch(...)
+                {
+                    slot.m_status = -1;
+                }
+
+                // skip the parent's static destructors and atexit handlers, which belong to the coordinator
+                _exit(slot.m_status == 1 ? 0 : 1);
+            }
+
+            workers.push_back(pid);
+        }
+
+        for(pid_t pid : workers)
+        {
+            int status = 0;
+            const bool exited = waitpid(pid, &status, 0) == pid;
+            failed |= !exited || !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+        }
+#else
+        numProcesses = 1;
+        std::vector<char> buffer(slotSize, 0);
+        char* shared = buffer.data();
+        SimulateShards(config, generate, workerOptions, 0, numShards, identity, center, slotAt(shared, 0));
+#endif
+
+        ProcessRunResult result;
+        result.m_numProcesses = numProcesses;
+
+        HistogramSketch merged = identity;
+        HistogramSketch workerSketch = identity;
+        double sum = 0.0;
+        double sumSquares = 0.0;
+        for(std::size_t worker = 0; worker < numProcesses && !failed; ++worker)
+        {
+            const WorkerSlot& slot = slotAt(shared, worker);
+            failed |= slot.m_status != 1;
+
+            workerSketch.Deserialise(reinterpret_cast<const char*>(&slot) + sizeof(WorkerSlot));
+            merged.Merge(workerSketch);
+            result.m_numPaths += slot.m_numPaths;
+            sum += slot.m_sum;
+            sumSquares += slot.m_sumSquares;
+        }
+
+#if defined(__linux__)
+        munmap(mapping, slotSize * numProcesses);
+#endif
+        if(failed)
+            throw std::runtime_error("A simulation worker process failed");
+
+        const double n = static_cast<double>(result.m_numPaths);
+        const double tailProbability = 1.0 - confidence;
+        result.m_terminal = { config.m_numDays, merged.GetMean(), -merged.Quantile(tailProbability), -merged.TailMean(tailProbability) };
+        result.m_meanLogReturn = center + sum / n;
+        result.m_logReturnStdDev = std::sqrt(std::max(sumSquares - sum * sum / n, 0.0) / std::max(n - 1.0, 1.0));
+        return result;
+    }
+
+    template ProcessRunResult Run<float>(const ProcessRunConfig&, const ShardedSimulation::ShardGenerator<float>&, double, const SimulationOptions&);
+    template ProcessRunResult Run<double>(const ProcessRunConfig&, const ShardedSimulation::ShardGenerator<double>&, double, const SimulationOptions&);
+}
@@ -1,4 +1,5 @@
 #include "../include/PortfolioUtils.hpp"
+#include "../include/QuantileSelection.hpp"
 
 #include <vector>
 #include <numeric>
@@ -73,11 +74,7 @@ namespace PortfolioUtils
         if(dailyReturnSeries.empty())
             return 0.0;
         
-        std::vector<double> sorted = dailyReturnSeries;
-        std::sort(sorted.begin(), sorted.end());
-        
-        std::size_t index = static_cast<std::size_t>((1.0 - confidence) * sorted.size());
-        return -sorted[index];
+        return -QuantileSelection::Select(dailyReturnSeries, { 1.0 - confidence }).front().m_value;
     }
 
     double GetCVaR(const Portfolio& portfolio, double confidence)
@@ -86,15 +83,11 @@ namespace PortfolioUtils
         if(dailyReturnSeries.empty())
             return 0.0;
         
-        std::vector<double> sorted = dailyReturnSeries;
-        std::sort(sorted.begin(), sorted.end());
-        
-        std::size_t index = static_cast<std::size_t>((1.0 - confidence) * sorted.size());
-        double var_threshold = sorted[index];
+        double var_threshold = QuantileSelection::Select(dailyReturnSeries, { 1.0 - confidence }).front().m_value;
         
         double sum = 0.0;
         std::size_t count = 0;
-        for(double r : sorted) 
+        for(double r : dailyReturnSeries) 
         {
             if(r <= var_threshold) 
             {
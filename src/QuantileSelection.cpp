@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+
+#include "../include/QuantileSelection.hpp"
+#include "../include/ThreadPool.hpp"
+
+namespace
+{
+    // sign, 11 exponent bits and 4 mantissa bits: every octave is split into 16 buckets
+    constexpr unsigned BUCKET_BITS = 16;
+    constexpr std::size_t NUM_BUCKETS = std::size_t(1) << BUCKET_BITS;
+    // below this one nth_element beats two passes
+    constexpr std::size_t MIN_PARALLEL_COUNT = std::size_t(1) << 16;
+    // fixed chunking, so the per-bucket sums are added in the same order whatever the thread count
+    constexpr std::size_t NUM_CHUNKS = 16;
+
+    // negative values are bit-reversed below the positive ones, so unsigned order is numeric order
+    std::size_t BucketOf(double value)
+    {
+        const uint64_t bits = std::bit_cast<uint64_t>(value);
+        const uint64_t key = (bits >> 63) ? ~bits : bits | (uint64_t(1) << 63);
+        return static_cast<std::size_t>(key >> (64 - BUCKET_BITS));
+    }
+
+    std::size_t RankOf(double level, std::size_t count)
+    {
+        return std::min(static_cast<std::size_t>(level * static_cast<double>(count)), count - 1);
+    }
+
+    struct Histogram
+    {
+        std::vector<uint64_t> m_counts;
+        std::vector<double> m_sums;
+    };
+
+    // a rank within a buffer and the result slot it answers
+    using RankRequest = std::pair<std::size_t, std::size_t>;
+
+    // answers ascending ranks of buffer with successive nth_elements over what is left to the right of the
+    // previous one; baseCount and baseSum cover the values ranked below everything in the buffer
+    void SelectInBuffer(std::vector<double>& buffer, const std::vector<RankRequest>& ranks, std::size_t baseCount, double baseSum, std::vector<QuantileSelection::OrderStatistic>& out)
+    {
+        std::size_t lo = 0;
+        double sum = baseSum;
+        for(const auto& [rank, slot] : ranks)
+        {
+            if(rank >= lo)
+            {
+                std::nth_element(buffer.begin() + static_cast<std::ptrdiff_t>(lo), buffer.begin() + static_cast<std::ptrdiff_t>(rank), buffer.end());
+                sum = std::accumulate(buffer.begin() + static_cast<std::ptrdiff_t>(lo), buffer.begin() + static_cast<std::ptrdiff_t>(rank) + 1, sum);
+                lo = rank + 1;
+            }
+
+            out[slot].m_value = buffer[rank];
+            out[slot].m_tailMean = sum / static_cast<double>(baseCount + rank + 1);
+        }
+    }
+}
+
+namespace QuantileSelection
+{
+    std::vector<OrderStatistic> Select(const double* values, std::size_t count, const std::vector<double>& levels)
+    {
+        assert(count > 0);
+
+        std::vector<OrderStatistic> out(levels.size());
+        std::vector<RankRequest> ranks(levels.size());
+        for(std::size_t slot = 0; slot < levels.size(); ++slot)
+        {
+            assert(levels[slot] >= 0.0 && levels[slot] <= 1.0);
+            out[slot].m_level = levels[slot];
+            ranks[slot] = { RankOf(levels[slot], count), slot };
+        }
+        std::sort(ranks.begin(), ranks.end());
+
+        if(count < MIN_PARALLEL_COUNT)
+        {
+            std::vector<double> buffer(values, values + count);
+            SelectInBuffer(buffer, ranks, 0, 0.0, out);
+            return out;
+        }
+
+        const auto chunkBegin = [count](std::size_t chunk) {
+            return chunk * count / NUM_CHUNKS;
+        };
+
+        // pass 1: count and sum per bucket
+        const auto countChunk = [&](std::size_t firstChunk, std::size_t lastChunk) {
+            Histogram histogram{ std::vector<uint64_t>(NUM_BUCKETS, 0), std::vector<double>(NUM_BUCKETS, 0.0) };
+            for(std::size_t i = chunkBegin(firstChunk); i < chunkBegin(lastChunk); ++i)
+            {
+                const std::size_t bucket = BucketOf(values[i]);
+                ++histogram.m_counts[bucket];
+                histogram.m_sums[bucket] += values[i];
+            }
+            return histogram;
+        };
+        const auto mergeHistograms = [](Histogram lhs, Histogram rhs) {
+            if(lhs.m_counts.empty())
+                return rhs;
+
+            for(std::size_t bucket = 0; bucket < NUM_BUCKETS; ++bucket)
+            {
+                lhs.m_counts[bucket] += rhs.m_counts[bucket];
+                lhs.m_sums[bucket] += rhs.m_sums[bucket];
+            }
+            return lhs;
+        };
+        const Histogram histogram = ThreadPool::Instance().ParallelReduce(std::size_t(0), NUM_CHUNKS, Histogram{}, countChunk, mergeHistograms, 1);
+
+        // walk the buckets once, assigning every rank to the bucket that holds it
+        struct Target
+        {
+            std::size_t m_bucket;
+            std::size_t m_baseCount;
+            double m_baseSum;
+            std::vector<RankRequest> m_ranks;
+        };
+        std::vector<Target> targets;
+        std::vector<int32_t> bucketTarget(NUM_BUCKETS, -1);
+        {
+            std::size_t below = 0;
+            double belowSum = 0.0;
+            std::size_t next = 0;
+            for(std::size_t bucket = 0; bucket < NUM_BUCKETS && next < ranks.size(); ++bucket)
+            {
+                const std::size_t bucketCount = static_cast<std::size_t>(histogram.m_counts[bucket]);
+                while(next < ranks.size() && ranks[next].first < below + bucketCount)
+                {
+                    if(bucketTarget[bucket] < 0)
+                    {
+                        bucketTarget[bucket] = static_cast<int32_t>(targets.size());
+                        targets.push_back({ bucket, below, belowSum, {} });
+                    }
+                    targets.back().m_ranks.push_back({ ranks[next].first - below, ranks[next].second });
+                    ++next;
+                }
+                below += bucketCount;
+                belowSum += histogram.m_sums[bucket];
+            }
+        }
+
+        // pass 2: gather the target buckets, in chunk order so the buffers (and nth_element on them) are reproducible
+        using Gathered = std::vector<std::vector<double>>;
+        const auto gatherChunk = [&](std::size_t firstChunk, std::size_t lastChunk) {
+            Gathered gathered(targets.size());
+            for(std::size_t i = chunkBegin(firstChunk); i < chunkBegin(lastChunk); ++i)
+            {
+                const int32_t target = bucketTarget[BucketOf(values[i])];
+                if(target >= 0)
+                {
+                    gathered[static_cast<std::size_t>(target)].push_back(values[i]);
+                }
+            }
+            return gathered;
+        };
+        const auto concatenate = [](Gathered lhs, Gathered rhs) {
+            if(lhs.empty())
+                return rhs;
+
+            for(std::size_t target = 0; target < lhs.size(); ++target)
+            {
+                lhs[target].insert(lhs[target].end(), rhs[target].begin(), rhs[target].end());
+            }
+            return lhs;
+        };
+        Gathered gathered = ThreadPool::Instance().ParallelReduce(std::size_t(0), NUM_CHUNKS, Gathered{}, gatherChunk, concatenate, 1);
+
+        for(std::size_t target = 0; target < targets.size(); ++target)
+        {
+            SelectInBuffer(gathered[target], targets[target].m_ranks, targets[target].m_baseCount, targets[target].m_baseSum, out);
+        }
+
+        return out;
+    }
+}
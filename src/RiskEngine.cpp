@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+#include "../include/RiskEngine.hpp"
+#include "../include/MathUtils.hpp"
+#include "../include/QuantileSelection.hpp"
+
+namespace
+{
+    // Simpson intervals and the point below (or above) which the normal density is negligible
+    constexpr std::size_t INTEGRATION_STEPS = 2000;
+    constexpr double INTEGRATION_LIMIT = 12.0;
+
+    double CornishFisherQuantile(double z, double skewness, double excessKurtosis)
+    {
+        return z
+            + (z * z - 1.0) * skewness / 6.0
+            + (z * z * z - 3.0 * z) * excessKurtosis / 24.0
+            - (2.0 * z * z * z - 5.0 * z) * skewness * skewness / 36.0;
+    }
+
+    // integral of exp(mean + stdDev * cf(z)) * phi(z) over [lower, upper]
+    double ExpectedGrowth(double mean, double stdDev, double skewness, double excessKurtosis, double lower, double upper)
+    {
+        const double h = (upper - lower) / static_cast<double>(INTEGRATION_STEPS);
+        const auto integrand = [&](double z) {
+            return std::exp(mean + stdDev * CornishFisherQuantile(z, skewness, excessKurtosis)) * MathUtils::NormalPdf(z);
+        };
+
+        double sum = integrand(lower) + integrand(upper);
+        for(std::size_t i = 1; i < INTEGRATION_STEPS; ++i)
+        {
+            sum += ((i % 2 == 1) ? 4.0 : 2.0) * integrand(lower + static_cast<double>(i) * h);
+        }
+
+        return sum * h / 3.0;
+    }
+
+    // the first feature of the query the closed form cannot represent
+    std::string SimulationReason(const RiskEngine::Query& query)
+    {
+        if(query.m_wealthPlan)
+            return "rebalancing and cash flows";
+        if(query.m_simulation.m_shocks == ShockDistribution::StudentT)
+            return "Student t shocks";
+        if(query.m_simulation.m_jumpIntensity > 0.0)
+            return "jumps";
+        if(query.m_simulation.m_trackPathMetrics)
+            return "path metrics";
+        if(query.m_forceSimulation)
+            return "simulation requested";
+
+        return {};
+    }
+
+    // terminal wealth as returns on the capital put in, so the figures read like those of the other engines
+    HorizonRisk WealthRisk(const WealthReport& report, const WealthPlan& plan, std::size_t numDays, double confidence)
+    {
+        double contributed = plan.m_initialWealth;
+        for(const CashFlow& flow : plan.m_cashFlows)
+        {
+            contributed += flow.m_amount;
+        }
+        assert(contributed > 0.0);
+
+        std::vector<double> outcomes(report.m_terminalWealth.size());
+        std::transform(report.m_terminalWealth.begin(), report.m_terminalWealth.end(), outcomes.begin(), [contributed](double wealth) {
+            return wealth / contributed - 1.0;
+        });
+
+        const QuantileSelection::OrderStatistic tail = QuantileSelection::Select(outcomes, { 1.0 - confidence }).front();
+        return { numDays, report.m_meanTerminalWealth / contributed - 1.0, -tail.m_value, -tail.m_tailMean };
+    }
+}
+
+namespace RiskEngine
+{
+    ReturnShape ComputeReturnShape(const std::vector<double>& returns)
+    {
+        assert(returns.size() > 3);
+
+        const double n = static_cast<double>(returns.size());
+        const double mean = std::accumulate(returns.begin(), returns.end(), 0.0) / n;
+
+        double m2 = 0.0;
+        double m3 = 0.0;
+        double m4 = 0.0;
+        for(double r : returns)
+        {
+            const double d = r - mean;
+            m2 += d * d;
+            m3 += d * d * d;
+            m4 += d * d * d * d;
+        }
+        m2 /= n;
+        m3 /= n;
+        m4 /= n;
+
+        if(m2 <= 0.0)
+            return { 0.0, 0.0 };
+
+        return { m3 / std::pow(m2, 1.5), m4 / (m2 * m2) - 3.0 };
+    }
+
+    HorizonRisk GaussianRisk(double stepDrift, double stepStdDev, std::size_t days, double confidence)
+    {
+        const double tailProbability = 1.0 - confidence;
+        const double mean = stepDrift * static_cast<double>(days);
+        const double stdDev = stepStdDev * std::sqrt(static_cast<double>(days));
+        const double z = MathUtils::NormalQuantile(tailProbability);
+
+        // E[exp(X); X <= mean + stdDev * z] = exp(mean + stdDev^2 / 2) * Phi(z - stdDev)
+        const double growth = std::exp(mean + 0.5 * stdDev * stdDev);
+        const double tailGrowth = growth * MathUtils::NormalCdf(z - stdDev) / tailProbability;
+
+        return { days, growth - 1.0, -std::expm1(mean + stdDev * z), 1.0 - tailGrowth };
+    }
+
+    HorizonRisk CornishFisherRisk(double stepDrift, double stepStdDev, const ReturnShape& stepShape, std::size_t days, double confidence)
+    {
+        const double tailProbability = 1.0 - confidence;
+        const double numDays = static_cast<double>(days);
+        const double mean = stepDrift * numDays;
+        const double stdDev = stepStdDev * std::sqrt(numDays);
+        const double skewness = stepShape.m_skewness / std::sqrt(numDays);
+        const double excessKurtosis = stepShape.m_excessKurtosis / numDays;
+        const double z = MathUtils::NormalQuantile(tailProbability);
+
+        const double growth = ExpectedGrowth(mean, stdDev, skewness, excessKurtosis, -INTEGRATION_LIMIT, INTEGRATION_LIMIT);
+        const double tailGrowth = ExpectedGrowth(mean, stdDev, skewness, excessKurtosis, -INTEGRATION_LIMIT, z) / tailProbability;
+
+        return { days, growth - 1.0, -std::expm1(mean + stdDev * CornishFisherQuantile(z, skewness, excessKurtosis)), 1.0 - tailGrowth };
+    }
+
+    template <typename Real>
+    Evaluation Evaluate(
+        const BasicMonteCarloEngine<Real>& engine,
+        const Eigen::MatrixXd& choleskyMatrix,
+        const std::vector<std::pair<double, double>>& assetStatistics,
+        const std::vector<double>& weights,
+        const Query& query)
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        const std::size_t numDays = query.m_numDays;
+        const std::vector<std::size_t> horizons = query.m_simulation.m_checkpointDays.empty() ? std::vector<std::size_t>{ numDays } : query.m_simulation.m_checkpointDays;
+        const std::pair<double, double> stepMoments = engine.ComputePortfolioStepMoments(choleskyMatrix, assetStatistics, weights, query.m_ignoreDrift, numDays);
+
+        Evaluation evaluation{};
+        evaluation.m_reason = SimulationReason(query);
+
+        if(evaluation.m_reason.empty())
+        {
+            evaluation.m_method = Method::ClosedForm;
+            for(std::size_t days : horizons)
+            {
+                evaluation.m_horizons.push_back(GaussianRisk(stepMoments.first, stepMoments.second, days, query.m_confidence));
+            }
+        }
+        else if(query.m_wealthPlan)
+        {
+            evaluation.m_method = Method::WealthSimulation;
+            evaluation.m_wealth = engine.SimulateWealth(choleskyMatrix, assetStatistics, *query.m_wealthPlan, query.m_ignoreDrift, query.m_numPaths, numDays, query.m_confidence);
+            evaluation.m_horizons.push_back(WealthRisk(*evaluation.m_wealth, *query.m_wealthPlan, numDays, query.m_confidence));
+            evaluation.m_numPaths = query.m_numPaths;
+        }
+        else
+        {
+            // only the horizons (and path metrics) are read, so the paths themselves are never stored
+            SimulationOptions options = query.m_simulation;
+            options.m_storePaths = false;
+            options.m_checkpointDays = horizons;
+
+            const BasicReturns<Real> returns = engine.GenerateReturnsForMultiAsset(choleskyMatrix, assetStatistics, weights, query.m_ignoreDrift, query.m_numPaths, numDays, options);
+
+            evaluation.m_method = Method::MonteCarlo;
+            evaluation.m_horizons = engine.EvaluateHorizons(returns, query.m_confidence);
+            if(options.m_trackPathMetrics)
+            {
+                evaluation.m_pathRisk = engine.EvaluatePathMetrics(returns, query.m_confidence);
+            }
+            evaluation.m_numPaths = query.m_numPaths;
+        }
+
+        if(!query.m_historicalReturns.empty())
+        {
+            const ReturnShape shape = ComputeReturnShape(query.m_historicalReturns);
+            for(std::size_t days : horizons)
+            {
+                evaluation.m_cornishFisher.push_back(CornishFisherRisk(stepMoments.first, stepMoments.second, shape, days, query.m_confidence));
+            }
+        }
+
+        evaluation.m_elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return evaluation;
+    }
+
+    template Evaluation Evaluate<float>(const BasicMonteCarloEngine<float>&, const Eigen::MatrixXd&, const std::vector<std::pair<double, double>>&, const std::vector<double>&, const Query&);
+    template Evaluation Evaluate<double>(const BasicMonteCarloEngine<double>&, const Eigen::MatrixXd&, const std::vector<std::pair<double, double>>&, const std::vector<double>&, const Query&);
+}
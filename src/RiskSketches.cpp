@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <numeric>
+
+#include "../include/RiskSketches.hpp"
+
+HistogramSketch::HistogramSketch(double lower, double upper, std::size_t numBins)
+    : m_lower(lower),
+      m_upper(upper),
+      m_binWidth((upper - lower) / static_cast<double>(numBins)),
+      m_invBinWidth(static_cast<double>(numBins) / (upper - lower)),
+      m_masses(numBins + 2, 0.0),
+      m_sums(numBins + 2, 0.0)
+{
+    assert(upper > lower && numBins > 0);
+}
+
+void HistogramSketch::Merge(const HistogramSketch& other)
+{
+    assert(other.m_masses.size() == m_masses.size() && other.m_lower == m_lower && other.m_upper == m_upper);
+
+    for(std::size_t bin = 0; bin < m_masses.size(); ++bin)
+    {
+        m_masses[bin] += other.m_masses[bin];
+        m_sums[bin] += other.m_sums[bin];
+    }
+    m_total += other.m_total;
+}
+
+std::size_t HistogramSketch::GetSerialisedSize() const
+{
+    return 2 * m_masses.size() * sizeof(double) + sizeof(uint64_t);
+}
+
+void HistogramSketch::Serialise(void* out) const
+{
+    char* bytes = static_cast<char*>(out);
+    const std::size_t binBytes = m_masses.size() * sizeof(double);
+    std::memcpy(bytes, m_masses.data(), binBytes);
+    std::memcpy(bytes + binBytes, m_sums.data(), binBytes);
+    std::memcpy(bytes + 2 * binBytes, &m_total, sizeof(uint64_t));
+}
+
+void HistogramSketch::Deserialise(const void* in)
+{
+    const char* bytes = static_cast<const char*>(in);
+    const std::size_t binBytes = m_masses.size() * sizeof(double);
+    std::memcpy(m_masses.data(), bytes, binBytes);
+    std::memcpy(m_sums.data(), bytes + binBytes, binBytes);
+    std::memcpy(&m_total, bytes + 2 * binBytes, sizeof(uint64_t));
+}
+
+uint64_t HistogramSketch::GetCount() const
+{
+    return m_total;
+}
+
+double HistogramSketch::GetMean() const
+{
+    assert(m_total > 0);
+    return std::accumulate(m_sums.begin(), m_sums.end(), 0.0) / static_cast<double>(m_total);
+}
+
+double HistogramSketch::Quantile(double p) const
+{
+    assert(m_total > 0);
+
+    const double target = p * static_cast<double>(m_total);
+    const std::size_t numBins = m_masses.size() - 2;
+
+    double below = 0.0;
+    for(std::size_t bin = 0; bin < m_masses.size(); ++bin)
+    {
+        const double count = m_masses[bin];
+        if(count > 0.0 && below + count >= target)
+        {
+            // the open-ended bins have no width to interpolate over, their mean is the best point estimate
+            if(bin == 0 || bin == numBins + 1)
+                return m_sums[bin] / count;
+
+            const double binLower = m_lower + static_cast<double>(bin - 1) * m_binWidth;
+            return binLower + m_binWidth * std::clamp((target - below) / count, 0.0, 1.0);
+        }
+        below += count;
+    }
+
+    return m_upper;
+}
+
+double HistogramSketch::TailMean(double p) const
+{
+    assert(m_total > 0);
+
+    const double target = std::max(p * static_cast<double>(m_total), 1.0);
+
+    double below = 0.0;
+    double sum = 0.0;
+    for(std::size_t bin = 0; bin < m_masses.size(); ++bin)
+    {
+        const double count = m_masses[bin];
+        if(count == 0.0)
+            continue;
+
+        if(below + count >= target)
+        {
+            // only part of this bin is in the tail, take that share of its mass at the bin's mean
+            const double share = target - below;
+            sum += share * (m_sums[bin] / count);
+            return sum / target;
+        }
+
+        below += count;
+        sum += m_sums[bin];
+    }
+
+    return sum / below;
+}
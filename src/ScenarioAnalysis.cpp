@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "../include/ScenarioAnalysis.hpp"
+#include "../include/RandomGenerator.hpp"
+#include "../include/ThreadPool.hpp"
+
+namespace
+{
+    constexpr double TRADING_DAYS = 252.0;
+    // rows or columns of the P&L matrix one task multiplies out
+    constexpr std::size_t PNL_BLOCK = 256;
+    // relative to the largest eigenvalue of a covariance
+    constexpr double EIGENVALUE_TOLERANCE = 1e-12;
+
+    void AppendScenario(ScenarioAnalysis::ScenarioSet& scenarios, const std::string& name, const Eigen::VectorXd& assetReturns)
+    {
+        if(scenarios.GetNumScenarios() == 0)
+        {
+            scenarios.m_numAssets = static_cast<std::size_t>(assetReturns.size());
+        }
+        assert(static_cast<std::size_t>(assetReturns.size()) == scenarios.m_numAssets);
+
+        scenarios.m_names.push_back(name);
+        scenarios.m_assetReturns.insert(scenarios.m_assetReturns.end(), assetReturns.data(), assetReturns.data() + assetReturns.size());
+    }
+
+    Eigen::MatrixXd ToEigen(const std::vector<std::vector<double>>& matrix)
+    {
+        const std::size_t n = matrix.size();
+        Eigen::MatrixXd out(n, n);
+        for(std::size_t i = 0; i < n; ++i)
+        {
+            assert(matrix[i].size() == n);
+            for(std::size_t j = 0; j < n; ++j)
+            {
+                out(i, j) = matrix[i][j];
+            }
+        }
+        return out;
+    }
+}
+
+namespace ScenarioAnalysis
+{
+    void AddShock(ScenarioSet& scenarios, const std::string& name, const std::vector<double>& assetReturns)
+    {
+        AppendScenario(scenarios, name, Eigen::Map<const Eigen::VectorXd>(assetReturns.data(), static_cast<Eigen::Index>(assetReturns.size())));
+    }
+
+    bool AddHistoricalWindow(
+        ScenarioSet& scenarios,
+        const std::string& name,
+        const std::vector<std::vector<double>>& logReturnsMat,
+        const std::vector<std::string>& dates,
+        const std::string& firstDate,
+        const std::string& lastDate)
+    {
+        assert(dates.size() == logReturnsMat.size());
+        if(logReturnsMat.empty())
+            return false;
+
+        const std::size_t numAssets = logReturnsMat[0].size();
+        Eigen::VectorXd cumulative = Eigen::VectorXd::Zero(static_cast<Eigen::Index>(numAssets));
+        std::size_t numDays = 0;
+
+        for(std::size_t row = 0; row < logReturnsMat.size(); ++row)
+        {
+            if(dates[row].compare(0, firstDate.size(), firstDate) < 0 || dates[row].compare(0, lastDate.size(), lastDate) > 0)
+                continue;
+
+            // a day some asset has no return for (GetLogReturnsMat marks non-positive prices NaN) is dropped whole
+            const std::vector<double>& day = logReturnsMat[row];
+            if(!std::all_of(day.begin(), day.end(), [](double value) { return std::isfinite(value); }))
+                continue;
+
+            for(std::size_t asset = 0; asset < numAssets; ++asset)
+            {
+                cumulative(static_cast<Eigen::Index>(asset)) += day[asset];
+            }
+            ++numDays;
+        }
+
+        if(numDays == 0)
+            return false;
+
+        AppendScenario(scenarios, name, cumulative.array().expm1().matrix());
+        return true;
+    }
+
+    void AddFactorShock(ScenarioSet& scenarios, const std::string& name, const FactorLoadings& model, const Eigen::VectorXd& factorMoves, std::size_t horizonDays)
+    {
+        assert(static_cast<std::size_t>(factorMoves.size()) == model.GetNumFactors());
+
+        const double horizonScale = std::sqrt(static_cast<double>(horizonDays) / TRADING_DAYS);
+        AppendScenario(scenarios, name, (horizonScale * (model.m_loadings * factorMoves)).array().expm1().matrix());
+    }
+
+    std::vector<std::vector<double>> StressCovariance(const std::vector<std::vector<double>>& covMatrix, const std::vector<double>& volMultipliers, double correlationBlend)
+    {
+        const std::size_t n = covMatrix.size();
+        assert(volMultipliers.size() == n);
+        assert(correlationBlend >= 0.0 && correlationBlend <= 1.0);
+
+        std::vector<double> vols(n);
+        for(std::size_t i = 0; i < n; ++i)
+        {
+            vols[i] = std::sqrt(covMatrix[i][i]);
+        }
+
+        std::vector<std::vector<double>> stressed(n, std::vector<double>(n, 0.0));
+        for(std::size_t i = 0; i < n; ++i)
+        {
+            for(std::size_t j = 0; j < n; ++j)
+            {
+                const double correlation = (i == j || vols[i] == 0.0 || vols[j] == 0.0) ? 1.0 : covMatrix[i][j] / (vols[i] * vols[j]);
+                const double blended = (1.0 - correlationBlend) * correlation + correlationBlend;
+                stressed[i][j] = blended * volMultipliers[i] * vols[i] * volMultipliers[j] * vols[j];
+            }
+        }
+
+        return stressed;
+    }
+
+    void AddSampledScenarios(ScenarioSet& scenarios, const std::string& name, const std::vector<std::vector<double>>& covMatrix, std::size_t numScenarios, std::size_t horizonDays, uint64_t seed)
+    {
+        // a square root through the eigendecomposition, since a full blend to one leaves the covariance singular;
+        // eigenvalues at rounding level are the zeros they stand for, not directions to draw along
+        const Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(ToEigen(covMatrix));
+        const double floor = EIGENVALUE_TOLERANCE * std::max(solver.eigenvalues().maxCoeff(), 0.0);
+        const Eigen::VectorXd roots = solver.eigenvalues().unaryExpr([floor](double value) {
+            return value > floor ? std::sqrt(value) : 0.0;
+        });
+        const Eigen::MatrixXd factor = solver.eigenvectors() * roots.asDiagonal();
+
+        const double horizonScale = std::sqrt(static_cast<double>(horizonDays) / TRADING_DAYS);
+        const Eigen::MatrixXd moves = (horizonScale * (factor * GenNormalPCG::FromSeed(seed).GenerateRandomMatrix(covMatrix.size(), numScenarios))).array().expm1().matrix();
+
+        scenarios.m_names.reserve(scenarios.m_names.size() + numScenarios);
+        scenarios.m_assetReturns.reserve(scenarios.m_assetReturns.size() + static_cast<std::size_t>(moves.size()));
+        for(std::size_t s = 0; s < numScenarios; ++s)
+        {
+            AppendScenario(scenarios, name + "/" + std::to_string(s), moves.col(static_cast<Eigen::Index>(s)));
+        }
+    }
+
+    Eigen::MatrixXd EvaluatePnL(const ScenarioSet& scenarios, const Eigen::MatrixXd& holdings)
+    {
+        assert(static_cast<std::size_t>(holdings.rows()) == scenarios.m_numAssets);
+
+        const Eigen::Map<const Eigen::MatrixXd> scenarioMatrix = scenarios.Matrix();
+        const std::size_t numScenarios = scenarios.GetNumScenarios();
+        const std::size_t numPortfolios = static_cast<std::size_t>(holdings.cols());
+        Eigen::MatrixXd pnl(numScenarios, numPortfolios);
+
+        // one product, split along its longer side so a single portfolio against many scenarios still spreads out
+        const bool byPortfolio = numPortfolios >= numScenarios;
+        const std::size_t length = byPortfolio ? numPortfolios : numScenarios;
+        const std::size_t numBlocks = (length + PNL_BLOCK - 1) / PNL_BLOCK;
+
+        ThreadPool::Instance().ParallelFor(0, numBlocks, [&](std::size_t startBlock, std::size_t endBlock) {
+            const Eigen::Index first = static_cast<Eigen::Index>(startBlock * PNL_BLOCK);
+            const Eigen::Index count = static_cast<Eigen::Index>(std::min(length, endBlock * PNL_BLOCK)) - first;
+            if(byPortfolio)
+            {
+                pnl.middleCols(first, count).noalias() = scenarioMatrix.transpose() * holdings.middleCols(first, count);
+            }
+            else
+            {
+                pnl.middleRows(first, count).noalias() = scenarioMatrix.middleCols(first, count).transpose() * holdings;
+            }
+        }, 1);
+
+        return pnl;
+    }
+
+    std::vector<WorstCase> FindWorstCases(const Eigen::MatrixXd& pnl)
+    {
+        assert(pnl.rows() > 0);
+
+        std::vector<WorstCase> worst(static_cast<std::size_t>(pnl.cols()));
+        for(Eigen::Index portfolio = 0; portfolio < pnl.cols(); ++portfolio)
+        {
+            Eigen::Index scenario = 0;
+            const double value = pnl.col(portfolio).minCoeff(&scenario);
+            worst[static_cast<std::size_t>(portfolio)] = { static_cast<std::size_t>(scenario), value };
+        }
+
+        return worst;
+    }
+}
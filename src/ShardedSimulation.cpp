@@ -0,0 +1,402 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../include/ShardedSimulation.hpp"
+#include "../include/RiskSketches.hpp"
+#include "../include/ThreadPool.hpp"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    const std::string MANIFEST_NAME = "manifest.txt";
+    constexpr int MANIFEST_VERSION = 1;
+
+    // terminal-return sketch: resolution, range in standard deviations of the terminal log-return, and the
+    // number of partial reductions per shard (fixed, so the result does not depend on the thread count)
+    constexpr std::size_t SKETCH_BINS = 4096;
+    constexpr double SKETCH_RANGE_STDDEVS = 8.0;
+    constexpr std::size_t NUM_REDUCTION_BLOCKS = 32;
+
+    /*
+    One shard file mapped into memory. A created file is sized up front and mapped shared, so the engine's
+    workers write straight into the page cache and Sync() pushes it to disk. Off Linux the file goes through
+    an ordinary buffer instead.
+    */
+    class ShardFile
+    {
+    private:
+        std::string m_path;
+        std::size_t m_bytes;
+        void* m_data = nullptr;
+#if defined(__linux__)
+        int m_fd = -1;
+#else
+        std::vector<char> m_buffer;
+#endif
+
+    public:
+        ShardFile(const std::string& path, std::size_t bytes, bool create)
+            : m_path(path), m_bytes(bytes)
+        {
+#if defined(__linux__)
+            m_fd = create ? open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) : open(path.c_str(), O_RDONLY);
+            if(m_fd < 0)
+                throw std::runtime_error("Could not open shard: " + path);
+
+            struct stat info;
+            const bool sized = create ? (ftruncate(m_fd, static_cast<off_t>(bytes)) == 0) : (fstat(m_fd, &info) == 0 && static_cast<std::size_t>(info.st_size) == bytes);
+            if(!sized)
+            {
+                close(m_fd);
+                throw std::runtime_error("Shard has the wrong size: " + path);
+            }
+
+            m_data = mmap(nullptr, bytes, create ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, m_fd, 0);
+            if(m_data == MAP_FAILED)
+            {
+                close(m_fd);
+                throw std::runtime_error("Could not map shard: " + path);
+            }
+
+            // readers stream each shard front to back once
+            if(!create)
+            {
+                madvise(m_data, bytes, MADV_SEQUENTIAL);
+            }
+#else
+            m_buffer.resize(bytes);
+            if(!create)
+            {
+                std::ifstream file(path, std::ios::binary);
+                if(!file.read(m_buffer.data(), static_cast<std::streamsize>(bytes)))
+                    throw std::runtime_error("Could not read shard: " + path);
+            }
+            m_data = m_buffer.data();
+#endif
+        }
+
+        ShardFile(const ShardFile&) = delete;
+        ShardFile& operator=(const ShardFile&) = delete;
+
+        ~ShardFile()
+        {
+#if defined(__linux__)
+            munmap(m_data, m_bytes);
+            close(m_fd);
+#endif
+        }
+
+        void* Data()
+        {
+            return m_data;
+        }
+
+        void Sync()
+        {
+#if defined(__linux__)
+            if(msync(m_data, m_bytes, MS_SYNC) != 0 || fsync(m_fd) != 0)
+                throw std::runtime_error("Could not sync shard: " + m_path);
+#else
+            std::ofstream file(m_path, std::ios::binary | std::ios::trunc);
+            if(!file.write(m_buffer.data(), static_cast<std::streamsize>(m_bytes)) || !file.flush())
+                throw std::runtime_error("Could not write shard: " + m_path);
+#endif
+        }
+    };
+
+    // pushes a closed file, or a directory's entries, to disk; a rename only survives a crash once the directory
+    // holding it is synced. Off Linux this is left to the OS
+    void SyncPath(const fs::path& path)
+    {
+#if defined(__linux__)
+        const int fd = open(path.c_str(), O_RDONLY);
+        const bool synced = fd >= 0 && fsync(fd) == 0;
+        if(fd >= 0)
+        {
+            close(fd);
+        }
+        if(!synced)
+            throw std::runtime_error("Could not sync: " + path.string());
+#else
+        (void)path;
+#endif
+    }
+
+    // written beside the old manifest, synced and renamed over it, so a crash leaves either the old list or the new
+    // one; syncing the directory afterwards also makes the rename of the shard it adds durable
+    void SaveManifest(const std::string& directory, const ShardManifest& manifest)
+    {
+        const fs::path target = fs::path(directory) / MANIFEST_NAME;
+        const fs::path partial = fs::path(directory) / (MANIFEST_NAME + ".partial");
+
+        {
+            std::ofstream file(partial, std::ios::trunc);
+            if(!file)
+                throw std::runtime_error("Could not write manifest: " + partial.string());
+
+            file << std::setprecision(17);
+            file << "version " << MANIFEST_VERSION << '\n';
+            file << "num_paths " << manifest.m_numPaths << '\n';
+            file << "num_days " << manifest.m_numDays << '\n';
+            file << "paths_per_shard " << manifest.m_pathsPerShard << '\n';
+            file << "seed " << manifest.m_seed << '\n';
+            file << "value_size " << manifest.m_valueSize << '\n';
+            file << "output " << (manifest.m_output == SimulationOutput::PricePaths ? "prices" : "log_returns") << '\n';
+            file << "initial_price " << manifest.m_initialPrice << '\n';
+            for(const ShardInfo& shard : manifest.m_completed)
+            {
+                file << "shard " << shard.m_index << ' ' << shard.m_firstPath << ' ' << shard.m_numPaths << ' ' << shard.m_stepDrift << ' ' << shard.m_stepStdDev << '\n';
+            }
+
+            if(!file.flush())
+                throw std::runtime_error("Could not write manifest: " + partial.string());
+        }
+
+        SyncPath(partial);
+        fs::rename(partial, target);
+        SyncPath(directory);
+    }
+
+    bool MatchesConfig(const ShardManifest& manifest, const ShardedRunConfig& config, std::size_t valueSize, const SimulationOptions& options)
+    {
+        const double initialPrice = (options.m_output == SimulationOutput::PricePaths) ? options.m_initialPrice : 1.0;
+        return manifest.m_numPaths == config.m_numPaths && manifest.m_numDays == config.m_numDays && manifest.m_pathsPerShard == config.m_pathsPerShard
+            && manifest.m_seed == config.m_seed && manifest.m_valueSize == valueSize && manifest.m_output == options.m_output && manifest.m_initialPrice == initialPrice;
+    }
+
+    std::size_t ShardBytes(const ShardManifest& manifest, std::size_t numPaths)
+    {
+        return numPaths * manifest.m_numDays * manifest.m_valueSize;
+    }
+}
+
+namespace ShardedSimulation
+{
+    std::string ShardPath(const std::string& directory, std::size_t shard)
+    {
+        std::ostringstream name;
+        name << "shard_" << std::setw(6) << std::setfill('0') << shard << ".bin";
+        return (fs::path(directory) / name.str()).string();
+    }
+
+    bool LoadManifest(const std::string& directory, ShardManifest& manifest)
+    {
+        std::ifstream file(fs::path(directory) / MANIFEST_NAME);
+        if(!file)
+            return false;
+
+        manifest = ShardManifest();
+        std::string key;
+        while(file >> key)
+        {
+            if(key == "version")
+            {
+                int version = 0;
+                file >> version;
+                if(version != MANIFEST_VERSION)
+                    throw std::runtime_error("Unsupported shard manifest version in " + directory);
+            }
+            else if(key == "num_paths")
+                file >> manifest.m_numPaths;
+            else if(key == "num_days")
+                file >> manifest.m_numDays;
+            else if(key == "paths_per_shard")
+                file >> manifest.m_pathsPerShard;
+            else if(key == "seed")
+                file >> manifest.m_seed;
+            else if(key == "value_size")
+                file >> manifest.m_valueSize;
+            else if(key == "output")
+            {
+                std::string output;
+                file >> output;
+                manifest.m_output = (output == "prices") ? SimulationOutput::PricePaths : SimulationOutput::LogReturns;
+            }
+            else if(key == "initial_price")
+                file >> manifest.m_initialPrice;
+            else if(key == "shard")
+            {
+                ShardInfo shard;
+                file >> shard.m_index >> shard.m_firstPath >> shard.m_numPaths >> shard.m_stepDrift >> shard.m_stepStdDev;
+                manifest.m_completed.push_back(shard);
+            }
+            else
+                throw std::runtime_error("Unexpected key '" + key + "' in shard manifest of " + directory);
+
+            if(!file)
+                throw std::runtime_error("Malformed shard manifest in " + directory);
+        }
+
+        return true;
+    }
+
+    template <typename Real>
+    ShardManifest Run(const ShardedRunConfig& config, const ShardGenerator<Real>& generate, const SimulationOptions& options)
+    {
+        assert(config.m_numPaths > 0 && config.m_numDays > 0 && config.m_pathsPerShard > 0);
+        assert(options.m_storePaths);
+        assert(options.m_varianceReduction != VarianceReduction::TailImportanceSampling);
+
+        fs::create_directories(config.m_directory);
+
+        ShardManifest manifest;
+        if(LoadManifest(config.m_directory, manifest))
+        {
+            if(!MatchesConfig(manifest, config, sizeof(Real), options))
+                throw std::runtime_error("Shard manifest in " + config.m_directory + " was written for a different run");
+        }
+        else
+        {
+            manifest.m_numPaths = config.m_numPaths;
+            manifest.m_numDays = config.m_numDays;
+            manifest.m_pathsPerShard = config.m_pathsPerShard;
+            manifest.m_seed = config.m_seed;
+            manifest.m_valueSize = sizeof(Real);
+            manifest.m_output = options.m_output;
+            manifest.m_initialPrice = (options.m_output == SimulationOutput::PricePaths) ? options.m_initialPrice : 1.0;
+        }
+
+        // a listed shard whose file has since gone missing or been truncated is generated again
+        const std::size_t numShards = manifest.GetNumShards();
+        std::vector<char> done(numShards, 0);
+        std::erase_if(manifest.m_completed, [&](const ShardInfo& shard) {
+            std::error_code error;
+            const bool intact = shard.m_index < numShards && fs::file_size(ShardPath(config.m_directory, shard.m_index), error) == ShardBytes(manifest, shard.m_numPaths) && !error;
+            if(intact)
+            {
+                done[shard.m_index] = 1;
+            }
+            return !intact;
+        });
+
+        for(std::size_t shard = 0; shard < numShards; ++shard)
+        {
+            if(done[shard])
+                continue;
+
+            ShardInfo info;
+            info.m_index = shard;
+            info.m_firstPath = shard * config.m_pathsPerShard;
+            info.m_numPaths = std::min(config.m_pathsPerShard, config.m_numPaths - info.m_firstPath);
+
+            // the shard only takes its final name once it is complete on disk
+            const std::string path = ShardPath(config.m_directory, shard);
+            const std::string partial = path + ".partial";
+            {
+                ShardFile file(partial, ShardBytes(manifest, info.m_numPaths), true);
+
+                // the manifest's value size is sizeof(Real), so the mapping holds exactly the shard's paths in Real
+                const std::span<Real> shardPaths(static_cast<Real*>(file.Data()), info.m_numPaths * config.m_numDays);
+                const BasicMonteCarloEngine<Real> engine(config.m_seed, shard, shardPaths);
+                const BasicReturns<Real> returns = generate(engine, info.m_numPaths, options);
+                assert(returns.m_blockSize == config.m_numDays && returns.m_returns.empty());
+
+                info.m_stepDrift = returns.m_stepDrift;
+                info.m_stepStdDev = returns.m_stepStdDev;
+                file.Sync();
+            }
+            // the directory entry is synced along with the manifest's
+            fs::rename(partial, path);
+
+            manifest.m_completed.push_back(info);
+            SaveManifest(config.m_directory, manifest);
+        }
+
+        return manifest;
+    }
+
+    template <typename Real>
+    void ForEachShard(const std::string& directory, const ShardVisitor<Real>& visit)
+    {
+        ShardManifest manifest;
+        if(!LoadManifest(directory, manifest))
+            throw std::runtime_error("No shard manifest in " + directory);
+        if(manifest.m_valueSize != sizeof(Real))
+            throw std::runtime_error("Shards in " + directory + " were written at a different precision");
+
+        std::vector<ShardInfo> shards = manifest.m_completed;
+        std::sort(shards.begin(), shards.end(), [](const ShardInfo& lhs, const ShardInfo& rhs) { return lhs.m_index < rhs.m_index; });
+
+        for(const ShardInfo& shard : shards)
+        {
+            ShardFile file(ShardPath(directory, shard.m_index), ShardBytes(manifest, shard.m_numPaths), false);
+            visit(static_cast<const Real*>(file.Data()), shard);
+        }
+    }
+
+    template <typename Real>
+    HorizonRisk ReduceTerminalRisk(const std::string& directory, double confidence)
+    {
+        ShardManifest manifest;
+        if(!LoadManifest(directory, manifest) || manifest.m_completed.empty())
+            throw std::runtime_error("No completed shards in " + directory);
+
+        // every shard comes from the same model, so the first one's moments size the sketch for all of them
+        const std::size_t numDays = manifest.m_numDays;
+        const ShardInfo& first = manifest.m_completed.front();
+        const double mean = first.m_stepDrift * static_cast<double>(numDays);
+        const double halfWidth = std::max(SKETCH_RANGE_STDDEVS * first.m_stepStdDev * std::sqrt(static_cast<double>(numDays)), 1e-9);
+        const HistogramSketch identity(std::expm1(mean - halfWidth), std::expm1(mean + halfWidth), SKETCH_BINS);
+
+        const bool prices = manifest.m_output == SimulationOutput::PricePaths;
+        const double initialPrice = manifest.m_initialPrice;
+
+        HistogramSketch total = identity;
+        ForEachShard<Real>(directory, [&](const Real* paths, const ShardInfo& shard) {
+            const auto sketchPaths = [&](std::size_t firstPath, std::size_t lastPath) {
+                HistogramSketch sketch = identity;
+                for(std::size_t path = firstPath; path < lastPath; ++path)
+                {
+                    const Real* pathPtr = paths + path * numDays;
+                    if(prices)
+                    {
+                        sketch.Add(static_cast<double>(pathPtr[numDays - 1]) / initialPrice - 1.0);
+                        continue;
+                    }
+
+                    double sum = 0.0;
+                    for(std::size_t dayIdx = 0; dayIdx < numDays; ++dayIdx)
+                    {
+                        sum += static_cast<double>(pathPtr[dayIdx]);
+                    }
+                    sketch.Add(std::expm1(sum));
+                }
+                return sketch;
+            };
+
+            const auto mergeSketches = [](HistogramSketch lhs, const HistogramSketch& rhs) {
+                lhs.Merge(rhs);
+                return lhs;
+            };
+
+            const std::size_t pathsPerBlock = (shard.m_numPaths + NUM_REDUCTION_BLOCKS - 1) / NUM_REDUCTION_BLOCKS;
+            total.Merge(ThreadPool::Instance().ParallelReduce(std::size_t(0), shard.m_numPaths, identity, sketchPaths, mergeSketches, pathsPerBlock));
+        });
+
+        const double tailProbability = 1.0 - confidence;
+        return { numDays, total.GetMean(), -total.Quantile(tailProbability), -total.TailMean(tailProbability) };
+    }
+
+    template ShardManifest Run<float>(const ShardedRunConfig&, const ShardGenerator<float>&, const SimulationOptions&);
+    template ShardManifest Run<double>(const ShardedRunConfig&, const ShardGenerator<double>&, const SimulationOptions&);
+    template void ForEachShard<float>(const std::string&, const ShardVisitor<float>&);
+    template void ForEachShard<double>(const std::string&, const ShardVisitor<double>&);
+    template HorizonRisk ReduceTerminalRisk<float>(const std::string&, double);
+    template HorizonRisk ReduceTerminalRisk<double>(const std::string&, double);
+}
@@ -0,0 +1,94 @@
+#include <atomic>
+#include <cstdlib>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "../include/SimulationBuffer.hpp"
+
+namespace
+{
+    std::atomic<HugePages> g_hugePagePolicy{HugePages::None};
+
+    // below this size a plain aligned allocation is cheaper than a fresh mapping
+    constexpr std::size_t MMAP_THRESHOLD = 1 << 21;
+    constexpr std::size_t HUGE_PAGE_SIZE = 1 << 21;
+    constexpr std::size_t CACHE_LINE = 64;
+
+    std::size_t RoundUp(std::size_t value, std::size_t multiple)
+    {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+}
+
+namespace SimulationMemory
+{
+    void SetHugePagePolicy(HugePages policy)
+    {
+        g_hugePagePolicy.store(policy);
+    }
+
+    HugePages GetHugePagePolicy()
+    {
+        return g_hugePagePolicy.load();
+    }
+
+    void* Allocate(std::size_t bytes)
+    {
+        if(bytes == 0)
+            return nullptr;
+
+#if defined(__linux__)
+        if(bytes >= MMAP_THRESHOLD)
+        {
+            const std::size_t length = RoundUp(bytes, HUGE_PAGE_SIZE);
+            const HugePages policy = g_hugePagePolicy.load();
+
+            void* ptr = MAP_FAILED;
+            // no MAP_NORESERVE here: the huge pages have to be reserved up front, so an exhausted pool fails
+            // the mmap and falls back below instead of raising SIGBUS on first touch
+            if(policy == HugePages::Explicit)
+            {
+                ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            }
+
+            if(ptr == MAP_FAILED)
+            {
+                ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+                if(ptr == MAP_FAILED)
+                    throw std::bad_alloc();
+
+                if(policy != HugePages::None)
+                {
+                    madvise(ptr, length, MADV_HUGEPAGE);
+                }
+            }
+
+            return ptr;
+        }
+#endif
+
+        void* ptr = std::aligned_alloc(CACHE_LINE, RoundUp(bytes, CACHE_LINE));
+        if(!ptr)
+            throw std::bad_alloc();
+
+        return ptr;
+    }
+
+    void Deallocate(void* ptr, std::size_t bytes) noexcept
+    {
+        if(!ptr)
+            return;
+
+#if defined(__linux__)
+        if(bytes >= MMAP_THRESHOLD)
+        {
+            munmap(ptr, RoundUp(bytes, HUGE_PAGE_SIZE));
+            return;
+        }
+#endif
+
+        std::free(ptr);
+    }
+}
@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <cassert>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "../include/ThreadPool.hpp"
+
+namespace
+{
+    // identifies the pool (and queue) owning the current thread, so nested calls push to their own deque
+    thread_local const ThreadPool* t_ownerPool = nullptr;
+    thread_local std::size_t t_workerIdx = 0;
+
+    std::mutex g_instanceMutex;
+    std::unique_ptr<ThreadPool> g_instance;
+}
+
+/* -------------------------- PUBLIC METHODS ------------------------------ */
+
+ThreadPool::ThreadPool(const ThreadPoolConfig& config)
+    : m_config(config)
+{
+    m_numThreads = (config.m_numThreads > 0) ? config.m_numThreads : std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+
+    // the calling thread always participates, so one fewer dedicated worker is needed
+    const std::size_t numWorkers = m_numThreads - 1;
+
+    m_queues.reserve(numWorkers + 1);
+    for(std::size_t i = 0; i < numWorkers + 1; ++i)
+    {
+        m_queues.push_back(std::make_unique<WorkQueue>());
+    }
+
+    m_workers.reserve(numWorkers);
+    for(std::size_t workerIdx = 0; workerIdx < numWorkers; ++workerIdx)
+    {
+        m_workers.emplace_back([this, workerIdx]() { WorkerLoop(workerIdx); });
+        if(m_config.m_pinThreads)
+        {
+            PinWorker(m_workers.back(), workerIdx);
+        }
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_wakeCondition.notify_all();
+
+    for(std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::Instance()
+{
+    std::lock_guard<std::mutex> lock(g_instanceMutex);
+    if(!g_instance)
+    {
+        g_instance = std::make_unique<ThreadPool>();
+    }
+
+    return *g_instance;
+}
+
+void ThreadPool::Configure(const ThreadPoolConfig& config)
+{
+    std::lock_guard<std::mutex> lock(g_instanceMutex);
+    g_instance.reset();
+    g_instance = std::make_unique<ThreadPool>(config);
+}
+
+void ThreadPool::ReinitialiseAfterFork(const ThreadPoolConfig& config)
+{
+    // the old pool is leaked on purpose: destroying it would wait on threads that were not copied by fork
+    static_cast<void>(g_instance.release());
+    g_instance = std::make_unique<ThreadPool>(config);
+}
+
+std::size_t ThreadPool::GetNumThreads() const
+{
+    return m_numThreads;
+}
+
+void ThreadPool::ParallelFor(std::size_t begin, std::size_t end, const RangeFunc& body, std::size_t grainSize)
+{
+    if(end <= begin)
+        return;
+
+    const std::size_t grain = ResolveGrainSize(end - begin, grainSize);
+    const std::size_t numChunks = (end - begin + grain - 1) / grain;
+
+    // nothing to share, skip the queues entirely
+    if(numChunks == 1 || m_workers.empty())
+    {
+        body(begin, end);
+        return;
+    }
+
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->m_body = &body;
+    job->m_remaining.store(numChunks);
+
+    const std::size_t ownQueue = (t_ownerPool == this) ? t_workerIdx : m_queues.size() - 1;
+
+    // deal contiguous blocks of chunks to every queue, starting with our own so we begin on local work
+    const std::size_t numQueues = m_queues.size();
+    const std::size_t chunksPerQueue = numChunks / numQueues;
+    const std::size_t remainderChunks = numChunks % numQueues;
+
+    std::size_t chunk = 0;
+    for(std::size_t i = 0; i < numQueues; ++i)
+    {
+        const std::size_t queueIdx = (ownQueue + i) % numQueues;
+        const std::size_t count = chunksPerQueue + (i < remainderChunks ? 1 : 0);
+        if(count == 0)
+            continue;
+
+        WorkQueue& queue = *m_queues[queueIdx];
+        std::lock_guard<std::mutex> lock(queue.m_mutex);
+        for(std::size_t c = 0; c < count; ++c, ++chunk)
+        {
+            const std::size_t chunkBegin = begin + chunk * grain;
+            const std::size_t chunkEnd = std::min(end, chunkBegin + grain);
+            queue.m_tasks.push_back({ job, chunkBegin, chunkEnd });
+        }
+    }
+    assert(chunk == numChunks);
+
+    m_pendingTasks.fetch_add(numChunks);
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+    m_wakeCondition.notify_all();
+
+    // help until every chunk of this call has finished, sleeping only when there is nothing left to take
+    while(true)
+    {
+        const std::size_t remaining = job->m_remaining.load();
+        if(remaining == 0)
+            break;
+
+        if(!TryRunOneTask(ownQueue))
+        {
+            job->m_remaining.wait(remaining);
+        }
+    }
+
+    if(job->m_exception)
+    {
+        std::rethrow_exception(job->m_exception);
+    }
+}
+
+
+/* -------------------------- PRIVATE METHODS ------------------------------ */
+
+std::size_t ThreadPool::ResolveGrainSize(std::size_t count, std::size_t grainSize) const
+{
+    if(grainSize > 0)
+        return grainSize;
+
+    // several chunks per thread leaves room for stealing to even out the tail
+    return std::max<std::size_t>(1, count / (m_numThreads * 8));
+}
+
+void ThreadPool::WorkerLoop(std::size_t workerIdx)
+{
+    t_ownerPool = this;
+    t_workerIdx = workerIdx;
+
+    while(true)
+    {
+        if(TryRunOneTask(workerIdx))
+            continue;
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wakeCondition.wait(lock, [this]() { return m_stop || m_pendingTasks.load() > 0; });
+        if(m_stop)
+            return;
+    }
+}
+
+bool ThreadPool::TryPopTask(std::size_t queueIdx, Task& task)
+{
+    WorkQueue& queue = *m_queues[queueIdx];
+    std::lock_guard<std::mutex> lock(queue.m_mutex);
+    if(queue.m_tasks.empty())
+        return false;
+
+    task = std::move(queue.m_tasks.front());
+    queue.m_tasks.pop_front();
+    return true;
+}
+
+bool ThreadPool::TryStealTask(std::size_t thiefIdx, Task& task)
+{
+    const std::size_t numQueues = m_queues.size();
+    for(std::size_t offset = 1; offset < numQueues; ++offset)
+    {
+        WorkQueue& queue = *m_queues[(thiefIdx + offset) % numQueues];
+        std::lock_guard<std::mutex> lock(queue.m_mutex);
+        if(queue.m_tasks.empty())
+            continue;
+
+        task = std::move(queue.m_tasks.back());
+        queue.m_tasks.pop_back();
+        return true;
+    }
+
+    return false;
+}
+
+bool ThreadPool::TryRunOneTask(std::size_t preferredQueue)
+{
+    Task task;
+    if(!TryPopTask(preferredQueue, task) && !TryStealTask(preferredQueue, task))
+        return false;
+
+    m_pendingTasks.fetch_sub(1);
+    RunTask(task);
+    return true;
+}
+
+void ThreadPool::RunTask(const Task& task)
+{
+    Job& job = *task.m_job;
+
+    if(!job.m_failed.load())
+    {
+        try
+        {
+            (*job.m_body)(task.m_begin, task.m_end);
+        }
+        catch(...)
+        {
+            std::lock_guard<std::mutex> lock(job.m_exceptionMutex);
+            if(!job.m_exception)
+            {
+                job.m_exception = std::current_exception();
+            }
+            job.m_failed.store(true);
+        }
+    }
+
+    // the task keeps the job alive, so notifying after the last decrement is safe
+    job.m_remaining.fetch_sub(1);
+    job.m_remaining.notify_all();
+}
+
+void ThreadPool::PinWorker(std::thread& worker, std::size_t workerIdx)
+{
+#if defined(__linux__)
+    std::vector<int> cpus = m_config.m_cpus;
+    if(cpus.empty())
+    {
+        const int numCpus = static_cast<int>(std::max<unsigned>(std::thread::hardware_concurrency(), 1));
+        for(int cpu = 0; cpu < numCpus; ++cpu)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+
+    // the calling thread is left on the first CPU, workers take the following ones
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpus[(workerIdx + 1) % cpus.size()], &cpuSet);
+    pthread_setaffinity_np(worker.native_handle(), sizeof(cpu_set_t), &cpuSet);
+#else
+    (void)worker;
+    (void)workerIdx;
+#endif
+}
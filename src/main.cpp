@@ -13,6 +13,10 @@
 #include "../include/DataHandler.hpp"
 #include "../include/PortfolioUtils.hpp"
 #include "../include/PortfolioOptimisation.hpp"
+#include "../include/AdaptiveMonteCarlo.hpp"
+#include "../include/RiskEngine.hpp"
+#include "../include/ScenarioAnalysis.hpp"
+#include "../include/QuantileSelection.hpp"
 
 // EXAMPLE USAGE:
 // ./run.sh NVDA=0.15 GOOGL=0.1 AGYS=0.08 AMZN=0.03 MU=0.06 MSFT=0.03 NU=0.04 LLY=0.085 UNH=0.2 NVO=0.225 2024-11-12 2025-10-18 
@@ -115,20 +119,181 @@ int main(int argc, char* argv[])
 
     const Eigen::MatrixXd choleskyMatrix = PortfolioOptimisation::GetCholeskyMatrix(covMatrix);
 
-    constexpr std::size_t NUM_SIMS = 1'000'000;
+    // the Gaussian model has closed-form risk, so nothing is simulated for it; the history's shape adds Cornish-Fisher figures
+    RiskEngine::Query analyticQuery;
+    analyticQuery.m_historicalReturns = mce.CombineAssetReturns(portfolio);
+    const RiskEngine::Evaluation analytic = RiskEngine::Evaluate(mce, choleskyMatrix, assetStatistics, weights, analyticQuery);
+
+    std::cout << "\nAnalytic Annual Risk (" << (analytic.m_method == RiskEngine::Method::ClosedForm ? "closed form" : "simulated") << ", "
+              << std::setprecision(3) << analytic.m_elapsedMs << " ms):" << '\n';
+    std::cout << "  Gaussian        Mean: " << std::setprecision(2) << analytic.m_horizons.back().m_meanReturn * 100 << "%  VaR: "
+              << analytic.m_horizons.back().m_VaR * 100 << "%  CVaR: " << analytic.m_horizons.back().m_CVaR * 100 << "%" << '\n';
+    std::cout << "  Cornish-Fisher  Mean: " << analytic.m_cornishFisher.back().m_meanReturn * 100 << "%  VaR: "
+              << analytic.m_cornishFisher.back().m_VaR * 100 << "%  CVaR: " << analytic.m_cornishFisher.back().m_CVaR * 100 << "%" << '\n';
+
+    // simulation buffers run to hundreds of MB, so let the kernel back them with huge pages where it can
+    SimulationMemory::SetHugePagePolicy(HugePages::Transparent);
+
+    // simulate in batches until mean, VaR, CVaR and the tracked quantiles are pinned down, rather than a fixed path count
+    constexpr std::size_t MAX_SIMS = 1'000'000;
     constexpr std::size_t NUM_DAYS = 252;
-    auto start = std::chrono::high_resolution_clock::now();
-    Returns returns = mce.GenerateReturnsForMultiAsset(choleskyMatrix, assetStatistics, weights, false, NUM_SIMS, NUM_DAYS);
-    auto end = std::chrono::high_resolution_clock::now();
 
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    AdaptiveMonteCarlo::Config adaptiveConfig;
+    adaptiveConfig.m_numDays = NUM_DAYS;
+    adaptiveConfig.m_maxPaths = MAX_SIMS;
 
-    // Returns pricePaths = mce.BuildPricePaths(returns, 100);
+    const AdaptiveMonteCarlo::Result simulation = AdaptiveMonteCarlo::RunMultiAsset(mce, choleskyMatrix, assetStatistics, weights, false, adaptiveConfig);
+
+    // Returns pricePaths = mce.GenerateReturnsForMultiAsset(choleskyMatrix, assetStatistics, weights, false, 1000, NUM_DAYS, { .m_output = SimulationOutput::PricePaths });
     // DataHandler::WritePathsToCSV(pricePaths, "../data/multi_assets_paths.csv");
 
+    const int ciLevelPercent = static_cast<int>(adaptiveConfig.m_ciLevel * 100);
+    const auto printEstimate = [ciLevelPercent](const char* label, const AdaptiveMonteCarlo::Estimate& estimate) {
+        std::cout << label << std::setprecision(2) << estimate.m_value * 100 << "%"
+                  << "  (" << ciLevelPercent << "% CI: " << estimate.m_lower * 100 << "% to " << estimate.m_upper * 100 << "%)" << '\n';
+    };
+
     std::cout << "\nMonte Carlo Simulation:" << '\n';
-    std::cout << "  Simulated paths: " << NUM_SIMS << "" << '\n';
+    std::cout << "  Simulated paths: " << simulation.m_numPaths << " (max " << MAX_SIMS << ", " << simulation.m_numBatches << " batches)" << '\n';
+    std::cout << "  Stopped because: ";
+    switch(simulation.m_stopReason)
+    {
+        case AdaptiveMonteCarlo::StopReason::Converged:  std::cout << "converged" << '\n'; break;
+        case AdaptiveMonteCarlo::StopReason::TimeBudget: std::cout << "time budget reached" << '\n'; break;
+        case AdaptiveMonteCarlo::StopReason::MaxPaths:   std::cout << "path limit reached" << '\n'; break;
+        case AdaptiveMonteCarlo::StopReason::Running:    break;
+    }
     std::cout << "  Days per path: " << NUM_DAYS << "" << '\n';
     std::cout << "  Number of assets: " << tickers.size() << "" << '\n';
-    std::cout << "  Time taken: " << duration << " ms" << '\n';
+    printEstimate("  Mean Annual Return:  ", simulation.m_mean);
+    printEstimate("  Annual VaR:          ", simulation.m_VaR);
+    printEstimate("  Annual CVaR:         ", simulation.m_CVaR);
+    std::cout << "  Time taken: " << std::setprecision(0) << simulation.m_elapsedMs << " ms" << '\n';
+
+    // an interactive query: whatever the simulation has pinned down when 200 ms are up
+    AdaptiveMonteCarlo::Config interactiveConfig = adaptiveConfig;
+    interactiveConfig.m_timeBudget = std::chrono::milliseconds(200);
+
+    const AdaptiveMonteCarlo::Result interactive = AdaptiveMonteCarlo::RunMultiAsset(mce, choleskyMatrix, assetStatistics, weights, false, interactiveConfig);
+
+    std::cout << "\nInteractive Query (" << interactiveConfig.m_timeBudget.count() << " ms budget, " << interactive.m_numPaths << " paths in "
+              << std::setprecision(0) << interactive.m_elapsedMs << " ms):" << '\n';
+    printEstimate("  Annual VaR:          ", interactive.m_VaR);
+    printEstimate("  Annual CVaR:         ", interactive.m_CVaR);
+
+    // every reporting horizon is read off the same one-year paths as they pass it; only the checkpoint sketches are kept
+    constexpr std::size_t TERM_SIMS = 200'000;
+
+    SimulationOptions termOptions;
+    termOptions.m_checkpointDays = { 1, 10, 21, 63, NUM_DAYS };
+    termOptions.m_storePaths = false;
+    // fan-chart bands and a few whole paths for scripts/paths.py, without keeping the other paths
+    termOptions.m_bandQuantiles = { 0.05, 0.25, 0.5, 0.75, 0.95 };
+    termOptions.m_samplePaths = 50;
+
+    const Returns termReturns = mce.GenerateReturnsForMultiAsset(choleskyMatrix, assetStatistics, weights, false, TERM_SIMS, NUM_DAYS, termOptions);
+    DataHandler::WriteFanChartToCSV(termReturns.m_fanChart, termOptions.m_initialPrice, "../data/multi_assets_bands.csv", "../data/multi_assets_paths.csv");
+
+    std::cout << "\nRisk Term Structure (" << TERM_SIMS << " paths):" << '\n';
+    for(const HorizonRisk& risk : mce.EvaluateHorizons(termReturns))
+    {
+        std::cout << "  " << std::setw(3) << risk.m_days << "-day  VaR: " << std::setprecision(2) << risk.m_VaR * 100 << "%"
+                  << "  CVaR: " << risk.m_CVaR * 100 << "%" << '\n';
+    }
+
+    // current, min-vol, max-Sharpe and every frontier point on the same simulated paths, so the comparison is like for like
+    Eigen::MatrixXd candidateWeights(static_cast<Eigen::Index>(tickers.size()), static_cast<Eigen::Index>(3 + frontier.weights.size()));
+    const auto setCandidate = [&](std::size_t column, const std::vector<double>& candidate) {
+        for(std::size_t i = 0; i < tickers.size(); ++i)
+        {
+            candidateWeights(static_cast<Eigen::Index>(i), static_cast<Eigen::Index>(column)) = candidate[i];
+        }
+    };
+    setCandidate(0, weights);
+    setCandidate(1, minVolPortfolio.weights);
+    setCandidate(2, maxSharpePortfolio.weights);
+    for(std::size_t point = 0; point < frontier.weights.size(); ++point)
+    {
+        setCandidate(3 + point, frontier.weights[point]);
+    }
+
+    const std::vector<PortfolioRisk> candidateRisks = mce.SimulatePortfolios(choleskyMatrix, assetStatistics, candidateWeights, false, TERM_SIMS, NUM_DAYS);
+
+    std::size_t lowestCVaRPoint = 3;
+    for(std::size_t column = 3; column < candidateRisks.size(); ++column)
+    {
+        if(candidateRisks[column].m_horizons.back().m_CVaR < candidateRisks[lowestCVaRPoint].m_horizons.back().m_CVaR)
+        {
+            lowestCVaRPoint = column;
+        }
+    }
+
+    const auto printCandidate = [](const char* label, const PortfolioRisk& risk) {
+        const HorizonRisk& annual = risk.m_horizons.back();
+        std::cout << label << "Mean: " << std::setprecision(2) << annual.m_meanReturn * 100 << "%  VaR: " << annual.m_VaR * 100 << "%  CVaR: " << annual.m_CVaR * 100 << "%" << '\n';
+    };
+
+    std::cout << "\nSimulated Annual Risk (common random numbers):" << '\n';
+    printCandidate("  Current:          ", candidateRisks[0]);
+    printCandidate("  Min Volatility:   ", candidateRisks[1]);
+    printCandidate("  Max Sharpe:       ", candidateRisks[2]);
+    if(candidateRisks.size() > 3)
+    {
+        std::cout << "  Lowest-CVaR frontier point: " << lowestCVaRPoint - 3 << '\n';
+        printCandidate("                    ", candidateRisks[lowestCVaRPoint]);
+    }
+
+    // the current weights held as an account: monthly rebalancing at 10bp, a 1% deposit at every month end
+    WealthPlan wealthPlan;
+    wealthPlan.m_targetWeights = weights;
+    wealthPlan.m_transactionCost = 0.001;
+    for(std::size_t day = 20; day < NUM_DAYS; day += 21)
+    {
+        wealthPlan.m_cashFlows.push_back({ day, 0.01 });
+    }
+
+    const WealthReport wealth = mce.SimulateWealth(choleskyMatrix, assetStatistics, wealthPlan, false, TERM_SIMS, NUM_DAYS);
+
+    std::cout << "\nWealth Plan (monthly rebalancing and deposits, " << TERM_SIMS << " paths):" << '\n';
+    std::cout << "  Mean terminal wealth:   " << std::setprecision(3) << wealth.m_meanTerminalWealth << '\n';
+    std::cout << "  Median terminal wealth: " << wealth.m_medianTerminalWealth << '\n';
+    std::cout << "  5% worst-case wealth:   " << wealth.m_terminalWealthAtRisk << '\n';
+    std::cout << "  P(below " << wealth.m_shortfallLevel << " contributed): " << std::setprecision(2) << wealth.m_shortfallProbability * 100 << "%" << '\n';
+    std::cout << "  Mean costs paid:        " << std::setprecision(4) << wealth.m_meanCosts << '\n';
+
+    // replay past crises and hypothetical shocks against the current, min-vol and max-Sharpe weights in one product
+    ScenarioAnalysis::ScenarioSet scenarios;
+    const auto [datedReturns, returnDates] = DataHandler::GetDatedLogReturnsMat(portfolio.GetTickers());
+    ScenarioAnalysis::AddHistoricalWindow(scenarios, "Covid crash (Feb-Mar 2020)", datedReturns, returnDates, "2020-02-19", "2020-03-23");
+    ScenarioAnalysis::AddHistoricalWindow(scenarios, "Rate shock (H1 2022)", datedReturns, returnDates, "2022-01-03", "2022-06-16");
+    ScenarioAnalysis::AddHistoricalWindow(scenarios, "Tariff sell-off (Apr 2025)", datedReturns, returnDates, "2025-04-02", "2025-04-08");
+    ScenarioAnalysis::AddShock(scenarios, "Every asset -20%", std::vector<double>(tickers.size(), -0.2));
+
+    // 10-day moves with doubled vols and correlations halfway to one
+    constexpr std::size_t STRESS_SAMPLES = 10'000;
+    const std::size_t firstSample = scenarios.GetNumScenarios();
+    const std::vector<std::vector<double>> stressedCov = ScenarioAnalysis::StressCovariance(covMatrix, std::vector<double>(tickers.size(), 2.0), 0.5);
+    ScenarioAnalysis::AddSampledScenarios(scenarios, "Stressed 10-day", stressedCov, STRESS_SAMPLES, 10, 20241105);
+
+    const Eigen::MatrixXd scenarioPnL = ScenarioAnalysis::EvaluatePnL(scenarios, candidateWeights.leftCols(3));
+    const std::vector<ScenarioAnalysis::WorstCase> worstCases = ScenarioAnalysis::FindWorstCases(scenarioPnL.topRows(static_cast<Eigen::Index>(firstSample)));
+
+    std::cout << "\nStress Scenarios (current / min vol / max Sharpe):" << '\n';
+    for(std::size_t scenario = 0; scenario < firstSample; ++scenario)
+    {
+        std::cout << "  " << std::left << std::setw(28) << scenarios.m_names[scenario] << std::right << std::setprecision(2);
+        for(Eigen::Index portfolio = 0; portfolio < 3; ++portfolio)
+        {
+            std::cout << std::setw(9) << scenarioPnL(static_cast<Eigen::Index>(scenario), portfolio) * 100 << "%";
+        }
+        std::cout << '\n';
+    }
+    std::cout << "  " << std::left << std::setw(28) << "Stressed 10-day 99% VaR" << std::right;
+    for(Eigen::Index portfolio = 0; portfolio < 3; ++portfolio)
+    {
+        const double VaR = -QuantileSelection::Select(scenarioPnL.col(portfolio).data() + firstSample, STRESS_SAMPLES, { 0.01 }).front().m_value;
+        std::cout << std::setw(9) << VaR * 100 << "%";
+    }
+    std::cout << '\n';
+    std::cout << "  Worst named scenario for the current portfolio: " << scenarios.m_names[worstCases[0].m_scenario] << '\n';
 }
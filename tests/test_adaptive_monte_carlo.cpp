@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <thread>
+
+#include "AdaptiveMonteCarlo.hpp"
+#include "MathUtils.hpp"
+
+namespace
+{
+    constexpr uint64_t SEED = 20241104;
+
+    constexpr double LOG_MEAN = 0.05;
+    constexpr double LOG_STDDEV = 0.2;
+
+    // terminal log-returns drawn straight from N(LOG_MEAN, LOG_STDDEV^2), so the risk has a closed form
+    AdaptiveMonteCarlo::BatchSimulator LognormalSimulator()
+    {
+        auto rng = std::make_shared<std::mt19937_64>(SEED);
+        return [rng](std::size_t numPaths) {
+            std::normal_distribution<double> normal(LOG_MEAN, LOG_STDDEV);
+            std::vector<double> logReturns(numPaths);
+            for(double& logReturn : logReturns)
+            {
+                logReturn = normal(*rng);
+            }
+            return logReturns;
+        };
+    }
+
+    // normal terminal log-returns at a steady 5 microseconds a path, so the run is slow enough to be cut off
+    AdaptiveMonteCarlo::BatchSimulator SlowSimulator()
+    {
+        auto rng = std::make_shared<std::mt19937_64>(SEED);
+        return [rng](std::size_t numPaths) {
+            std::normal_distribution<double> normal(0.05, 0.2);
+            std::vector<double> logReturns(numPaths);
+            for(double& logReturn : logReturns)
+            {
+                logReturn = normal(*rng);
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(5 * numPaths));
+            return logReturns;
+        };
+    }
+}
+
+// a loose tolerance should be met long before the path limit, with intervals around the lognormal closed form
+TEST(AdaptiveMonteCarloTest, StopsOnceConverged)
+{
+    AdaptiveMonteCarlo::Config config;
+    config.m_absoluteTolerance = 0.002;
+    config.m_relativeTolerance = 0.02;
+    config.m_maxPaths = 10'000'000;
+
+    const AdaptiveMonteCarlo::Result result = AdaptiveMonteCarlo::Run(LognormalSimulator(), config);
+
+    EXPECT_EQ(result.m_stopReason, AdaptiveMonteCarlo::StopReason::Converged);
+    EXPECT_GE(result.m_numBatches, config.m_minBatches);
+    EXPECT_LT(result.m_numPaths, config.m_maxPaths / 20);
+    EXPECT_EQ(result.m_numPaths % config.m_batchSize, 0u);
+
+    const double tailProbability = 1.0 - config.m_confidence;
+    const double z = MathUtils::NormalQuantile(tailProbability);
+    const double exactVaR = -std::expm1(LOG_MEAN + LOG_STDDEV * z);
+    const double exactCVaR = 1.0 - std::exp(LOG_MEAN + 0.5 * LOG_STDDEV * LOG_STDDEV) * MathUtils::NormalCdf(z - LOG_STDDEV) / tailProbability;
+    const double exactMean = std::expm1(LOG_MEAN + 0.5 * LOG_STDDEV * LOG_STDDEV);
+
+    EXPECT_LE(result.m_VaR.m_lower, exactVaR);
+    EXPECT_GE(result.m_VaR.m_upper, exactVaR);
+    EXPECT_LE(result.m_CVaR.m_lower, exactCVaR);
+    EXPECT_GE(result.m_CVaR.m_upper, exactCVaR);
+    EXPECT_LE(result.m_mean.m_lower, exactMean);
+    EXPECT_GE(result.m_mean.m_upper, exactMean);
+
+    // converged means every half-width is inside the tolerance
+    for(const AdaptiveMonteCarlo::Estimate& estimate : { result.m_mean, result.m_VaR, result.m_CVaR })
+    {
+        EXPECT_LE(estimate.m_upper - estimate.m_value, std::max(config.m_absoluteTolerance, config.m_relativeTolerance * std::abs(estimate.m_value)) + 1e-15);
+    }
+}
+
+// the run should end on the budget, not one full batch past it, and report every batch on the way
+TEST(AdaptiveMonteCarloTest, AnytimeRunMeetsDeadline)
+{
+    AdaptiveMonteCarlo::Config config;
+    config.m_timeBudget = std::chrono::milliseconds(200);
+    config.m_absoluteTolerance = 0.0;
+    config.m_relativeTolerance = 0.0;
+
+    std::vector<AdaptiveMonteCarlo::Result> updates;
+    const auto start = std::chrono::steady_clock::now();
+    const AdaptiveMonteCarlo::Result result = AdaptiveMonteCarlo::Run(SlowSimulator(), config, [&updates](const AdaptiveMonteCarlo::Result& update) {
+        updates.push_back(update);
+    });
+    const double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    EXPECT_EQ(result.m_stopReason, AdaptiveMonteCarlo::StopReason::TimeBudget);
+    EXPECT_LT(wallMs, 250.0);
+    EXPECT_GE(result.m_numBatches, config.m_minBatches);
+
+    ASSERT_EQ(updates.size(), result.m_numBatches);
+    for(std::size_t i = 0; i < updates.size(); ++i)
+    {
+        EXPECT_EQ(updates[i].m_stopReason, AdaptiveMonteCarlo::StopReason::Running);
+        EXPECT_EQ(updates[i].m_numBatches, i + 1);
+        if(i > 0)
+        {
+            EXPECT_GT(updates[i].m_numPaths, updates[i - 1].m_numPaths);
+        }
+    }
+    EXPECT_EQ(updates.back().m_numPaths, result.m_numPaths);
+    EXPECT_EQ(updates.back().m_VaR.m_value, result.m_VaR.m_value);
+
+    // the interval should cover the exact 95% VaR of the lognormal return
+    const double exactVaR = -std::expm1(0.05 - 1.6448536269514722 * 0.2);
+    EXPECT_TRUE(std::isfinite(result.m_VaR.m_standardError));
+    EXPECT_LT(result.m_VaR.m_lower - 2.0 * result.m_VaR.m_standardError, exactVaR);
+    EXPECT_GT(result.m_VaR.m_upper + 2.0 * result.m_VaR.m_standardError, exactVaR);
+}
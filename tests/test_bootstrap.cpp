@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <map>
+#include <numeric>
+
+#include "MonteCarloEngine.hpp"
+
+namespace
+{
+    constexpr uint64_t SEED = 20241022;
+    constexpr std::size_t HISTORY_LENGTH = 500;
+    constexpr std::size_t NUM_PATHS = 2'000;
+    constexpr std::size_t NUM_DAYS = 252;
+
+    const std::vector<double> WEIGHTS = { 0.6, 0.4 };
+
+    // two assets whose portfolio return is different on every day, so a simulated value names the day it came from
+    std::vector<std::vector<double>> History()
+    {
+        std::vector<std::vector<double>> history(HISTORY_LENGTH);
+        for(std::size_t t = 0; t < HISTORY_LENGTH; ++t)
+        {
+            history[t] = { 0.02 * std::sin(static_cast<double>(t)) + 0.0004, 0.01 * std::cos(1.7 * static_cast<double>(t)) };
+        }
+        return history;
+    }
+
+    std::map<double, std::size_t> DayOfValue(const std::vector<std::vector<double>>& history)
+    {
+        std::map<double, std::size_t> days;
+        for(std::size_t t = 0; t < history.size(); ++t)
+        {
+            days[std::inner_product(WEIGHTS.begin(), WEIGHTS.end(), history[t].begin(), 0.0)] = t;
+        }
+        EXPECT_EQ(days.size(), history.size());
+        return days;
+    }
+
+    Returns Bootstrap(const std::vector<std::vector<double>>& history, BootstrapScheme scheme, double blockLength)
+    {
+        BootstrapOptions options;
+        options.m_scheme = scheme;
+        options.m_blockLength = blockLength;
+        return MonteCarloEngine(SEED).GenerateReturnsFromBootstrap(history, WEIGHTS, NUM_PATHS, NUM_DAYS, options);
+    }
+
+    // the history day of every simulated day, failing the test for a value that is not in the history
+    std::vector<std::size_t> SourceDays(const Returns& returns, const std::map<double, std::size_t>& days)
+    {
+        std::vector<std::size_t> sources(returns.m_returns.size());
+        for(std::size_t i = 0; i < sources.size(); ++i)
+        {
+            const auto found = days.find(returns.m_returns[i]);
+            if(found == days.end())
+            {
+                ADD_FAILURE() << "simulated value " << returns.m_returns[i] << " is not a day of the history";
+                return {};
+            }
+            sources[i] = found->second;
+        }
+        return sources;
+    }
+}
+
+// fixed-length blocks: every block is a run of consecutive days, wrapping from the end of the history to its start
+TEST(BootstrapTest, CircularBlocksAreContiguous)
+{
+    constexpr std::size_t BLOCK = 7;
+    const std::vector<std::vector<double>> history = History();
+    const std::vector<std::size_t> sources = SourceDays(Bootstrap(history, BootstrapScheme::Circular, BLOCK), DayOfValue(history));
+    ASSERT_EQ(sources.size(), NUM_PATHS * NUM_DAYS);
+
+    std::size_t wrapped = 0;
+    for(std::size_t path = 0; path < NUM_PATHS; ++path)
+    {
+        const std::size_t* source = sources.data() + path * NUM_DAYS;
+        for(std::size_t day = 0; day < NUM_DAYS; ++day)
+        {
+            if(day % BLOCK == 0)
+                continue;
+
+            ASSERT_EQ(source[day], (source[day - 1] + 1) % HISTORY_LENGTH) << "path " << path << ", day " << day;
+            wrapped += (source[day] == 0) ? 1 : 0;
+        }
+    }
+    EXPECT_GT(wrapped, 0u);
+}
+
+// geometric blocks: a path is still a chain of contiguous runs, and a run ends with probability 1 / blockLength per day
+TEST(BootstrapTest, StationaryBlocksHaveGeometricLengths)
+{
+    constexpr double BLOCK_LENGTH = 10.0;
+    const std::vector<std::vector<double>> history = History();
+    const std::vector<std::size_t> sources = SourceDays(Bootstrap(history, BootstrapScheme::Stationary, BLOCK_LENGTH), DayOfValue(history));
+    ASSERT_EQ(sources.size(), NUM_PATHS * NUM_DAYS);
+
+    std::size_t breaks = 0;
+    for(std::size_t path = 0; path < NUM_PATHS; ++path)
+    {
+        const std::size_t* source = sources.data() + path * NUM_DAYS;
+        for(std::size_t day = 1; day < NUM_DAYS; ++day)
+        {
+            breaks += (source[day] != (source[day - 1] + 1) % HISTORY_LENGTH) ? 1 : 0;
+        }
+    }
+
+    // a new block that happens to start on the next day is not seen as a break
+    const double expectedRate = (1.0 / BLOCK_LENGTH) * (1.0 - 1.0 / static_cast<double>(HISTORY_LENGTH));
+    const double breakRate = static_cast<double>(breaks) / static_cast<double>(NUM_PATHS * (NUM_DAYS - 1));
+    EXPECT_NEAR(breakRate, expectedRate, 0.03 * expectedRate);
+}
+
+TEST(BootstrapTest, MeanMatchesHistory)
+{
+    const std::vector<std::vector<double>> history = History();
+    const Returns returns = Bootstrap(history, BootstrapScheme::Stationary, 20.0);
+
+    double historyMean = 0.0;
+    double historySqMean = 0.0;
+    for(const auto& [value, day] : DayOfValue(history))
+    {
+        historyMean += value;
+        historySqMean += value * value;
+    }
+    historyMean /= static_cast<double>(HISTORY_LENGTH);
+    historySqMean /= static_cast<double>(HISTORY_LENGTH);
+    EXPECT_NEAR(returns.m_stepDrift, historyMean, 1e-15);
+
+    // blocks of about 20 days are close to independent blocks, so the error shrinks with the number of blocks
+    const double n = static_cast<double>(returns.m_returns.size());
+    const double sampleMean = std::accumulate(returns.m_returns.begin(), returns.m_returns.end(), 0.0) / n;
+    const double stdDev = std::sqrt(historySqMean - historyMean * historyMean);
+    EXPECT_NEAR(sampleMean, historyMean, 4.0 * stdDev * std::sqrt(20.0 / n));
+}
+
+// a day with a missing price is left out of the resampled history rather than replayed as a flat day
+TEST(BootstrapTest, NonFiniteDaysAreDropped)
+{
+    std::vector<std::vector<double>> history = History();
+    history[10][1] = std::numeric_limits<double>::quiet_NaN();
+    history[11][0] = -std::numeric_limits<double>::infinity();
+
+    std::vector<std::vector<double>> finite = history;
+    finite.erase(finite.begin() + 10, finite.begin() + 12);
+
+    const Returns returns = Bootstrap(history, BootstrapScheme::Circular, 5.0);
+    const std::map<double, std::size_t> days = DayOfValue(finite);
+    for(double value : returns.m_returns)
+    {
+        ASSERT_TRUE(days.count(value)) << value;
+    }
+
+    double finiteMean = 0.0;
+    for(const auto& [value, day] : days)
+    {
+        finiteMean += value;
+    }
+    EXPECT_NEAR(returns.m_stepDrift, finiteMean / static_cast<double>(finite.size()), 1e-15);
+}
@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "FactorModel.hpp"
+#include "MonteCarloEngine.hpp"
+#include "PortfolioOptimisation.hpp"
+
+namespace
+{
+    constexpr uint64_t SEED = 20240911;
+
+    // three annualised factors over a small universe, with idiosyncratic vols between 10% and 25%
+    FactorLoadings TrueModel(std::size_t numAssets)
+    {
+        GenNormalPCG rng = GenNormalPCG::FromSeed(SEED);
+
+        FactorLoadings model;
+        model.m_loadings = 0.08 * rng.GenerateRandomMatrix(numAssets, 3);
+        model.m_loadings.col(0).array() += 0.15;
+        model.m_idiosyncraticVols = Eigen::VectorXd::LinSpaced(static_cast<Eigen::Index>(numAssets), 0.10, 0.25);
+        return model;
+    }
+
+    // days x assets daily log-returns drawn from the model
+    std::vector<std::vector<double>> SimulateHistory(const FactorLoadings& model, std::size_t numPeriods)
+    {
+        GenNormalPCG rng = GenNormalPCG::FromSeed(SEED + 1);
+        const Eigen::MatrixXd factors = rng.GenerateRandomMatrix(model.GetNumFactors(), numPeriods);
+        const Eigen::MatrixXd noise = rng.GenerateRandomMatrix(model.GetNumAssets(), numPeriods);
+        const Eigen::MatrixXd daily = (model.m_loadings * factors + model.m_idiosyncraticVols.asDiagonal() * noise) / std::sqrt(252.0);
+
+        std::vector<std::vector<double>> logReturnsMat(numPeriods, std::vector<double>(model.GetNumAssets()));
+        for(std::size_t t = 0; t < numPeriods; ++t)
+        {
+            for(std::size_t asset = 0; asset < model.GetNumAssets(); ++asset)
+            {
+                logReturnsMat[t][asset] = daily(static_cast<Eigen::Index>(asset), static_cast<Eigen::Index>(t));
+            }
+        }
+
+        return logReturnsMat;
+    }
+
+    Eigen::MatrixXd Covariance(const FactorLoadings& model)
+    {
+        Eigen::MatrixXd covariance = model.m_loadings * model.m_loadings.transpose();
+        covariance.diagonal() += model.m_idiosyncraticVols.cwiseAbs2();
+        return covariance;
+    }
+}
+
+// the fitted B B^T + D^2 should reproduce the generating covariance, and the Gram-matrix route taken when there
+// are fewer days than assets should give the same factor covariance as decomposing the full covariance
+TEST(FactorModelTest, FitStatisticalRecoversCovariance)
+{
+    const FactorLoadings truth = TrueModel(40);
+    const std::vector<std::vector<double>> history = SimulateHistory(truth, 5000);
+
+    const Eigen::MatrixXd expected = Covariance(truth);
+    const Eigen::MatrixXd fitted = Covariance(FactorModel::FitStatistical(history, 3));
+    EXPECT_LT((fitted - expected).norm() / expected.norm(), 0.1);
+
+    const std::vector<std::vector<double>> shortHistory(history.begin(), history.begin() + 30);
+    const FactorLoadings wide = FactorModel::FitStatistical(shortHistory, 3);
+    const Eigen::MatrixXd wideFactorCovariance = wide.m_loadings * wide.m_loadings.transpose();
+
+    const Eigen::MatrixXd sampleCovariance = [&] {
+        std::vector<std::vector<double>> cov = PortfolioOptimisation::CalculateCovarianceMatrix(shortHistory);
+        Eigen::MatrixXd matrix(40, 40);
+        for(Eigen::Index i = 0; i < 40; ++i)
+        {
+            for(Eigen::Index j = 0; j < 40; ++j)
+            {
+                matrix(i, j) = cov[static_cast<std::size_t>(i)][static_cast<std::size_t>(j)];
+            }
+        }
+        return matrix;
+    }();
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(sampleCovariance);
+    const Eigen::MatrixXd top = solver.eigenvectors().rightCols(3);
+    const Eigen::MatrixXd rankThree = top * solver.eigenvalues().tail(3).asDiagonal() * top.transpose();
+
+    EXPECT_LT((wideFactorCovariance - rankThree).norm() / rankThree.norm(), 1e-8);
+    EXPECT_NEAR(wide.TotalVols().squaredNorm(), sampleCovariance.trace(), 1e-8 * sampleCovariance.trace());
+}
+
+// a day with a missing return drops out whole, so the fit is the one of the complete days and stays finite
+TEST(FactorModelTest, FitStatisticalSkipsMissingDays)
+{
+    const FactorLoadings truth = TrueModel(40);
+    const std::vector<std::vector<double>> history = SimulateHistory(truth, 500);
+
+    std::vector<std::vector<double>> gappy = history;
+    for(std::size_t t = 7; t < gappy.size(); t += 50)
+    {
+        gappy[t][t % 40] = std::numeric_limits<double>::quiet_NaN();
+    }
+    std::vector<std::vector<double>> complete;
+    for(const std::vector<double>& day : gappy)
+    {
+        if(std::all_of(day.begin(), day.end(), [](double value) { return std::isfinite(value); }))
+        {
+            complete.push_back(day);
+        }
+    }
+    ASSERT_EQ(complete.size(), history.size() - 10);
+
+    const FactorLoadings fitted = FactorModel::FitStatistical(gappy, 3);
+    const FactorLoadings expected = FactorModel::FitStatistical(complete, 3);
+    EXPECT_TRUE(fitted.m_loadings.allFinite());
+    EXPECT_TRUE(fitted.m_idiosyncraticVols.allFinite());
+    EXPECT_EQ(fitted.m_loadings, expected.m_loadings);
+    EXPECT_EQ(fitted.m_idiosyncraticVols, expected.m_idiosyncraticVols);
+}
+
+// factor-driven common random numbers should give the same risk as the dense Cholesky simulation of B B^T + D^2
+TEST(FactorModelTest, SimulatePortfoliosMatchesDenseCovariance)
+{
+    constexpr std::size_t NUM_ASSETS = 40;
+    constexpr std::size_t NUM_PATHS = 200'000;
+    const FactorLoadings model = TrueModel(NUM_ASSETS);
+    const Eigen::MatrixXd covariance = Covariance(model);
+
+    std::vector<double> drifts(NUM_ASSETS, 0.05);
+    std::vector<std::pair<double, double>> assetStatistics(NUM_ASSETS);
+    std::vector<std::vector<double>> covMatrix(NUM_ASSETS, std::vector<double>(NUM_ASSETS));
+    for(std::size_t i = 0; i < NUM_ASSETS; ++i)
+    {
+        assetStatistics[i] = { drifts[i], std::sqrt(covariance(static_cast<Eigen::Index>(i), static_cast<Eigen::Index>(i))) };
+        for(std::size_t j = 0; j < NUM_ASSETS; ++j)
+        {
+            covMatrix[i][j] = covariance(static_cast<Eigen::Index>(i), static_cast<Eigen::Index>(j));
+        }
+    }
+
+    // equal weight, a single name and a long-short pair
+    Eigen::MatrixXd weights = Eigen::MatrixXd::Zero(NUM_ASSETS, 3);
+    weights.col(0).setConstant(1.0 / NUM_ASSETS);
+    weights(0, 1) = 1.0;
+    weights(1, 2) = 1.0;
+    weights(2, 2) = -0.5;
+
+    const std::vector<std::size_t> checkpointDays = { 21, 252 };
+    const MonteCarloEngine engine(SEED);
+    const std::vector<PortfolioRisk> factorRisks = engine.SimulatePortfolios(model, drifts, weights, false, NUM_PATHS, 252, 0.95, checkpointDays);
+    const std::vector<PortfolioRisk> denseRisks = engine.SimulatePortfolios(PortfolioOptimisation::GetCholeskyMatrix(covMatrix), assetStatistics, weights, false, NUM_PATHS, 252, 0.95, checkpointDays);
+
+    ASSERT_EQ(factorRisks.size(), 3u);
+    for(std::size_t p = 0; p < factorRisks.size(); ++p)
+    {
+        const double vol = std::sqrt(weights.col(static_cast<Eigen::Index>(p)).dot(covariance * weights.col(static_cast<Eigen::Index>(p))));
+        for(std::size_t h = 0; h < 2; ++h)
+        {
+            const HorizonRisk& factor = factorRisks[p].m_horizons[h];
+            const HorizonRisk& dense = denseRisks[p].m_horizons[h];
+            const double tolerance = 0.03 * vol * std::sqrt(static_cast<double>(factor.m_days) / 252.0);
+
+            EXPECT_EQ(factor.m_days, dense.m_days);
+            EXPECT_NEAR(factor.m_VaR, dense.m_VaR, tolerance);
+            EXPECT_NEAR(factor.m_CVaR, dense.m_CVaR, tolerance);
+        }
+    }
+
+    // the single-portfolio path collapses to the same per-step moments as the dense one
+    const std::vector<double> equalWeights(NUM_ASSETS, 1.0 / NUM_ASSETS);
+    const Returns factorReturns = engine.GenerateReturnsForFactorModel(model, drifts, equalWeights, false, 10, 252);
+    const Returns denseReturns = engine.GenerateReturnsForMultiAsset(PortfolioOptimisation::GetCholeskyMatrix(covMatrix), assetStatistics, equalWeights, false, 10, 252);
+    EXPECT_NEAR(factorReturns.m_stepStdDev, denseReturns.m_stepStdDev, 1e-10);
+    EXPECT_NEAR(factorReturns.m_stepDrift, denseReturns.m_stepDrift, 1e-14);
+}
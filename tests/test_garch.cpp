@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "GarchModel.hpp"
+#include "MonteCarloEngine.hpp"
+
+namespace
+{
+    constexpr uint64_t SEED = 20240704;
+    constexpr std::size_t NUM_DAYS = 20'000;
+
+    GarchParams TrueParams()
+    {
+        GarchParams params;
+        params.m_mu = 0.0004;
+        params.m_omega = 2e-6;
+        params.m_alpha = 0.08;
+        params.m_beta = 0.90;
+        params.m_lastVariance = params.UnconditionalVariance();
+        return params;
+    }
+
+    std::vector<double> SimulateSeries(uint64_t seed)
+    {
+        MonteCarloEngine engine(seed);
+        const Returns returns = engine.GenerateReturnsForGarch(TrueParams(), 1, NUM_DAYS);
+        return std::vector<double>(returns.m_returns.begin(), returns.m_returns.end());
+    }
+}
+
+TEST(GarchTest, FitRecoversSimulatedParameters)
+{
+    const GarchParams truth = TrueParams();
+    const GarchFit fit = GarchModel::Fit(SimulateSeries(SEED));
+
+    EXPECT_TRUE(fit.m_converged);
+    EXPECT_NEAR(fit.m_params.m_alpha, truth.m_alpha, 0.02);
+    EXPECT_NEAR(fit.m_params.m_beta, truth.m_beta, 0.02);
+    EXPECT_NEAR(fit.m_params.UnconditionalVariance(), truth.UnconditionalVariance(), 0.25 * truth.UnconditionalVariance());
+    EXPECT_GT(fit.m_params.m_lastVariance, 0.0);
+}
+
+// the parallel driver should give exactly the serial per-column fit, and warm starts should land on the same optimum
+TEST(GarchTest, FitAssetsMatchesSerialFits)
+{
+    const std::size_t numAssets = 3;
+    std::vector<std::vector<double>> series;
+    for(std::size_t asset = 0; asset < numAssets; ++asset)
+    {
+        series.push_back(SimulateSeries(SEED + asset));
+    }
+
+    std::vector<std::vector<double>> logReturnsMat(NUM_DAYS, std::vector<double>(numAssets));
+    for(std::size_t t = 0; t < NUM_DAYS; ++t)
+    {
+        for(std::size_t asset = 0; asset < numAssets; ++asset)
+        {
+            logReturnsMat[t][asset] = series[asset][t];
+        }
+    }
+
+    const std::vector<GarchFit> fits = GarchModel::FitAssets(logReturnsMat);
+    ASSERT_EQ(fits.size(), numAssets);
+
+    std::vector<GarchParams> warmStarts;
+    for(std::size_t asset = 0; asset < numAssets; ++asset)
+    {
+        const GarchFit serial = GarchModel::Fit(series[asset]);
+        EXPECT_DOUBLE_EQ(fits[asset].m_params.m_alpha, serial.m_params.m_alpha);
+        EXPECT_DOUBLE_EQ(fits[asset].m_params.m_beta, serial.m_params.m_beta);
+        EXPECT_DOUBLE_EQ(fits[asset].m_logLikelihood, serial.m_logLikelihood);
+        warmStarts.push_back(serial.m_params);
+    }
+
+    const std::vector<GarchFit> warmFits = GarchModel::FitAssets(logReturnsMat, warmStarts);
+    for(std::size_t asset = 0; asset < numAssets; ++asset)
+    {
+        EXPECT_NEAR(warmFits[asset].m_logLikelihood, fits[asset].m_logLikelihood, 1e-6 * std::abs(fits[asset].m_logLikelihood));
+        EXPECT_LE(warmFits[asset].m_iterations, fits[asset].m_iterations);
+    }
+}
+
+// started from a state whose expected next variance is the unconditional one, every day of a GJR path has the
+// stationary variance omega / (1 - persistence)
+TEST(GarchTest, SimulatedVarianceIsStationary)
+{
+    GarchParams params;
+    params.m_mu = 0.0003;
+    params.m_omega = 3e-6;
+    params.m_alpha = 0.04;
+    params.m_gamma = 0.06;
+    params.m_beta = 0.90;
+    params.m_lastVariance = params.UnconditionalVariance();
+    // a negative residual whose leverage-weighted square is the symmetric-shock average, so NextVariance gives it back
+    params.m_lastResidual = -std::sqrt((params.m_alpha + 0.5 * params.m_gamma) / (params.m_alpha + params.m_gamma) * params.m_lastVariance);
+    ASSERT_NEAR(params.NextVariance(params.m_lastVariance, params.m_lastResidual), params.UnconditionalVariance(), 1e-18);
+
+    SimulationOptions options;
+    options.m_storePaths = true;
+    const Returns returns = MonteCarloEngine(SEED).GenerateReturnsForGarch(params, 20'000, 252, options);
+
+    double sumSq = 0.0;
+    for(double value : returns.m_returns)
+    {
+        sumSq += (value - params.m_mu) * (value - params.m_mu);
+    }
+    const double variance = sumSq / static_cast<double>(returns.m_returns.size());
+
+    EXPECT_NEAR(returns.m_stepStdDev, std::sqrt(params.UnconditionalVariance()), 1e-15);
+    EXPECT_NEAR(variance, params.UnconditionalVariance(), 0.03 * params.UnconditionalVariance());
+}
+
+// the lane kernel runs paths side by side; each path must be the plain scalar recursion over its own slice of the stream,
+// including the paths of a last, partly filled group
+TEST(GarchTest, LaneKernelMatchesScalarRecursion)
+{
+    constexpr std::size_t NUM_PATHS = 21;
+    constexpr std::size_t NUM_STEPS = 60;
+
+    GarchParams params = TrueParams();
+    params.m_gamma = 0.04;
+    params.m_beta = 0.88;
+    params.m_lastResidual = -0.02;
+
+    SimulationOptions options;
+    options.m_storePaths = true;
+    const Returns returns = MonteCarloEngine(SEED).GenerateReturnsForGarch(params, NUM_PATHS, NUM_STEPS, options);
+    ASSERT_EQ(returns.m_returns.size(), NUM_PATHS * NUM_STEPS);
+
+    const GenNormalPCG runStream = GenNormalPCG::FromSeed(SEED);
+    std::vector<double> shocks(NUM_STEPS);
+    for(std::size_t path = 0; path < NUM_PATHS; ++path)
+    {
+        GenNormalPCG rng = runStream.Jump(path * GenNormalPCG::DrawsFor(NUM_STEPS));
+        rng.Fill(shocks.data(), NUM_STEPS);
+
+        double variance = params.NextVariance(params.m_lastVariance, params.m_lastResidual);
+        for(std::size_t day = 0; day < NUM_STEPS; ++day)
+        {
+            const double residual = std::sqrt(variance) * shocks[day];
+            EXPECT_NEAR(returns.m_returns[path * NUM_STEPS + day], params.m_mu + residual, 1e-15) << "path " << path << ", day " << day;
+            variance = params.NextVariance(variance, residual);
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "MonteCarloEngine.hpp"
+#include "RiskEngine.hpp"
+#include "ThreadPool.hpp"
+
+namespace
+{
+    constexpr uint64_t SEED = 20241103;
+    constexpr std::size_t NUM_PATHS = 100'000;
+    constexpr std::size_t NUM_DAYS = 252;
+    constexpr double DRIFT = 0.08;
+    constexpr double VOLATILITY = 0.2;
+    constexpr double CONFIDENCE = 0.95;
+
+    Returns SimulateCheckpoints(VarianceReduction mode)
+    {
+        SimulationOptions options;
+        options.m_varianceReduction = mode;
+        options.m_storePaths = false;
+        options.m_checkpointDays = { 1, 10, NUM_DAYS };
+        return MonteCarloEngine(SEED).GenerateReturnsForSingleAsset(DRIFT, VOLATILITY, NUM_PATHS, NUM_DAYS, options);
+    }
+
+    // every checkpoint of GBM is lognormal, so each horizon has its own closed form; tolerances scale with its spread
+    void ExpectLognormalTermStructure(const Returns& returns, double meanTolerance, double tailTolerance)
+    {
+        const std::vector<HorizonRisk> risks = MonteCarloEngine(SEED).EvaluateHorizons(returns, CONFIDENCE);
+        ASSERT_EQ(risks.size(), 3u);
+
+        for(const HorizonRisk& risk : risks)
+        {
+            const HorizonRisk expected = RiskEngine::GaussianRisk(returns.m_stepDrift, returns.m_stepStdDev, risk.m_days, CONFIDENCE);
+            const double spread = returns.m_stepStdDev * std::sqrt(static_cast<double>(risk.m_days));
+
+            EXPECT_EQ(risk.m_days, expected.m_days);
+            EXPECT_NEAR(risk.m_meanReturn, expected.m_meanReturn, meanTolerance * spread) << risk.m_days << " days";
+            EXPECT_NEAR(risk.m_VaR, expected.m_VaR, tailTolerance * spread) << risk.m_days << " days";
+            EXPECT_NEAR(risk.m_CVaR, expected.m_CVaR, tailTolerance * spread) << risk.m_days << " days";
+        }
+    }
+
+    std::vector<std::vector<char>> SerialiseWithThreads(VarianceReduction mode, std::size_t numThreads)
+    {
+        ThreadPoolConfig config;
+        config.m_numThreads = numThreads;
+        ThreadPool::Configure(config);
+
+        SimulationOptions options;
+        options.m_varianceReduction = mode;
+        options.m_storePaths = false;
+        options.m_checkpointDays = { 1, 10, NUM_DAYS };
+        const Returns returns = MonteCarloEngine(SEED).GenerateReturnsForSingleAsset(DRIFT, VOLATILITY, 10'001, NUM_DAYS, options);
+
+        std::vector<std::vector<char>> serialised;
+        for(const HistogramSketch& sketch : returns.m_horizons.m_sketches)
+        {
+            serialised.emplace_back(sketch.GetSerialisedSize());
+            sketch.Serialise(serialised.back().data());
+        }
+        return serialised;
+    }
+}
+
+// the checkpoints keep one sketch per horizon rather than a value per path
+TEST(HorizonTest, CheckpointsKeepOneSketchPerHorizon)
+{
+    const Returns returns = SimulateCheckpoints(VarianceReduction::None);
+
+    EXPECT_TRUE(returns.m_returns.empty());
+    ASSERT_EQ(returns.m_horizons.m_sketches.size(), 3u);
+    EXPECT_EQ(returns.GetNumPaths(), NUM_PATHS);
+    for(const HistogramSketch& sketch : returns.m_horizons.m_sketches)
+    {
+        EXPECT_EQ(sketch.GetCount(), NUM_PATHS);
+    }
+}
+
+TEST(HorizonTest, TermStructureMatchesLognormal)
+{
+    ExpectLognormalTermStructure(SimulateCheckpoints(VarianceReduction::None), 0.015, 0.02);
+}
+
+// tilted paths enter the sketches with their likelihood ratios, which must undo the tilt at every horizon; the
+// tilt buys the tail with the upside, so the one-year mean is a few times noisier than without it
+TEST(HorizonTest, ImportanceSampledTermStructureMatchesLognormal)
+{
+    const Returns returns = SimulateCheckpoints(VarianceReduction::TailImportanceSampling);
+    ASSERT_LT(returns.m_tailTilt, 0.0);
+
+    ExpectLognormalTermStructure(returns, 0.1, 0.02);
+}
+
+// the blocks of paths are fixed by the path count and merged in order, so even the weighted sums of importance
+// sampling and the pairs of antithetic paths give the same bits on one thread and on three
+TEST(HorizonTest, SketchesIgnoreThreadCount)
+{
+    for(VarianceReduction mode : { VarianceReduction::Antithetic, VarianceReduction::TailImportanceSampling })
+    {
+        const std::vector<std::vector<char>> serial = SerialiseWithThreads(mode, 1);
+        const std::vector<std::vector<char>> parallel = SerialiseWithThreads(mode, 3);
+        ThreadPool::Configure({});
+
+        ASSERT_EQ(serial.size(), 3u);
+        EXPECT_EQ(serial, parallel) << "variance reduction " << static_cast<int>(mode);
+    }
+}
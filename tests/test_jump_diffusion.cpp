@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "MonteCarloEngine.hpp"
+
+namespace
+{
+    constexpr uint64_t SEED = 20241024;
+    constexpr std::size_t NUM_PATHS = 100'000;
+    constexpr std::size_t NUM_DAYS = 252;
+
+    constexpr double DRIFT = 0.05;
+    constexpr double VOLATILITY = 0.2;
+
+    SimulationOptions JumpOptions(double intensity)
+    {
+        SimulationOptions options;
+        options.m_jumpIntensity = intensity;
+        options.m_jumpMean = -0.05;
+        options.m_jumpStdDev = 0.08;
+        return options;
+    }
+}
+
+// Merton: the compensated drift keeps the mean log-return at drift * T, and over T = 1 year the variance is
+// sigma^2 T + lambda T (mu_J^2 + sigma_J^2)
+TEST(JumpDiffusionTest, TerminalMomentsMatchMerton)
+{
+    const SimulationOptions options = JumpOptions(3.0);
+    const MonteCarloEngine engine(SEED);
+    const Returns returns = engine.GenerateReturnsForSingleAsset(DRIFT, VOLATILITY, NUM_PATHS, NUM_DAYS, options);
+    const std::vector<double> terminal = engine.ComputeTerminalLogReturns(returns);
+    ASSERT_EQ(terminal.size(), NUM_PATHS);
+
+    const double jumpSecondMoment = options.m_jumpMean * options.m_jumpMean + options.m_jumpStdDev * options.m_jumpStdDev;
+    const double expectedVariance = VOLATILITY * VOLATILITY + options.m_jumpIntensity * jumpSecondMoment;
+    EXPECT_NEAR(returns.m_stepStdDev * returns.m_stepStdDev * static_cast<double>(NUM_DAYS), expectedVariance, 1e-12);
+
+    double sum = 0.0;
+    for(double value : terminal)
+    {
+        sum += value;
+    }
+    const double mean = sum / static_cast<double>(NUM_PATHS);
+    double sqSum = 0.0;
+    for(double value : terminal)
+    {
+        sqSum += (value - mean) * (value - mean);
+    }
+    const double variance = sqSum / static_cast<double>(NUM_PATHS - 1);
+
+    EXPECT_NEAR(mean, DRIFT, 4.0 * std::sqrt(expectedVariance / static_cast<double>(NUM_PATHS)));
+    EXPECT_NEAR(variance, expectedVariance, 0.02 * expectedVariance);
+}
+
+// with no arrivals the jump sizes must not leak into the drift, the volatility or the diffusion stream
+TEST(JumpDiffusionTest, ZeroIntensityIsTheDiffusion)
+{
+    const Returns diffusion = MonteCarloEngine(SEED).GenerateReturnsForSingleAsset(DRIFT, VOLATILITY, 1'000, NUM_DAYS);
+    const Returns jumps = MonteCarloEngine(SEED).GenerateReturnsForSingleAsset(DRIFT, VOLATILITY, 1'000, NUM_DAYS, JumpOptions(0.0));
+
+    EXPECT_EQ(jumps.m_stepDrift, diffusion.m_stepDrift);
+    EXPECT_EQ(jumps.m_stepStdDev, diffusion.m_stepStdDev);
+    ASSERT_EQ(jumps.m_returns.size(), diffusion.m_returns.size());
+    for(std::size_t i = 0; i < diffusion.m_returns.size(); ++i)
+    {
+        ASSERT_EQ(jumps.m_returns[i], diffusion.m_returns[i]) << "index " << i;
+    }
+}
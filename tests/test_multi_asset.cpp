@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <numeric>
+
+#include "MonteCarloEngine.hpp"
+
+namespace
+{
+    constexpr uint64_t SEED = 20241020;
+}
+
+// the engine takes the Cholesky factor of the covariance itself (as GetCholeskyMatrix returns it), so the daily
+// portfolio volatility has to come out as sqrt(w' Sigma w / 252), with each asset's volatility counted once
+TEST(MultiAssetTest, StepStdDevMatchesCovariance)
+{
+    Eigen::MatrixXd covariance(3, 3);
+    covariance << 0.0400, 0.0150, 0.0060,
+                  0.0150, 0.0900, 0.0135,
+                  0.0060, 0.0135, 0.0225;
+    const Eigen::MatrixXd cholesky = Eigen::LLT<Eigen::MatrixXd>(covariance).matrixL();
+    const std::vector<std::pair<double, double>> assetStatistics = { { 0.06, 0.2 }, { 0.10, 0.3 }, { 0.04, 0.15 } };
+    const std::vector<double> weights = { 0.5, 0.2, 0.3 };
+
+    constexpr std::size_t NUM_PATHS = 20'000;
+    constexpr std::size_t NUM_DAYS = 252;
+
+    const Eigen::Map<const Eigen::VectorXd> w(weights.data(), 3);
+    const double expected = std::sqrt(w.dot(covariance * w) / static_cast<double>(NUM_DAYS));
+
+    const MonteCarloEngine engine(SEED);
+    const Returns returns = engine.GenerateReturnsForMultiAsset(cholesky, assetStatistics, weights, true, NUM_PATHS, NUM_DAYS);
+    EXPECT_NEAR(returns.m_stepStdDev, expected, 1e-12);
+
+    const double n = static_cast<double>(returns.m_returns.size());
+    const double mean = std::accumulate(returns.m_returns.begin(), returns.m_returns.end(), 0.0) / n;
+    double sqSum = 0.0;
+    for(double r : returns.m_returns)
+    {
+        sqSum += (r - mean) * (r - mean);
+    }
+    EXPECT_NEAR(std::sqrt(sqSum / (n - 1.0)), expected, 0.005 * expected);
+}
@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <stdexcept>
+
+#include "MultiProcessSimulation.hpp"
+
+namespace
+{
+    constexpr uint64_t SEED = 20241017;
+    constexpr std::size_t NUM_DAYS = 252;
+
+    ProcessRunConfig Config(std::size_t numProcesses)
+    {
+        ProcessRunConfig config;
+        config.m_numPaths = 200'000;
+        config.m_numDays = NUM_DAYS;
+        config.m_pathsPerShard = 25'000;
+        config.m_seed = SEED;
+        config.m_numProcesses = numProcesses;
+        return config;
+    }
+
+    Returns GenerateShard(const MonteCarloEngine& engine, std::size_t numPaths, const SimulationOptions& options)
+    {
+        return engine.GenerateReturnsForSingleAsset(0.08, 0.2, numPaths, NUM_DAYS, options);
+    }
+}
+
+// the shards are the same whoever runs them, so the merged counts cannot depend on the number of workers,
+// and the moments should match the model
+TEST(MultiProcessTest, ResultDoesNotDependOnProcessCount)
+{
+    const ProcessRunResult single = MultiProcessSimulation::Run<double>(Config(1), GenerateShard);
+    const ProcessRunResult split = MultiProcessSimulation::Run<double>(Config(3), GenerateShard);
+
+    EXPECT_EQ(single.m_numProcesses, 1u);
+    EXPECT_EQ(split.m_numProcesses, 3u);
+    EXPECT_EQ(single.m_numPaths, 200'000u);
+    EXPECT_EQ(split.m_numPaths, single.m_numPaths);
+
+    EXPECT_NEAR(split.m_terminal.m_VaR, single.m_terminal.m_VaR, 1e-10);
+    EXPECT_NEAR(split.m_terminal.m_CVaR, single.m_terminal.m_CVaR, 1e-10);
+    EXPECT_NEAR(split.m_meanLogReturn, single.m_meanLogReturn, 1e-10);
+    EXPECT_NEAR(split.m_logReturnStdDev, single.m_logReturnStdDev, 1e-10);
+
+    EXPECT_NEAR(single.m_meanLogReturn, 0.08, 0.003);
+    EXPECT_NEAR(single.m_logReturnStdDev, 0.2, 0.003);
+}
+
+TEST(MultiProcessTest, FailedWorkerThrows)
+{
+    const ShardedSimulation::ShardGenerator<double> failing = [](const MonteCarloEngine& engine, std::size_t numPaths, const SimulationOptions& options) {
+        // the coordinator's one-path pilot succeeds, the workers' shards do not
+        if(numPaths > 1)
+            throw std::runtime_error("worker failure");
+
+        return GenerateShard(engine, numPaths, options);
+    };
+
+    EXPECT_THROW(MultiProcessSimulation::Run<double>(Config(2), failing), std::runtime_error);
+}
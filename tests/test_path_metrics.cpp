@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "MathUtils.hpp"
+#include "MonteCarloEngine.hpp"
+#include "ThreadPool.hpp"
+
+namespace
+{
+    constexpr uint64_t SEED = 20240815;
+    constexpr std::size_t NUM_PATHS = 100'000;
+    constexpr std::size_t NUM_DAYS = 252;
+
+    FanChart FanChartWithThreads(std::size_t numThreads)
+    {
+        ThreadPoolConfig config;
+        config.m_numThreads = numThreads;
+        ThreadPool::Configure(config);
+
+        SimulationOptions options;
+        options.m_varianceReduction = VarianceReduction::Antithetic;
+        options.m_storePaths = false;
+        options.m_bandQuantiles = { 0.05, 0.5, 0.95 };
+        options.m_samplePaths = 10;
+        return MonteCarloEngine(SEED).GenerateReturnsForSingleAsset(0.08, 0.2, 10'001, 63, options).m_fanChart;
+    }
+}
+
+// first passage of a drifting Brownian motion below a barrier, with the Broadie-Glasserman shift for daily monitoring
+TEST(PathMetricsTest, BarrierHitProbabilityMatchesClosedForm)
+{
+    const double drift = 0.08;
+    const double volatility = 0.2;
+    const double lossBarrier = -0.2;
+
+    MonteCarloEngine engine(SEED);
+    SimulationOptions options;
+    options.m_trackPathMetrics = true;
+    options.m_lossBarrier = lossBarrier;
+
+    const Returns returns = engine.GenerateReturnsForSingleAsset(drift, volatility, NUM_PATHS, NUM_DAYS, options);
+    const PathRiskReport report = engine.EvaluatePathMetrics(returns);
+
+    const double barrier = std::log1p(lossBarrier) - 0.5826 * volatility * std::sqrt(1.0 / NUM_DAYS);
+    const double expected = MathUtils::NormalCdf((barrier - drift) / volatility)
+        + std::exp(2.0 * drift * barrier / (volatility * volatility)) * MathUtils::NormalCdf((barrier + drift) / volatility);
+
+    EXPECT_NEAR(report.m_barrierHitProbability, expected, 0.005);
+    EXPECT_GT(report.m_maxDrawdownAtConfidence, report.m_meanMaxDrawdown);
+    EXPECT_LE(report.m_meanDaysUnderWater, static_cast<double>(NUM_DAYS));
+}
+
+// dropping the paths must not change anything that is derived from the summaries
+TEST(PathMetricsTest, SummariesWithoutStoredPathsMatchStoredRun)
+{
+    SimulationOptions options;
+    options.m_trackPathMetrics = true;
+
+    MonteCarloEngine storedEngine(SEED);
+    const Returns stored = storedEngine.GenerateReturnsForSingleAsset(0.05, 0.3, NUM_PATHS, NUM_DAYS, options);
+
+    options.m_storePaths = false;
+    MonteCarloEngine summaryEngine(SEED);
+    const Returns summaries = summaryEngine.GenerateReturnsForSingleAsset(0.05, 0.3, NUM_PATHS, NUM_DAYS, options);
+
+    EXPECT_TRUE(summaries.m_returns.empty());
+    EXPECT_EQ(summaries.GetNumPaths(), NUM_PATHS);
+    EXPECT_EQ(summaries.m_pathMetrics.m_firstPassageDays, stored.m_pathMetrics.m_firstPassageDays);
+    EXPECT_EQ(summaries.m_pathMetrics.m_maxDrawdowns, stored.m_pathMetrics.m_maxDrawdowns);
+    EXPECT_DOUBLE_EQ(summaryEngine.EvaluateVarianceReduction(summaries).m_VaR, storedEngine.EvaluateVarianceReduction(stored).m_VaR);
+}
+
+// bands streamed from unstored paths should match exact per-day quantiles of the same paths, and the sampled
+// paths should be those paths exactly
+TEST(PathMetricsTest, FanChartMatchesStoredPaths)
+{
+    constexpr std::size_t FAN_PATHS = 20'000;
+    constexpr std::size_t FAN_DAYS = 63;
+
+    const Returns stored = MonteCarloEngine(SEED).GenerateReturnsForSingleAsset(0.08, 0.2, FAN_PATHS, FAN_DAYS);
+
+    SimulationOptions options;
+    options.m_storePaths = false;
+    options.m_bandQuantiles = { 0.05, 0.5, 0.95 };
+    options.m_samplePaths = 25;
+    const FanChart chart = MonteCarloEngine(SEED).GenerateReturnsForSingleAsset(0.08, 0.2, FAN_PATHS, FAN_DAYS, options).m_fanChart;
+
+    ASSERT_EQ(chart.m_bands.size(), FAN_DAYS * 3);
+    ASSERT_EQ(chart.m_samplePaths.size(), 25u);
+    ASSERT_EQ(chart.m_samples.size(), 25 * FAN_DAYS);
+
+    std::vector<double> cumulative(FAN_PATHS * FAN_DAYS);
+    for(std::size_t path = 0; path < FAN_PATHS; ++path)
+    {
+        double sum = 0.0;
+        for(std::size_t day = 0; day < FAN_DAYS; ++day)
+        {
+            sum += stored.m_returns[path * FAN_DAYS + day];
+            cumulative[path * FAN_DAYS + day] = sum;
+        }
+    }
+
+    std::vector<double> column(FAN_PATHS);
+    for(std::size_t day : { std::size_t(0), std::size_t(20), FAN_DAYS - 1 })
+    {
+        for(std::size_t path = 0; path < FAN_PATHS; ++path)
+        {
+            column[path] = cumulative[path * FAN_DAYS + day];
+        }
+        std::sort(column.begin(), column.end());
+
+        const double dayStdDev = 0.2 * std::sqrt(static_cast<double>(day + 1) / FAN_DAYS);
+        for(std::size_t level = 0; level < 3; ++level)
+        {
+            const double exact = column[static_cast<std::size_t>(chart.m_levels[level] * FAN_PATHS)];
+            EXPECT_NEAR(chart.m_bands[day * 3 + level], exact, 0.01 * dayStdDev);
+        }
+    }
+
+    for(std::size_t sample = 0; sample < chart.m_samplePaths.size(); ++sample)
+    {
+        const std::size_t path = chart.m_samplePaths[sample];
+        ASSERT_LT(path, FAN_PATHS);
+        EXPECT_NEAR(chart.m_samples[sample * FAN_DAYS + FAN_DAYS - 1], cumulative[path * FAN_DAYS + FAN_DAYS - 1], 1e-12);
+    }
+}
+
+// the per-day sketches of each fixed block of paths are merged in block order, so the bands and the sample are
+// the same bits on one thread and on three
+TEST(PathMetricsTest, FanChartIgnoresThreadCount)
+{
+    const FanChart serial = FanChartWithThreads(1);
+    const FanChart parallel = FanChartWithThreads(3);
+    ThreadPool::Configure({});
+
+    ASSERT_EQ(serial.m_bands.size(), 63u * 3);
+    EXPECT_EQ(serial.m_bands, parallel.m_bands);
+    EXPECT_EQ(serial.m_samplePaths, parallel.m_samplePaths);
+    EXPECT_EQ(serial.m_samples, parallel.m_samples);
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "MonteCarloEngine.hpp"
+#include "RiskEngine.hpp"
+
+namespace
+{
+    constexpr uint64_t SEED = 20241111;
+    constexpr std::size_t NUM_PATHS = 200'000;
+    constexpr std::size_t NUM_DAYS = 252;
+    constexpr double CONFIDENCE = 0.95;
+
+    // three correlated assets, 25%, 15% and 30% vol
+    const std::vector<std::pair<double, double>> STATISTICS = { { 0.09, 0.25 }, { 0.04, 0.15 }, { 0.11, 0.30 } };
+
+    Eigen::MatrixXd Cholesky()
+    {
+        Eigen::MatrixXd covariance(3, 3);
+        covariance << 0.0625, 0.01875, 0.0375,
+                      0.01875, 0.0225, 0.009,
+                      0.0375, 0.009, 0.09;
+        return Eigen::LLT<Eigen::MatrixXd>(covariance).matrixL();
+    }
+
+    void ExpectSameRisk(const PortfolioRisk& lhs, const PortfolioRisk& rhs)
+    {
+        ASSERT_EQ(lhs.m_horizons.size(), rhs.m_horizons.size());
+        for(std::size_t h = 0; h < lhs.m_horizons.size(); ++h)
+        {
+            EXPECT_EQ(lhs.m_horizons[h].m_days, rhs.m_horizons[h].m_days);
+            EXPECT_EQ(lhs.m_horizons[h].m_meanReturn, rhs.m_horizons[h].m_meanReturn);
+            EXPECT_EQ(lhs.m_horizons[h].m_VaR, rhs.m_horizons[h].m_VaR);
+            EXPECT_EQ(lhs.m_horizons[h].m_CVaR, rhs.m_horizons[h].m_CVaR);
+        }
+    }
+}
+
+// common random numbers: the same weights in two columns see the same paths, so their risk is identical
+TEST(PortfolioSimulationTest, IdenticalColumnsGiveIdenticalRisk)
+{
+    Eigen::MatrixXd weights(3, 4);
+    weights << 0.5, 0.2, 0.5, 1.0,
+               0.3, 0.3, 0.3, 0.0,
+               0.2, 0.5, 0.2, 0.0;
+
+    const std::vector<PortfolioRisk> risks = MonteCarloEngine(SEED).SimulatePortfolios(Cholesky(), STATISTICS, weights, false, 50'000, NUM_DAYS, CONFIDENCE, { 21, NUM_DAYS });
+
+    ASSERT_EQ(risks.size(), 4u);
+    ExpectSameRisk(risks[0], risks[2]);
+    EXPECT_NE(risks[0].m_horizons.back().m_CVaR, risks[1].m_horizons.back().m_CVaR);
+}
+
+// every column's log-return is Gaussian, so each horizon has the lognormal closed form of its own step moments
+TEST(PortfolioSimulationTest, DenseRiskMatchesClosedForm)
+{
+    Eigen::MatrixXd weights(3, 3);
+    weights << 0.5, 1.0, 0.8,
+               0.3, 0.0, 0.6,
+               0.2, 0.0, -0.4;
+
+    const Eigen::MatrixXd cholesky = Cholesky();
+    const MonteCarloEngine engine(SEED);
+    const std::vector<PortfolioRisk> risks = engine.SimulatePortfolios(cholesky, STATISTICS, weights, false, NUM_PATHS, NUM_DAYS, CONFIDENCE, { 1, 10, NUM_DAYS });
+
+    ASSERT_EQ(risks.size(), 3u);
+    for(Eigen::Index p = 0; p < weights.cols(); ++p)
+    {
+        const std::vector<double> column(weights.col(p).data(), weights.col(p).data() + weights.rows());
+        const std::pair<double, double> stepMoments = engine.ComputePortfolioStepMoments(cholesky, STATISTICS, column, false, NUM_DAYS);
+
+        ASSERT_EQ(risks[static_cast<std::size_t>(p)].m_horizons.size(), 3u);
+        for(const HorizonRisk& risk : risks[static_cast<std::size_t>(p)].m_horizons)
+        {
+            const HorizonRisk expected = RiskEngine::GaussianRisk(stepMoments.first, stepMoments.second, risk.m_days, CONFIDENCE);
+            const double spread = stepMoments.second * std::sqrt(static_cast<double>(risk.m_days));
+
+            EXPECT_NEAR(risk.m_meanReturn, expected.m_meanReturn, 0.015 * spread) << "portfolio " << p << ", " << risk.m_days << " days";
+            EXPECT_NEAR(risk.m_VaR, expected.m_VaR, 0.02 * spread) << "portfolio " << p << ", " << risk.m_days << " days";
+            EXPECT_NEAR(risk.m_CVaR, expected.m_CVaR, 0.02 * spread) << "portfolio " << p << ", " << risk.m_days << " days";
+        }
+    }
+}
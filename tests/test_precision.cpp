@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include "MonteCarloEngine.hpp"
+
+namespace
+{
+    constexpr uint64_t SEED = 20240611;
+    constexpr std::size_t NUM_PATHS = 20'000;
+    constexpr std::size_t NUM_DAYS = 252;
+}
+
+// float and double engines seeded alike draw the same uniforms, so the tail estimates should agree to float rounding
+TEST(PrecisionTest, SingleAssetTailRiskMatchesDouble)
+{
+    MonteCarloEngine engineD(SEED);
+    MonteCarloEngineF engineF(SEED);
+
+    const Returns returnsD = engineD.GenerateReturnsForSingleAsset(0.08, 0.25, NUM_PATHS, NUM_DAYS);
+    const ReturnsF returnsF = engineF.GenerateReturnsForSingleAsset(0.08, 0.25, NUM_PATHS, NUM_DAYS);
+
+    for(double confidence : { 0.95, 0.99 })
+    {
+        const VarianceReductionReport reportD = engineD.EvaluateVarianceReduction(returnsD, confidence);
+        const VarianceReductionReport reportF = engineF.EvaluateVarianceReduction(returnsF, confidence);
+
+        EXPECT_NEAR(reportF.m_VaR, reportD.m_VaR, 1e-4 * std::abs(reportD.m_VaR) + 1e-6);
+        EXPECT_NEAR(reportF.m_CVaR, reportD.m_CVaR, 1e-4 * std::abs(reportD.m_CVaR) + 1e-6);
+        EXPECT_NEAR(reportF.m_meanTerminalReturn, reportD.m_meanTerminalReturn, 1e-5);
+    }
+}
+
+TEST(PrecisionTest, MultiAssetTailRiskMatchesDouble)
+{
+    Eigen::MatrixXd cholesky(2, 2);
+    cholesky << 1.0, 0.0,
+                0.6, 0.8;
+    const std::vector<std::pair<double, double>> assetStatistics = { { 0.07, 0.18 }, { 0.12, 0.35 } };
+    const std::vector<double> weights = { 0.6, 0.4 };
+
+    MonteCarloEngine engineD(SEED);
+    MonteCarloEngineF engineF(SEED);
+
+    SimulationOptions options;
+    options.m_varianceReduction = VarianceReduction::Antithetic;
+
+    const Returns returnsD = engineD.GenerateReturnsForMultiAsset(cholesky, assetStatistics, weights, false, NUM_PATHS, NUM_DAYS, options);
+    const ReturnsF returnsF = engineF.GenerateReturnsForMultiAsset(cholesky, assetStatistics, weights, false, NUM_PATHS, NUM_DAYS, options);
+
+    const VarianceReductionReport reportD = engineD.EvaluateVarianceReduction(returnsD, 0.99);
+    const VarianceReductionReport reportF = engineF.EvaluateVarianceReduction(returnsF, 0.99);
+
+    EXPECT_NEAR(reportF.m_VaR, reportD.m_VaR, 1e-4 * std::abs(reportD.m_VaR) + 1e-6);
+    EXPECT_NEAR(reportF.m_CVaR, reportD.m_CVaR, 1e-4 * std::abs(reportD.m_CVaR) + 1e-6);
+}
+
+TEST(PrecisionTest, PricePathsMatchDouble)
+{
+    MonteCarloEngine engineD(SEED);
+    MonteCarloEngineF engineF(SEED);
+
+    const Returns pricesD = engineD.BuildPricePaths(engineD.GenerateReturnsForSingleAsset(0.05, 0.2, 1'000, NUM_DAYS), 100.0);
+    const ReturnsF pricesF = engineF.BuildPricePaths(engineF.GenerateReturnsForSingleAsset(0.05, 0.2, 1'000, NUM_DAYS), 100.0);
+
+    ASSERT_EQ(pricesD.m_returns.size(), pricesF.m_returns.size());
+
+    double maxRelativeError = 0.0;
+    for(std::size_t i = 0; i < pricesD.m_returns.size(); ++i)
+    {
+        maxRelativeError = std::max(maxRelativeError, std::abs(pricesF.m_returns[i] - pricesD.m_returns[i]) / pricesD.m_returns[i]);
+    }
+
+    EXPECT_LT(maxRelativeError, 1e-4);
+}
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include "MonteCarloEngine.hpp"
+
+namespace
+{
+    constexpr uint64_t SEED = 20241110;
+    constexpr std::size_t NUM_PATHS = 2'000;
+    constexpr std::size_t NUM_DAYS = 252;
+    constexpr double INITIAL_PRICE = 100.0;
+
+    Returns Simulate(SimulationOutput output, bool trackPathMetrics)
+    {
+        SimulationOptions options;
+        options.m_output = output;
+        options.m_initialPrice = INITIAL_PRICE;
+        options.m_trackPathMetrics = trackPathMetrics;
+        return MonteCarloEngine(SEED).GenerateReturnsForSingleAsset(0.06, 0.25, NUM_PATHS, NUM_DAYS, options);
+    }
+}
+
+// a copy, an in-place conversion and prices written during generation all run the same cumulative sum
+TEST(PricePathTest, ThreeConversionsAgree)
+{
+    MonteCarloEngine engine(SEED);
+
+    const Returns logReturns = Simulate(SimulationOutput::LogReturns, false);
+    const Returns copied = engine.BuildPricePaths(logReturns, INITIAL_PRICE);
+
+    Returns inPlace = logReturns;
+    engine.BuildPricePathsInPlace(inPlace, INITIAL_PRICE);
+
+    const Returns fused = Simulate(SimulationOutput::PricePaths, false);
+
+    for(const Returns* prices : { static_cast<const Returns*>(&inPlace), &fused })
+    {
+        EXPECT_EQ(prices->m_output, SimulationOutput::PricePaths);
+        EXPECT_EQ(prices->m_initialPrice, INITIAL_PRICE);
+        ASSERT_EQ(prices->m_returns.size(), copied.m_returns.size());
+        for(std::size_t i = 0; i < copied.m_returns.size(); ++i)
+        {
+            ASSERT_EQ(prices->m_returns[i], copied.m_returns[i]) << "cell " << i;
+        }
+    }
+}
+
+// the observers run before the fused conversion overwrites a path, so they still see its log-returns
+TEST(PricePathTest, PathMetricsSeeLogReturnsBeforeConversion)
+{
+    const Returns logReturns = Simulate(SimulationOutput::LogReturns, true);
+    const Returns fused = Simulate(SimulationOutput::PricePaths, true);
+
+    const PathMetrics& expected = logReturns.m_pathMetrics;
+    const PathMetrics& actual = fused.m_pathMetrics;
+    ASSERT_EQ(actual.m_terminalLogReturns.size(), NUM_PATHS);
+    EXPECT_EQ(actual.m_terminalLogReturns, expected.m_terminalLogReturns);
+    EXPECT_EQ(actual.m_maxDrawdowns, expected.m_maxDrawdowns);
+    EXPECT_EQ(actual.m_daysUnderWater, expected.m_daysUnderWater);
+    EXPECT_EQ(actual.m_firstPassageDays, expected.m_firstPassageDays);
+
+    // and the terminal log-return read back from the prices is the one the metrics recorded
+    const std::vector<double> terminal = MonteCarloEngine(SEED).ComputeTerminalLogReturns(fused);
+    for(std::size_t path = 0; path < NUM_PATHS; path += 97)
+    {
+        EXPECT_NEAR(terminal[path], actual.m_terminalLogReturns[path], 1e-12);
+    }
+}
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+#include "QuantileSelection.hpp"
+
+namespace
+{
+    // what the sorts the selection replaces would report
+    void ExpectMatchesSort(const std::vector<double>& values, const std::vector<double>& levels)
+    {
+        std::vector<double> sorted = values;
+        std::sort(sorted.begin(), sorted.end());
+
+        const std::vector<QuantileSelection::OrderStatistic> selected = QuantileSelection::Select(values, levels);
+        ASSERT_EQ(selected.size(), levels.size());
+        for(std::size_t i = 0; i < levels.size(); ++i)
+        {
+            const std::size_t index = std::min(static_cast<std::size_t>(levels[i] * static_cast<double>(sorted.size())), sorted.size() - 1);
+            const double tailMean = std::accumulate(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(index) + 1, 0.0) / static_cast<double>(index + 1);
+
+            EXPECT_EQ(selected[i].m_level, levels[i]);
+            EXPECT_EQ(selected[i].m_value, sorted[index]);
+            EXPECT_NEAR(selected[i].m_tailMean, tailMean, 1e-12 * (1.0 + std::abs(tailMean)));
+        }
+    }
+}
+
+// heavy-tailed returns around zero with a block of exact ties, through the bucketed path
+TEST(QuantileSelectionTest, LargeSampleMatchesSort)
+{
+    std::mt19937_64 rng(20241101);
+    std::student_t_distribution<double> shocks(3.0);
+
+    std::vector<double> values(300'000);
+    for(double& value : values)
+    {
+        value = 0.05 + 0.2 * shocks(rng);
+    }
+    std::fill(values.begin(), values.begin() + 20'000, -0.25);
+    std::fill(values.begin() + 20'000, values.begin() + 21'000, 0.0);
+    std::shuffle(values.begin(), values.end(), rng);
+
+    ExpectMatchesSort(values, { 0.95, 0.01, 0.05, 0.05, 0.5, 0.0, 1.0, 0.025, 0.3 });
+}
+
+TEST(QuantileSelectionTest, SmallSampleMatchesSort)
+{
+    ExpectMatchesSort({ 0.3, -0.1, 0.2, -0.4, 0.0, 0.1, -0.1 }, { 0.05, 0.5, 0.99 });
+}
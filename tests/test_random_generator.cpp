@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "RandomGenerator.hpp"
+#include "ThreadPool.hpp"
+
+namespace
+{
+    constexpr uint64_t SEED = 20241109;
+    // 128 rows make the 2^14-cell tiles exactly 128 columns wide
+    constexpr std::size_t ROWS = 128;
+    constexpr std::size_t COLS_PER_TILE = 128;
+    constexpr std::size_t COLS = 5 * COLS_PER_TILE + 37;
+
+    Eigen::MatrixXd FillWithThreads(std::size_t numThreads)
+    {
+        ThreadPoolConfig config;
+        config.m_numThreads = numThreads;
+        ThreadPool::Configure(config);
+
+        Eigen::MatrixXd matrix(ROWS, COLS);
+        GenNormalPCG::FromSeed(SEED).FillRandomMatrix(matrix);
+        return matrix;
+    }
+}
+
+// jumping over the draws of n normals lands where drawing and discarding them would
+TEST(RandomGeneratorTest, JumpMatchesDiscardedDraws)
+{
+    for(std::size_t n : { 0, 1, 2, 999, 4'096 })
+    {
+        GenNormalPCG drawn = GenNormalPCG::FromSeed(SEED);
+        std::vector<double> discarded(n);
+        drawn.Fill(discarded.data(), n);
+
+        GenNormalPCG jumped = GenNormalPCG::FromSeed(SEED).Jump(GenNormalPCG::DrawsFor(n));
+        for(int i = 0; i < 64; ++i)
+        {
+            ASSERT_EQ(drawn(), jumped()) << n << " normals";
+        }
+    }
+}
+
+// the tiling depends only on the shape, so one thread and three give the same bits
+TEST(RandomGeneratorTest, FillRandomMatrixIgnoresThreadCount)
+{
+    const Eigen::MatrixXd serial = FillWithThreads(1);
+    const Eigen::MatrixXd parallel = FillWithThreads(3);
+    ThreadPool::Configure({});
+
+    ASSERT_EQ(serial.size(), parallel.size());
+    for(Eigen::Index i = 0; i < serial.size(); ++i)
+    {
+        ASSERT_EQ(serial.data()[i], parallel.data()[i]) << "cell " << i;
+    }
+}
+
+// every tile is a serial fill from its own jump-ahead offset, so tiles never share draws
+TEST(RandomGeneratorTest, TilesAreSerialFillsFromTheirOffsets)
+{
+    Eigen::MatrixXd matrix(ROWS, COLS);
+    GenNormalPCG::FromSeed(SEED).FillRandomMatrix(matrix);
+
+    for(std::size_t firstCol = 0; firstCol < COLS; firstCol += COLS_PER_TILE)
+    {
+        const std::size_t numCells = std::min(COLS_PER_TILE, COLS - firstCol) * ROWS;
+        std::vector<double> expected(numCells);
+        GenNormalPCG::FromSeed(SEED).Jump(GenNormalPCG::DrawsFor(firstCol * ROWS)).Fill(expected.data(), numCells);
+
+        const double* tile = matrix.data() + firstCol * ROWS;
+        for(std::size_t cell = 0; cell < numCells; ++cell)
+        {
+            ASSERT_EQ(tile[cell], expected[cell]) << "column " << firstCol + cell / ROWS;
+        }
+    }
+}
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "MonteCarloEngine.hpp"
+
+namespace
+{
+    constexpr uint64_t SEED = 20241025;
+    constexpr std::size_t NUM_PATHS = 20'000;
+    constexpr std::size_t NUM_DAYS = 252;
+
+    const std::vector<std::vector<double>> TRANSITIONS = {
+        { 0.95, 0.04, 0.01 },
+        { 0.10, 0.85, 0.05 },
+        { 0.20, 0.10, 0.70 },
+    };
+
+    // regime distribution after a number of steps from a starting regime
+    std::vector<double> Propagate(std::size_t initialRegime, std::size_t numSteps)
+    {
+        std::vector<double> distribution(TRANSITIONS.size(), 0.0);
+        distribution[initialRegime] = 1.0;
+        for(std::size_t step = 0; step < numSteps; ++step)
+        {
+            std::vector<double> next(TRANSITIONS.size(), 0.0);
+            for(std::size_t from = 0; from < TRANSITIONS.size(); ++from)
+            {
+                for(std::size_t to = 0; to < TRANSITIONS.size(); ++to)
+                {
+                    next[to] += distribution[from] * TRANSITIONS[from][to];
+                }
+            }
+            distribution = next;
+        }
+        return distribution;
+    }
+
+    double Mean(const std::vector<double>& values)
+    {
+        double sum = 0.0;
+        for(double value : values)
+        {
+            sum += value;
+        }
+        return sum / static_cast<double>(values.size());
+    }
+
+    double Variance(const std::vector<double>& values)
+    {
+        const double mean = Mean(values);
+        double sqSum = 0.0;
+        for(double value : values)
+        {
+            sqSum += (value - mean) * (value - mean);
+        }
+        return sqSum / static_cast<double>(values.size() - 1);
+    }
+}
+
+// regimes without volatility and with distinct drifts make every simulated day name its regime, so the share of
+// paths in each regime can be read off day by day: e_0 P^t early on, the stationary distribution once mixed
+TEST(RegimeSwitchingTest, OccupancyFollowsTheChain)
+{
+    const std::vector<double> drifts = { 0.10, -0.20, -0.60 };
+
+    RegimeSwitchingModel model;
+    for(double drift : drifts)
+    {
+        model.m_regimes.push_back({ { drift }, Eigen::MatrixXd::Zero(1, 1) });
+    }
+    model.m_transitionMatrix = TRANSITIONS;
+    model.m_initialRegime = 2;
+
+    const Returns returns = MonteCarloEngine(SEED).GenerateReturnsForRegimeSwitching(model, { 1.0 }, NUM_PATHS, NUM_DAYS);
+    ASSERT_EQ(returns.m_returns.size(), NUM_PATHS * NUM_DAYS);
+
+    const auto occupancy = [&](std::size_t day) {
+        std::vector<double> share(drifts.size(), 0.0);
+        for(std::size_t path = 0; path < NUM_PATHS; ++path)
+        {
+            const double value = returns.m_returns[path * NUM_DAYS + day] * static_cast<double>(NUM_DAYS);
+            const auto regime = std::min_element(drifts.begin(), drifts.end(), [value](double a, double b) { return std::abs(a - value) < std::abs(b - value); });
+            share[static_cast<std::size_t>(regime - drifts.begin())] += 1.0 / static_cast<double>(NUM_PATHS);
+        }
+        return share;
+    };
+
+    // 4 standard errors of a share of NUM_PATHS paths
+    const double tolerance = 4.0 * std::sqrt(0.25 / static_cast<double>(NUM_PATHS));
+    const std::vector<double> stationary = Propagate(0, 10'000);
+    for(std::size_t day : { std::size_t(0), std::size_t(1), std::size_t(5), NUM_DAYS - 1 })
+    {
+        const std::vector<double> expected = Propagate(model.m_initialRegime, day);
+        const std::vector<double> share = occupancy(day);
+        for(std::size_t regime = 0; regime < drifts.size(); ++regime)
+        {
+            EXPECT_NEAR(share[regime], expected[regime], tolerance) << "day " << day << ", regime " << regime;
+        }
+    }
+
+    const std::vector<double> share = occupancy(NUM_DAYS - 1);
+    for(std::size_t regime = 0; regime < drifts.size(); ++regime)
+    {
+        EXPECT_NEAR(share[regime], stationary[regime], tolerance) << "regime " << regime;
+    }
+}
+
+// a chain with a single regime is the Gaussian multi-asset model: same step moments, and terminal returns that a
+// two-sample Kolmogorov-Smirnov test cannot tell apart (1.95 sqrt(2 / n) is the 0.1% critical value)
+TEST(RegimeSwitchingTest, OneRegimeMatchesMultiAsset)
+{
+    Eigen::MatrixXd covariance(2, 2);
+    covariance << 0.04, 0.018,
+                  0.018, 0.09;
+    const Eigen::MatrixXd cholesky = Eigen::LLT<Eigen::MatrixXd>(covariance).matrixL();
+    const std::vector<std::pair<double, double>> assetStatistics = { { 0.07, 0.2 }, { 0.12, 0.3 } };
+    const std::vector<double> weights = { 0.6, 0.4 };
+
+    RegimeSwitchingModel model;
+    model.m_regimes.push_back({ { 0.07, 0.12 }, cholesky });
+    model.m_transitionMatrix = { { 1.0 } };
+
+    const MonteCarloEngine engine(SEED);
+    const Returns regimeReturns = engine.GenerateReturnsForRegimeSwitching(model, weights, NUM_PATHS, NUM_DAYS);
+    const Returns gaussianReturns = engine.GenerateReturnsForMultiAsset(cholesky, assetStatistics, weights, false, NUM_PATHS, NUM_DAYS);
+
+    EXPECT_NEAR(regimeReturns.m_stepDrift, gaussianReturns.m_stepDrift, 1e-15);
+    EXPECT_NEAR(regimeReturns.m_stepStdDev, gaussianReturns.m_stepStdDev, 1e-15);
+
+    std::vector<double> regimeTerminal = engine.ComputeTerminalLogReturns(regimeReturns);
+    std::vector<double> gaussianTerminal = engine.ComputeTerminalLogReturns(gaussianReturns);
+
+    const double variance = gaussianReturns.m_stepStdDev * gaussianReturns.m_stepStdDev * static_cast<double>(NUM_DAYS);
+    EXPECT_NEAR(Mean(regimeTerminal), Mean(gaussianTerminal), 4.0 * std::sqrt(2.0 * variance / static_cast<double>(NUM_PATHS)));
+    EXPECT_NEAR(Variance(regimeTerminal), Variance(gaussianTerminal), 0.06 * variance);
+
+    std::sort(regimeTerminal.begin(), regimeTerminal.end());
+    std::sort(gaussianTerminal.begin(), gaussianTerminal.end());
+    double distance = 0.0;
+    std::size_t j = 0;
+    for(std::size_t i = 0; i < NUM_PATHS; ++i)
+    {
+        while(j < NUM_PATHS && gaussianTerminal[j] <= regimeTerminal[i])
+        {
+            ++j;
+        }
+        distance = std::max(distance, std::abs(static_cast<double>(i + 1) - static_cast<double>(j)) / static_cast<double>(NUM_PATHS));
+    }
+    EXPECT_LT(distance, 1.95 * std::sqrt(2.0 / static_cast<double>(NUM_PATHS)));
+}
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "RiskEngine.hpp"
+
+namespace
+{
+    constexpr uint64_t SEED = 20241025;
+
+    struct Market
+    {
+        Eigen::MatrixXd m_cholesky;
+        std::vector<std::pair<double, double>> m_statistics;
+        std::vector<double> m_weights;
+    };
+
+    // two correlated assets, 25% and 15% vol, 0.5 correlation
+    Market TwoAssets()
+    {
+        Eigen::MatrixXd covariance(2, 2);
+        covariance << 0.0625, 0.01875, 0.01875, 0.0225;
+
+        Market market;
+        market.m_cholesky = Eigen::LLT<Eigen::MatrixXd>(covariance).matrixL();
+        market.m_statistics = { { 0.09, 0.25 }, { 0.04, 0.15 } };
+        market.m_weights = { 0.7, 0.3 };
+        return market;
+    }
+}
+
+// the closed form should agree with the Gaussian simulation it replaces, at every checkpoint
+TEST(RiskEngineTest, ClosedFormMatchesSimulation)
+{
+    const Market market = TwoAssets();
+    const MonteCarloEngine engine(SEED);
+
+    RiskEngine::Query query;
+    query.m_simulation.m_checkpointDays = { 21, 252 };
+    query.m_numPaths = 400'000;
+
+    const RiskEngine::Evaluation closedForm = RiskEngine::Evaluate(engine, market.m_cholesky, market.m_statistics, market.m_weights, query);
+    EXPECT_EQ(closedForm.m_method, RiskEngine::Method::ClosedForm);
+    EXPECT_TRUE(closedForm.m_reason.empty());
+    EXPECT_EQ(closedForm.m_numPaths, 0u);
+
+    query.m_forceSimulation = true;
+    const RiskEngine::Evaluation simulated = RiskEngine::Evaluate(engine, market.m_cholesky, market.m_statistics, market.m_weights, query);
+    EXPECT_EQ(simulated.m_method, RiskEngine::Method::MonteCarlo);
+
+    ASSERT_EQ(closedForm.m_horizons.size(), 2u);
+    ASSERT_EQ(simulated.m_horizons.size(), 2u);
+    for(std::size_t h = 0; h < 2; ++h)
+    {
+        EXPECT_EQ(closedForm.m_horizons[h].m_days, simulated.m_horizons[h].m_days);
+        EXPECT_NEAR(closedForm.m_horizons[h].m_meanReturn, simulated.m_horizons[h].m_meanReturn, 2e-3);
+        EXPECT_NEAR(closedForm.m_horizons[h].m_VaR, simulated.m_horizons[h].m_VaR, 3e-3);
+        EXPECT_NEAR(closedForm.m_horizons[h].m_CVaR, simulated.m_horizons[h].m_CVaR, 3e-3);
+    }
+}
+
+// with no skewness or excess kurtosis the expansion is the normal itself; fat tails only raise the loss
+TEST(RiskEngineTest, CornishFisherReducesToGaussian)
+{
+    const HorizonRisk gaussian = RiskEngine::GaussianRisk(0.0003, 0.012, 10, 0.99);
+    const HorizonRisk flat = RiskEngine::CornishFisherRisk(0.0003, 0.012, { 0.0, 0.0 }, 10, 0.99);
+    EXPECT_NEAR(flat.m_meanReturn, gaussian.m_meanReturn, 1e-10);
+    EXPECT_NEAR(flat.m_VaR, gaussian.m_VaR, 1e-12);
+    EXPECT_NEAR(flat.m_CVaR, gaussian.m_CVaR, 1e-8);
+
+    const HorizonRisk fatTailed = RiskEngine::CornishFisherRisk(0.0003, 0.012, { -0.5, 6.0 }, 10, 0.99);
+    EXPECT_GT(fatTailed.m_VaR, gaussian.m_VaR);
+    EXPECT_GT(fatTailed.m_CVaR, gaussian.m_CVaR);
+
+    std::mt19937_64 rng(SEED);
+    std::normal_distribution<double> normal;
+    std::vector<double> sample(100'000);
+    for(double& x : sample)
+    {
+        x = normal(rng);
+    }
+    const RiskEngine::ReturnShape shape = RiskEngine::ComputeReturnShape(sample);
+    EXPECT_NEAR(shape.m_skewness, 0.0, 0.05);
+    EXPECT_NEAR(shape.m_excessKurtosis, 0.0, 0.1);
+}
+
+TEST(RiskEngineTest, ModelFeaturesSelectSimulation)
+{
+    const Market market = TwoAssets();
+    const MonteCarloEngine engine(SEED);
+
+    RiskEngine::Query query;
+    query.m_numPaths = 20'000;
+    query.m_simulation.m_shocks = ShockDistribution::StudentT;
+    query.m_simulation.m_degreesOfFreedom = { 5.0 };
+    query.m_simulation.m_trackPathMetrics = true;
+
+    const RiskEngine::Evaluation fatTailed = RiskEngine::Evaluate(engine, market.m_cholesky, market.m_statistics, market.m_weights, query);
+    EXPECT_EQ(fatTailed.m_method, RiskEngine::Method::MonteCarlo);
+    EXPECT_EQ(fatTailed.m_reason, "Student t shocks");
+    EXPECT_EQ(fatTailed.m_numPaths, 20'000u);
+    EXPECT_TRUE(fatTailed.m_pathRisk.has_value());
+
+    WealthPlan plan;
+    plan.m_targetWeights = market.m_weights;
+    query.m_wealthPlan = plan;
+    const RiskEngine::Evaluation account = RiskEngine::Evaluate(engine, market.m_cholesky, market.m_statistics, market.m_weights, query);
+    EXPECT_EQ(account.m_method, RiskEngine::Method::WealthSimulation);
+    ASSERT_TRUE(account.m_wealth.has_value());
+    ASSERT_EQ(account.m_horizons.size(), 1u);
+    EXPECT_NEAR(account.m_horizons[0].m_meanReturn, account.m_wealth->m_meanTerminalWealth - 1.0, 1e-12);
+}
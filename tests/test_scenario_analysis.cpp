@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+
+#include "ScenarioAnalysis.hpp"
+
+// a window compounds the log-returns of its days, matched on the bounds' prefix, and unknown windows add nothing
+TEST(ScenarioAnalysisTest, HistoricalWindowCompoundsItsDays)
+{
+    const std::vector<std::vector<double>> logReturns = { { 0.01, -0.02 }, { -0.05, 0.01 }, { -0.10, -0.03 }, { 0.02, 0.04 } };
+    const std::vector<std::string> dates = { "2020-01-31", "2020-02-03", "2020-03-16", "2020-04-01" };
+
+    ScenarioAnalysis::ScenarioSet scenarios;
+    EXPECT_TRUE(ScenarioAnalysis::AddHistoricalWindow(scenarios, "Feb-Mar 2020", logReturns, dates, "2020-02", "2020-03"));
+    EXPECT_FALSE(ScenarioAnalysis::AddHistoricalWindow(scenarios, "2008", logReturns, dates, "2008-09-01", "2008-10-31"));
+    ScenarioAnalysis::AddShock(scenarios, "Tech -20%", { -0.2, 0.0 });
+
+    ASSERT_EQ(scenarios.GetNumScenarios(), 2u);
+    EXPECT_EQ(scenarios.m_names[0], "Feb-Mar 2020");
+    EXPECT_NEAR(scenarios.Matrix()(0, 0), std::expm1(-0.15), 1e-15);
+    EXPECT_NEAR(scenarios.Matrix()(1, 0), std::expm1(-0.02), 1e-15);
+    EXPECT_EQ(scenarios.Matrix()(0, 1), -0.2);
+}
+
+// a day with a missing return for any asset drops out of the window whole, and a window of only such days adds nothing
+TEST(ScenarioAnalysisTest, HistoricalWindowSkipsMissingDays)
+{
+    const double missing = std::numeric_limits<double>::quiet_NaN();
+    const std::vector<std::vector<double>> logReturns = { { -0.05, 0.01 }, { missing, -0.04 }, { -0.10, -0.03 }, { 0.02, missing } };
+    const std::vector<std::string> dates = { "2020-03-02", "2020-03-09", "2020-03-16", "2020-04-01" };
+
+    ScenarioAnalysis::ScenarioSet scenarios;
+    EXPECT_TRUE(ScenarioAnalysis::AddHistoricalWindow(scenarios, "March 2020", logReturns, dates, "2020-03", "2020-03"));
+    EXPECT_FALSE(ScenarioAnalysis::AddHistoricalWindow(scenarios, "April 2020", logReturns, dates, "2020-04", "2020-04"));
+
+    ASSERT_EQ(scenarios.GetNumScenarios(), 1u);
+    EXPECT_NEAR(scenarios.Matrix()(0, 0), std::expm1(-0.15), 1e-15);
+    EXPECT_NEAR(scenarios.Matrix()(1, 0), std::expm1(-0.02), 1e-15);
+}
+
+// a full blend to one and doubled vols: every pair moves together at twice the old scale
+TEST(ScenarioAnalysisTest, StressedCovarianceBlendsCorrelation)
+{
+    const std::vector<std::vector<double>> covariance = { { 0.04, 0.003 }, { 0.003, 0.09 } };
+
+    const std::vector<std::vector<double>> stressed = ScenarioAnalysis::StressCovariance(covariance, { 2.0, 2.0 }, 1.0);
+    EXPECT_NEAR(stressed[0][0], 0.16, 1e-15);
+    EXPECT_NEAR(stressed[1][1], 0.36, 1e-15);
+    EXPECT_NEAR(stressed[0][1], 0.24, 1e-15);
+
+    const std::vector<std::vector<double>> unchanged = ScenarioAnalysis::StressCovariance(covariance, { 1.0, 1.0 }, 0.0);
+    EXPECT_NEAR(unchanged[0][1], 0.003, 1e-15);
+
+    // perfectly correlated draws of the singular covariance: every asset moves in its own vol's proportion
+    ScenarioAnalysis::ScenarioSet scenarios;
+    ScenarioAnalysis::AddSampledScenarios(scenarios, "stress", stressed, 1'000, 10, 7);
+    ASSERT_EQ(scenarios.GetNumScenarios(), 1'000u);
+    EXPECT_EQ(scenarios.m_names[999], "stress/999");
+    for(Eigen::Index s = 0; s < 1'000; ++s)
+    {
+        EXPECT_NEAR(std::log1p(scenarios.Matrix()(1, s)), 1.5 * std::log1p(scenarios.Matrix()(0, s)), 1e-9);
+    }
+}
+
+// the blocked product has to agree with a plain loop whichever side it is split along
+TEST(ScenarioAnalysisTest, PnLMatchesDirectSum)
+{
+    ScenarioAnalysis::ScenarioSet scenarios;
+    ScenarioAnalysis::AddSampledScenarios(scenarios, "draw", { { 0.04, 0.01, 0.0 }, { 0.01, 0.09, 0.02 }, { 0.0, 0.02, 0.0625 } }, 700, 21, 11);
+
+    for(Eigen::Index numPortfolios : { 3, 600 })
+    {
+        const Eigen::MatrixXd holdings = Eigen::MatrixXd::Random(3, numPortfolios);
+        const Eigen::MatrixXd pnl = ScenarioAnalysis::EvaluatePnL(scenarios, holdings);
+        ASSERT_EQ(pnl.rows(), 700);
+        ASSERT_EQ(pnl.cols(), numPortfolios);
+
+        for(Eigen::Index p = 0; p < numPortfolios; p += 97)
+        {
+            for(Eigen::Index s = 0; s < 700; s += 31)
+            {
+                double expected = 0.0;
+                for(Eigen::Index a = 0; a < 3; ++a)
+                {
+                    expected += holdings(a, p) * scenarios.Matrix()(a, s);
+                }
+                EXPECT_NEAR(pnl(s, p), expected, 1e-12);
+            }
+        }
+
+        const std::vector<ScenarioAnalysis::WorstCase> worst = ScenarioAnalysis::FindWorstCases(pnl);
+        ASSERT_EQ(worst.size(), static_cast<std::size_t>(numPortfolios));
+        EXPECT_EQ(worst[0].m_pnl, pnl.col(0).minCoeff());
+        EXPECT_EQ(pnl(static_cast<Eigen::Index>(worst[0].m_scenario), 0), worst[0].m_pnl);
+    }
+}
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "MonteCarloEngine.hpp"
+#include "ShardedSimulation.hpp"
+
+namespace
+{
+    constexpr uint64_t SEED = 20241002;
+    constexpr std::size_t NUM_PATHS = 50'000;
+    constexpr std::size_t NUM_DAYS = 252;
+    constexpr std::size_t PATHS_PER_SHARD = 12'000;
+
+    // fresh directory per test, removed again when the test ends
+    struct ScratchDirectory
+    {
+        std::filesystem::path m_path;
+
+        explicit ScratchDirectory(const std::string& name)
+            : m_path(std::filesystem::temp_directory_path() / name)
+        {
+            std::filesystem::remove_all(m_path);
+        }
+
+        ~ScratchDirectory()
+        {
+            std::filesystem::remove_all(m_path);
+        }
+    };
+
+    ShardedRunConfig Config(const std::filesystem::path& directory)
+    {
+        ShardedRunConfig config;
+        config.m_directory = directory.string();
+        config.m_numPaths = NUM_PATHS;
+        config.m_numDays = NUM_DAYS;
+        config.m_pathsPerShard = PATHS_PER_SHARD;
+        config.m_seed = SEED;
+        return config;
+    }
+
+    Returns GenerateShard(const MonteCarloEngine& engine, std::size_t numPaths, const SimulationOptions& options)
+    {
+        return engine.GenerateReturnsForSingleAsset(0.08, 0.2, numPaths, NUM_DAYS, options);
+    }
+}
+
+// shards should hold exactly what their substream engine generates in memory, and a run interrupted part way
+// should resume at the first missing shard without touching the ones already on disk
+TEST(ShardedSimulationTest, ResumedRunMatchesUninterruptedRun)
+{
+    const ScratchDirectory directory("sharded_simulation_resume");
+    const ShardedRunConfig config = Config(directory.m_path);
+
+    std::size_t shardsGenerated = 0;
+    const ShardedSimulation::ShardGenerator<double> failOnThird = [&](const MonteCarloEngine& engine, std::size_t numPaths, const SimulationOptions& options) {
+        if(shardsGenerated == 2)
+            throw std::runtime_error("interrupted");
+
+        ++shardsGenerated;
+        return GenerateShard(engine, numPaths, options);
+    };
+    EXPECT_THROW(ShardedSimulation::Run<double>(config, failOnThird), std::runtime_error);
+
+    ShardManifest partial;
+    ASSERT_TRUE(ShardedSimulation::LoadManifest(config.m_directory, partial));
+    EXPECT_EQ(partial.m_completed.size(), 2u);
+    EXPECT_FALSE(partial.IsComplete());
+
+    shardsGenerated = 0;
+    const ShardedSimulation::ShardGenerator<double> counting = [&](const MonteCarloEngine& engine, std::size_t numPaths, const SimulationOptions& options) {
+        ++shardsGenerated;
+        return GenerateShard(engine, numPaths, options);
+    };
+    const ShardManifest manifest = ShardedSimulation::Run<double>(config, counting);
+    EXPECT_TRUE(manifest.IsComplete());
+    EXPECT_EQ(shardsGenerated, manifest.GetNumShards() - 2);
+
+    std::size_t pathsSeen = 0;
+    ShardedSimulation::ForEachShard<double>(config.m_directory, [&](const double* paths, const ShardInfo& shard) {
+        EXPECT_EQ(shard.m_firstPath, pathsSeen);
+        pathsSeen += shard.m_numPaths;
+
+        const MonteCarloEngine engine(SEED, shard.m_index);
+        const Returns expected = GenerateShard(engine, shard.m_numPaths, {});
+        ASSERT_EQ(expected.m_returns.size(), shard.m_numPaths * NUM_DAYS);
+        for(std::size_t i = 0; i < expected.m_returns.size(); ++i)
+        {
+            ASSERT_EQ(paths[i], expected.m_returns[i]);
+        }
+    });
+    EXPECT_EQ(pathsSeen, NUM_PATHS);
+}
+
+// the streamed terminal risk should agree with the in-memory estimate over the same paths
+TEST(ShardedSimulationTest, ReducedTerminalRiskMatchesInMemory)
+{
+    const ScratchDirectory directory("sharded_simulation_reduce");
+    const ShardedRunConfig config = Config(directory.m_path);
+    ShardedSimulation::Run<double>(config, GenerateShard);
+
+    std::vector<double> terminal;
+    ShardedSimulation::ForEachShard<double>(config.m_directory, [&](const double* paths, const ShardInfo& shard) {
+        for(std::size_t path = 0; path < shard.m_numPaths; ++path)
+        {
+            double sum = 0.0;
+            for(std::size_t dayIdx = 0; dayIdx < NUM_DAYS; ++dayIdx)
+            {
+                sum += paths[path * NUM_DAYS + dayIdx];
+            }
+            terminal.push_back(std::expm1(sum));
+        }
+    });
+    ASSERT_EQ(terminal.size(), NUM_PATHS);
+
+    std::sort(terminal.begin(), terminal.end());
+    const std::size_t tailCount = static_cast<std::size_t>(0.05 * NUM_PATHS);
+    const double exactVaR = -terminal[tailCount];
+    const double exactCVaR = -std::accumulate(terminal.begin(), terminal.begin() + static_cast<std::ptrdiff_t>(tailCount), 0.0) / static_cast<double>(tailCount);
+
+    const HorizonRisk risk = ShardedSimulation::ReduceTerminalRisk<double>(config.m_directory, 0.95);
+    EXPECT_EQ(risk.m_days, NUM_DAYS);
+    EXPECT_NEAR(risk.m_VaR, exactVaR, 2e-3);
+    EXPECT_NEAR(risk.m_CVaR, exactCVaR, 2e-3);
+}
+
+// an engine built on caller storage writes into it in its own Real, and refuses a run that does not fill it exactly
+TEST(ShardedSimulationTest, PathBufferMustFitTheRun)
+{
+    constexpr std::size_t BUFFER_PATHS = 100;
+    std::vector<float> buffer(BUFFER_PATHS * NUM_DAYS);
+    const MonteCarloEngineF engine(SEED, 0, std::span<float>(buffer));
+
+    const ReturnsF written = engine.GenerateReturnsForSingleAsset(0.08, 0.2, BUFFER_PATHS, NUM_DAYS);
+    const ReturnsF expected = MonteCarloEngineF(SEED, 0).GenerateReturnsForSingleAsset(0.08, 0.2, BUFFER_PATHS, NUM_DAYS);
+    EXPECT_TRUE(written.m_returns.empty());
+    ASSERT_EQ(buffer.size(), expected.m_returns.size());
+    EXPECT_TRUE(std::equal(buffer.begin(), buffer.end(), expected.m_returns.begin()));
+
+    EXPECT_THROW(engine.GenerateReturnsForSingleAsset(0.08, 0.2, BUFFER_PATHS + 1, NUM_DAYS), std::runtime_error);
+}
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include "SimulationBuffer.hpp"
+
+namespace
+{
+    // restores the process-wide policy, so one test's choice does not leak into the rest of the suite
+    class HugePagePolicyScope
+    {
+    public:
+        explicit HugePagePolicyScope(HugePages policy)
+            : m_previous(SimulationMemory::GetHugePagePolicy())
+        {
+            SimulationMemory::SetHugePagePolicy(policy);
+        }
+
+        ~HugePagePolicyScope()
+        {
+            SimulationMemory::SetHugePagePolicy(m_previous);
+        }
+
+    private:
+        HugePages m_previous;
+    };
+
+    // writes a pattern across the buffer (one word per 4 KB page at most), reads it back and frees the buffer
+    void ExpectRoundTrip(std::size_t bytes)
+    {
+        void* ptr = SimulationMemory::Allocate(bytes);
+        ASSERT_NE(ptr, nullptr);
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(ptr) % 64, 0u);
+
+        uint64_t* words = static_cast<uint64_t*>(ptr);
+        const std::size_t numWords = bytes / sizeof(uint64_t);
+        const std::size_t stride = std::max<std::size_t>(1, 4096 / sizeof(uint64_t));
+        for(std::size_t i = 0; i < numWords; i += stride)
+        {
+            words[i] = i * 2654435761u;
+        }
+        words[numWords - 1] = 42;
+        for(std::size_t i = 0; i + 1 < numWords; i += stride)
+        {
+            ASSERT_EQ(words[i], i * 2654435761u);
+        }
+        EXPECT_EQ(words[numWords - 1], 42u);
+
+        SimulationMemory::Deallocate(ptr, bytes);
+    }
+
+    std::size_t FreeHugePages()
+    {
+        std::ifstream meminfo("/proc/meminfo");
+        std::string key;
+        std::size_t value = 0;
+        while(meminfo >> key >> value)
+        {
+            if(key == "HugePages_Free:")
+                return value;
+            meminfo.ignore(256, '\n');
+        }
+        return 0;
+    }
+}
+
+// small buffers come from the aligned heap, large ones from a fresh mapping; both must hold what is written
+TEST(SimulationBufferTest, AllocationsRoundTrip)
+{
+    EXPECT_EQ(SimulationMemory::Allocate(0), nullptr);
+
+    for(HugePages policy : { HugePages::None, HugePages::Transparent })
+    {
+        const HugePagePolicyScope scope(policy);
+        ExpectRoundTrip(1'000);
+        ExpectRoundTrip((std::size_t(1) << 21) - 8);
+        ExpectRoundTrip(std::size_t(1) << 21);
+        ExpectRoundTrip(9 * (std::size_t(1) << 20) + 24);
+    }
+}
+
+// more than the hugetlbfs pool holds: the MAP_HUGETLB mapping fails and normal pages have to take over
+TEST(SimulationBufferTest, ExplicitHugePagesFallBack)
+{
+    const std::size_t freePages = FreeHugePages();
+    if(freePages > 1'024)
+        GTEST_SKIP() << "hugetlbfs pool too large to exhaust in a test";
+
+    const HugePagePolicyScope scope(HugePages::Explicit);
+    ExpectRoundTrip((freePages + 1) * (std::size_t(1) << 21));
+}
+
+TEST(SimulationBufferTest, VectorKeepsValuesOnResize)
+{
+    SimulationVector<double> values(1'000);
+    for(std::size_t i = 0; i < values.size(); ++i)
+    {
+        values[i] = static_cast<double>(i) * 0.5;
+    }
+
+    // growing moves the contents from a heap block into a mapping
+    values.resize(1'000'000);
+    for(std::size_t i = 0; i < 1'000; ++i)
+    {
+        ASSERT_EQ(values[i], static_cast<double>(i) * 0.5);
+    }
+    values.back() = -1.0;
+
+    values.resize(500);
+    values.shrink_to_fit();
+    for(std::size_t i = 0; i < values.size(); ++i)
+    {
+        ASSERT_EQ(values[i], static_cast<double>(i) * 0.5);
+    }
+
+    // value-initialised construction still zeroes
+    const SimulationVector<double> zeros(10, 0.0);
+    for(double zero : zeros)
+    {
+        EXPECT_EQ(zero, 0.0);
+    }
+}
@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "MonteCarloEngine.hpp"
+#include "RandomGenerator.hpp"
+
+namespace
+{
+    constexpr uint64_t SEED = 20241023;
+    constexpr std::size_t NUM_PATHS = 20'000;
+    constexpr std::size_t NUM_DAYS = 252;
+
+    struct Moments
+    {
+        double m_mean;
+        double m_variance;
+        double m_excessKurtosis;
+    };
+
+    template <typename Range>
+    Moments SampleMoments(const Range& values)
+    {
+        const double n = static_cast<double>(values.size());
+        double sum = 0.0;
+        for(double value : values)
+        {
+            sum += value;
+        }
+        const double mean = sum / n;
+
+        double m2 = 0.0;
+        double m4 = 0.0;
+        for(double value : values)
+        {
+            const double d2 = (value - mean) * (value - mean);
+            m2 += d2;
+            m4 += d2 * d2;
+        }
+        m2 /= n;
+        m4 /= n;
+        return { mean, m2, m4 / (m2 * m2) - 3.0 };
+    }
+
+    // P(Gamma(shape) <= x) for a whole shape, 1 - e^-x sum_{j < shape} x^j / j!
+    double GammaCdf(std::size_t shape, double x)
+    {
+        double term = 1.0;
+        double sum = 1.0;
+        for(std::size_t j = 1; j < shape; ++j)
+        {
+            term *= x / static_cast<double>(j);
+            sum += term;
+        }
+        return 1.0 - std::exp(-x) * sum;
+    }
+
+    // three assets whose degrees of freedom come from the options, weighted so the step volatility is sqrt(w' Sigma w / 252)
+    Returns SimulateCopula(const std::vector<double>& degreesOfFreedom, double& expectedStdDev)
+    {
+        Eigen::MatrixXd covariance(3, 3);
+        covariance << 0.0400, 0.0150, 0.0060,
+                      0.0150, 0.0900, 0.0135,
+                      0.0060, 0.0135, 0.0225;
+        const Eigen::MatrixXd cholesky = Eigen::LLT<Eigen::MatrixXd>(covariance).matrixL();
+        const std::vector<std::pair<double, double>> assetStatistics = { { 0.06, 0.2 }, { 0.10, 0.3 }, { 0.04, 0.15 } };
+        const std::vector<double> weights = { 0.5, 0.2, 0.3 };
+
+        const Eigen::Map<const Eigen::VectorXd> w(weights.data(), 3);
+        expectedStdDev = std::sqrt(w.dot(covariance * w) / static_cast<double>(NUM_DAYS));
+
+        SimulationOptions options;
+        options.m_shocks = ShockDistribution::StudentT;
+        options.m_degreesOfFreedom = degreesOfFreedom;
+        return MonteCarloEngine(SEED).GenerateReturnsForMultiAsset(cholesky, assetStatistics, weights, true, NUM_PATHS, NUM_DAYS, options);
+    }
+}
+
+// mean and variance of Gamma(k) are both k, at shapes where the squeeze rejects more and less often
+TEST(StudentTTest, GammaSamplerMatchesMoments)
+{
+    constexpr std::size_t NUM_DRAWS = 400'000;
+    GenNormalPCG rng = GenNormalPCG::FromSeed(SEED);
+    std::vector<double> draws(NUM_DRAWS);
+    std::vector<double> scratch;
+
+    for(double shape : { 1.0, 2.25, 3.0, 6.5, 25.0 })
+    {
+        GammaSampler(shape).Fill(rng, draws.data(), NUM_DRAWS, scratch);
+        const Moments moments = SampleMoments(draws);
+
+        // Gamma(k) has fourth central moment 3k^2 + 6k
+        const double n = static_cast<double>(NUM_DRAWS);
+        EXPECT_NEAR(moments.m_mean, shape, 4.0 * std::sqrt(shape / n)) << "shape " << shape;
+        EXPECT_NEAR(moments.m_variance, shape, 4.0 * std::sqrt((2.0 * shape * shape + 6.0 * shape) / n)) << "shape " << shape;
+        EXPECT_TRUE(std::all_of(draws.begin(), draws.end(), [](double draw) { return draw > 0.0; })) << "shape " << shape;
+    }
+}
+
+// Kolmogorov-Smirnov against the closed-form cdf of whole shapes; 1.95 / sqrt(n) is the 0.1% critical value
+TEST(StudentTTest, GammaSamplerPassesKolmogorovSmirnov)
+{
+    constexpr std::size_t NUM_DRAWS = 200'000;
+    GenNormalPCG rng = GenNormalPCG::FromSeed(SEED + 1);
+    std::vector<double> draws(NUM_DRAWS);
+    std::vector<double> scratch;
+
+    for(std::size_t shape : { 1, 2, 5 })
+    {
+        GammaSampler(static_cast<double>(shape)).Fill(rng, draws.data(), NUM_DRAWS, scratch);
+        std::sort(draws.begin(), draws.end());
+
+        double distance = 0.0;
+        for(std::size_t i = 0; i < NUM_DRAWS; ++i)
+        {
+            const double cdf = GammaCdf(shape, draws[i]);
+            distance = std::max({ distance, cdf - static_cast<double>(i) / NUM_DRAWS, static_cast<double>(i + 1) / NUM_DRAWS - cdf });
+        }
+        EXPECT_LT(distance, 1.95 / std::sqrt(static_cast<double>(NUM_DRAWS))) << "shape " << shape;
+    }
+}
+
+// with one nu the portfolio step is a scaled unit-variance t: variance w' Sigma w / 252 and excess kurtosis 6 / (nu - 4)
+TEST(StudentTTest, SingleDegreesOfFreedomGiveStudentTMarginals)
+{
+    for(double nu : { 6.0, 12.0 })
+    {
+        double expectedStdDev = 0.0;
+        const Returns returns = SimulateCopula({ nu }, expectedStdDev);
+        ASSERT_EQ(returns.m_returns.size(), NUM_PATHS * NUM_DAYS);
+        EXPECT_NEAR(returns.m_stepStdDev, expectedStdDev, 1e-12);
+
+        const Moments moments = SampleMoments(returns.m_returns);
+        const double variance = expectedStdDev * expectedStdDev;
+        EXPECT_NEAR(moments.m_mean, returns.m_stepDrift, 4.0 * expectedStdDev / std::sqrt(static_cast<double>(returns.m_returns.size())));
+        EXPECT_NEAR(moments.m_variance, variance, 0.01 * variance) << "nu " << nu;
+
+        // the kurtosis estimate only settles once the eighth moment exists, nu > 8
+        if(nu > 8.0)
+        {
+            EXPECT_NEAR(moments.m_excessKurtosis, 6.0 / (nu - 4.0), 0.05) << "nu " << nu;
+        }
+    }
+}
+
+// several nu groups share one mixing draw; the heaviest group is exact and the rest Wilson-Hilferty, so the
+// variance only comes out close to the Gaussian one, and the tails sit between those of the groups
+TEST(StudentTTest, DistinctDegreesOfFreedomKeepTheVariance)
+{
+    double expectedStdDev = 0.0;
+    const Returns returns = SimulateCopula({ 5.0, 12.0, 30.0 }, expectedStdDev);
+    EXPECT_NEAR(returns.m_stepStdDev, expectedStdDev, 1e-12);
+
+    const Moments moments = SampleMoments(returns.m_returns);
+    const double variance = expectedStdDev * expectedStdDev;
+    EXPECT_NEAR(moments.m_variance, variance, 0.03 * variance);
+    EXPECT_GT(moments.m_excessKurtosis, 6.0 / (30.0 - 4.0));
+}
+
+// excess kurtosis 6 / (nu - 4) inverted per column; a Gaussian column has none and lands on the upper clamp
+TEST(StudentTTest, TailDegreesOfFreedomRecoverNu)
+{
+    constexpr std::size_t NUM_DAYS_OF_HISTORY = 400'000;
+    std::mt19937_64 rng(SEED);
+    std::student_t_distribution<double> t10(10.0);
+    std::student_t_distribution<double> t16(16.0);
+    std::normal_distribution<double> normal;
+
+    std::vector<std::vector<double>> returns(NUM_DAYS_OF_HISTORY);
+    for(std::vector<double>& day : returns)
+    {
+        day = { 0.01 * t10(rng), 0.02 * t16(rng), 0.015 * normal(rng) };
+    }
+    returns[7][0] = std::nan("");
+
+    const std::vector<double> degreesOfFreedom = MonteCarloEngine(SEED).ComputeTailDegreesOfFreedom(returns);
+    ASSERT_EQ(degreesOfFreedom.size(), 3u);
+    EXPECT_NEAR(degreesOfFreedom[0], 10.0, 1.0);
+    EXPECT_NEAR(degreesOfFreedom[1], 16.0, 2.0);
+    EXPECT_EQ(degreesOfFreedom[2], 50.0);
+}
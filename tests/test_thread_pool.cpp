@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+
+#include "ThreadPool.hpp"
+
+namespace
+{
+    ThreadPoolConfig WithThreads(std::size_t numThreads)
+    {
+        ThreadPoolConfig config;
+        config.m_numThreads = numThreads;
+        return config;
+    }
+}
+
+// every index visited exactly once, whether or not the grain divides the range
+TEST(ThreadPoolTest, ParallelForCoversRangeOnce)
+{
+    ThreadPool pool(WithThreads(4));
+
+    for(std::size_t grain : { 0, 1, 7, 64, 5'000 })
+    {
+        std::vector<std::atomic<int>> visits(1'003);
+        pool.ParallelFor(3, visits.size(), [&](std::size_t chunkBegin, std::size_t chunkEnd) {
+            EXPECT_LT(chunkBegin, chunkEnd);
+            if(grain > 0)
+            {
+                EXPECT_LE(chunkEnd - chunkBegin, grain);
+            }
+            for(std::size_t i = chunkBegin; i < chunkEnd; ++i)
+            {
+                visits[i].fetch_add(1);
+            }
+        }, grain);
+
+        for(std::size_t i = 0; i < visits.size(); ++i)
+        {
+            ASSERT_EQ(visits[i].load(), i < 3 ? 0 : 1) << "grain " << grain << ", index " << i;
+        }
+    }
+
+    bool called = false;
+    pool.ParallelFor(5, 5, [&](std::size_t, std::size_t) { called = true; });
+    EXPECT_FALSE(called);
+}
+
+// a chunk that itself calls ParallelFor has to finish, the waiting thread runs queued work instead of blocking
+TEST(ThreadPoolTest, NestedParallelForCompletes)
+{
+    ThreadPool pool(WithThreads(4));
+
+    std::atomic<std::size_t> total{0};
+    pool.ParallelFor(0, 16, [&](std::size_t outerBegin, std::size_t outerEnd) {
+        for(std::size_t outer = outerBegin; outer < outerEnd; ++outer)
+        {
+            pool.ParallelFor(0, 100, [&](std::size_t innerBegin, std::size_t innerEnd) {
+                total.fetch_add(innerEnd - innerBegin);
+            }, 3);
+        }
+    }, 1);
+
+    EXPECT_EQ(total.load(), 1'600u);
+}
+
+TEST(ThreadPoolTest, TaskExceptionReachesCaller)
+{
+    ThreadPool pool(WithThreads(4));
+
+    EXPECT_THROW(pool.ParallelFor(0, 100, [](std::size_t chunkBegin, std::size_t chunkEnd) {
+        if(chunkBegin <= 42 && 42 < chunkEnd)
+            throw std::runtime_error("chunk failed");
+    }, 5), std::runtime_error);
+
+    // the pool is still usable afterwards
+    std::atomic<std::size_t> count{0};
+    pool.ParallelFor(0, 100, [&](std::size_t chunkBegin, std::size_t chunkEnd) {
+        count.fetch_add(chunkEnd - chunkBegin);
+    }, 5);
+    EXPECT_EQ(count.load(), 100u);
+}
+
+// partials are folded in chunk order, so even a sum whose rounding depends on order is bit-identical for any thread count
+TEST(ThreadPoolTest, ParallelReduceIsDeterministic)
+{
+    std::vector<double> values(100'000);
+    for(std::size_t i = 0; i < values.size(); ++i)
+    {
+        values[i] = std::sin(static_cast<double>(i)) * std::pow(10.0, static_cast<double>(i % 17));
+    }
+
+    const auto sum = [&values](ThreadPool& pool) {
+        return pool.ParallelReduce(std::size_t(0), values.size(), 0.0, [&values](std::size_t first, std::size_t last) {
+            double partial = 0.0;
+            for(std::size_t i = first; i < last; ++i)
+            {
+                partial += values[i];
+            }
+            return partial;
+        }, [](double lhs, double rhs) { return lhs + rhs; }, 1'000);
+    };
+
+    ThreadPool serial(WithThreads(1));
+    ThreadPool parallel(WithThreads(6));
+    EXPECT_EQ(serial.GetNumThreads(), 1u);
+    EXPECT_EQ(parallel.GetNumThreads(), 6u);
+
+    const double expected = sum(serial);
+    for(int run = 0; run < 5; ++run)
+    {
+        EXPECT_EQ(sum(parallel), expected);
+    }
+}
+
+TEST(ThreadPoolTest, ConfigureResizesProcessPool)
+{
+    ThreadPool::Configure(WithThreads(3));
+    EXPECT_EQ(ThreadPool::Instance().GetNumThreads(), 3u);
+
+    std::atomic<std::size_t> count{0};
+    ThreadPool::Instance().ParallelFor(0, 1'000, [&](std::size_t chunkBegin, std::size_t chunkEnd) {
+        count.fetch_add(chunkEnd - chunkBegin);
+    });
+    EXPECT_EQ(count.load(), 1'000u);
+
+    ThreadPool::Configure(WithThreads(1));
+    EXPECT_EQ(ThreadPool::Instance().GetNumThreads(), 1u);
+
+    // back to the default for the rest of the suite
+    ThreadPool::Configure({});
+    EXPECT_EQ(ThreadPool::Instance().GetNumThreads(), std::max<std::size_t>(1, std::thread::hardware_concurrency()));
+}
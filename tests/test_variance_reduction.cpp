@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "MonteCarloEngine.hpp"
+#include "MathUtils.hpp"
+
+namespace
+{
+    constexpr uint64_t SEED = 20241021;
+    constexpr std::size_t NUM_PATHS = 50'000;
+    constexpr std::size_t NUM_DAYS = 252;
+    constexpr double DRIFT = 0.08;
+    constexpr double VOLATILITY = 0.25;
+
+    Returns Simulate(VarianceReduction mode)
+    {
+        SimulationOptions options;
+        options.m_varianceReduction = mode;
+        return MonteCarloEngine(SEED).GenerateReturnsForSingleAsset(DRIFT, VOLATILITY, NUM_PATHS, NUM_DAYS, options);
+    }
+
+    // terminal log-return of GBM is N(m, s^2), so its simple return is a shifted lognormal
+    struct Lognormal
+    {
+        double m_mean;
+        double m_stdDev;
+
+        explicit Lognormal(const Returns& returns)
+            : m_mean(static_cast<double>(returns.m_blockSize) * returns.m_stepDrift),
+              m_stdDev(std::sqrt(static_cast<double>(returns.m_blockSize)) * returns.m_stepStdDev)
+        {}
+
+        double Mean() const
+        {
+            return std::expm1(m_mean + 0.5 * m_stdDev * m_stdDev);
+        }
+
+        double CVaR(double confidence) const
+        {
+            const double tailProbability = 1.0 - confidence;
+            const double z = MathUtils::NormalQuantile(tailProbability);
+            return 1.0 - std::exp(m_mean + 0.5 * m_stdDev * m_stdDev) * MathUtils::NormalCdf(z - m_stdDev) / tailProbability;
+        }
+    };
+}
+
+TEST(VarianceReductionTest, PlainMonteCarloHasFullSampleSize)
+{
+    const Returns returns = Simulate(VarianceReduction::None);
+    const VarianceReductionReport report = MonteCarloEngine(SEED).EvaluateVarianceReduction(returns, 0.95);
+
+    EXPECT_EQ(report.m_mode, VarianceReduction::None);
+    EXPECT_EQ(report.m_numPaths, NUM_PATHS);
+    EXPECT_EQ(report.m_effectiveSampleSize, static_cast<double>(NUM_PATHS));
+    EXPECT_EQ(report.m_varianceRatio, 1.0);
+}
+
+// the second path of a pair is the first one's shocks mirrored about the drift
+TEST(VarianceReductionTest, AntitheticPairsAreMirrored)
+{
+    const Returns returns = Simulate(VarianceReduction::Antithetic);
+    const double drift = returns.m_stepDrift;
+
+    for(std::size_t pair = 0; pair < NUM_PATHS / 2; pair += 997)
+    {
+        const double* first = returns.m_returns.data() + 2 * pair * NUM_DAYS;
+        const double* second = first + NUM_DAYS;
+        for(std::size_t day = 0; day < NUM_DAYS; ++day)
+        {
+            ASSERT_NEAR(second[day] - drift, -(first[day] - drift), 1e-15);
+        }
+    }
+
+    const VarianceReductionReport report = MonteCarloEngine(SEED).EvaluateVarianceReduction(returns, 0.95);
+    EXPECT_GT(report.m_varianceRatio, 1.0);
+    EXPECT_NEAR(report.m_effectiveSampleSize, NUM_PATHS * report.m_varianceRatio, 1e-6);
+}
+
+// the log-return control removes most of the noise without moving the mean off the closed form
+TEST(VarianceReductionTest, ControlVariateIsUnbiased)
+{
+    const Returns returns = Simulate(VarianceReduction::ControlVariate);
+    const VarianceReductionReport report = MonteCarloEngine(SEED).EvaluateVarianceReduction(returns, 0.95);
+
+    EXPECT_NEAR(report.m_meanTerminalReturn, Lognormal(returns).Mean(), 4.0 * report.m_standardError);
+    EXPECT_GT(report.m_varianceRatio, 1.0);
+    EXPECT_NEAR(report.m_effectiveSampleSize, NUM_PATHS * report.m_varianceRatio, 1e-6);
+}
+
+// tilting towards the tail should hit the closed-form CVaR and estimate the tail probability better than plain sampling
+TEST(VarianceReductionTest, ImportanceSamplingMatchesLognormalCVaR)
+{
+    const Returns returns = Simulate(VarianceReduction::TailImportanceSampling);
+    ASSERT_EQ(returns.m_weights.size(), NUM_PATHS);
+
+    for(double confidence : { 0.95, 0.99 })
+    {
+        const VarianceReductionReport report = MonteCarloEngine(SEED).EvaluateVarianceReduction(returns, confidence);
+        EXPECT_NEAR(report.m_CVaR, Lognormal(returns).CVaR(confidence), 0.01 * Lognormal(returns).CVaR(confidence));
+        EXPECT_GT(report.m_varianceRatio, 1.0);
+        EXPECT_GT(report.m_effectiveSampleSize, 0.0);
+        EXPECT_LT(report.m_effectiveSampleSize, static_cast<double>(NUM_PATHS));
+    }
+}
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "MonteCarloEngine.hpp"
+
+namespace
+{
+    constexpr uint64_t SEED = 20241021;
+    constexpr std::size_t NUM_DAYS = 252;
+}
+
+// one asset held in full is never traded, so its wealth is the lognormal of the asset's own path
+TEST(WealthSimulationTest, SingleAssetMatchesLognormal)
+{
+    const MonteCarloEngine engine(SEED);
+    const Eigen::MatrixXd cholesky = Eigen::MatrixXd::Constant(1, 1, 0.2);
+
+    WealthPlan plan;
+    plan.m_targetWeights = { 1.0 };
+    plan.m_transactionCost = 0.01;
+
+    const WealthReport report = engine.SimulateWealth(cholesky, { { 0.08, 0.2 } }, plan, false, 200'000, NUM_DAYS);
+
+    EXPECT_EQ(report.m_terminalWealth.size(), 200'000u);
+    EXPECT_NEAR(report.m_meanTerminalWealth, std::exp(0.08 + 0.5 * 0.04), 3e-3);
+    EXPECT_NEAR(report.m_medianTerminalWealth, std::exp(0.08), 3e-3);
+    EXPECT_NEAR(report.m_terminalWealthAtRisk, std::exp(0.08 - 1.6448536 * 0.2), 5e-3);
+    EXPECT_NEAR(report.m_meanTurnover, 0.0, 1e-6);
+    EXPECT_NEAR(report.m_shortfallProbability, 0.5 * std::erfc(0.08 / 0.2 / std::sqrt(2.0)), 3e-3);
+}
+
+// without volatility every path is the same, so deposits, withdrawals and depletion can be checked exactly
+TEST(WealthSimulationTest, CashFlowsCompoundFromTheirDay)
+{
+    const MonteCarloEngine engine(SEED);
+    const Eigen::MatrixXd cholesky = Eigen::MatrixXd::Zero(2, 2);
+    const std::vector<std::pair<double, double>> statistics = { { 0.0, 0.0 }, { 0.0, 0.0 } };
+
+    WealthPlan plan;
+    plan.m_targetWeights = { 0.5, 0.5 };
+    plan.m_cashFlows = { { 125, 1.0 }, { 188, -0.5 } };
+
+    // ignoreDrift grows both assets at the 4% risk-free rate
+    const WealthReport report = engine.SimulateWealth(cholesky, statistics, plan, true, 1000, NUM_DAYS);
+    const double afterDeposit = std::exp(0.04 * 126.0 / 252.0) + 1.0;
+    const double expected = (afterDeposit * std::exp(0.04 * 63.0 / 252.0) - 0.5) * std::exp(0.04 * 63.0 / 252.0);
+
+    EXPECT_NEAR(report.m_meanTerminalWealth, expected, 1e-9);
+    EXPECT_NEAR(report.m_medianTerminalWealth, expected, 1e-9);
+    EXPECT_NEAR(report.m_shortfallLevel, 1.5, 1e-12);
+    EXPECT_EQ(report.m_shortfallProbability, 0.0);
+    EXPECT_EQ(report.m_depletionProbability, 0.0);
+
+    plan.m_cashFlows = { { 10, -2.0 } };
+    const WealthReport depleted = engine.SimulateWealth(cholesky, statistics, plan, true, 1000, NUM_DAYS);
+    EXPECT_EQ(depleted.m_depletionProbability, 1.0);
+    EXPECT_EQ(depleted.m_meanTerminalWealth, 0.0);
+    EXPECT_EQ(depleted.m_shortfallProbability, 0.0);
+}
+
+// a drift band nothing ever crosses trades as little as buy and hold; rebalancing diversified assets trades and pays costs
+TEST(WealthSimulationTest, RebalancingRulesTrade)
+{
+    const Eigen::MatrixXd cholesky = Eigen::MatrixXd{ { 0.3, 0.0 }, { 0.0, 0.1 } };
+    const std::vector<std::pair<double, double>> statistics = { { 0.1, 0.3 }, { 0.03, 0.1 } };
+
+    WealthPlan plan;
+    plan.m_targetWeights = { 0.6, 0.4 };
+    plan.m_transactionCost = 0.001;
+
+    plan.m_rule = RebalanceRule::None;
+    const WealthReport hold = MonteCarloEngine(SEED).SimulateWealth(cholesky, statistics, plan, false, 20'000, NUM_DAYS);
+
+    plan.m_rule = RebalanceRule::Threshold;
+    plan.m_driftThreshold = 10.0;
+    const WealthReport wideBand = MonteCarloEngine(SEED).SimulateWealth(cholesky, statistics, plan, false, 20'000, NUM_DAYS);
+
+    plan.m_driftThreshold = 0.05;
+    const WealthReport band = MonteCarloEngine(SEED).SimulateWealth(cholesky, statistics, plan, false, 20'000, NUM_DAYS);
+
+    plan.m_rule = RebalanceRule::Calendar;
+    plan.m_rebalanceInterval = 21;
+    const WealthReport monthly = MonteCarloEngine(SEED).SimulateWealth(cholesky, statistics, plan, false, 20'000, NUM_DAYS);
+
+    EXPECT_EQ(hold.m_meanTurnover, 0.0);
+    EXPECT_EQ(wideBand.m_terminalWealth, hold.m_terminalWealth);
+    EXPECT_GT(band.m_meanTurnover, 0.0);
+    EXPECT_GT(monthly.m_meanTurnover, band.m_meanTurnover);
+    EXPECT_NEAR(monthly.m_meanCosts, 0.001 * monthly.m_meanTurnover, 1e-12);
+}